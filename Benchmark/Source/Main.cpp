@@ -0,0 +1,505 @@
+// Offline benchmarks for the MasterBus DSP. Build the Release configuration and run it with no
+// arguments for every table, or with the names of the ones to run. Times are the best of
+// NUM_RUNS passes over a second of audio, after one untimed pass, in microseconds per block.
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr double SAMPLE_RATES[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+    constexpr int BLOCK_SIZE = 512;
+    constexpr int NUM_RUNS = 5;
+    constexpr int INPUT_BLOCKS = 64;    // Distinct blocks of noise before the input repeats
+
+    template <typename Function>
+    double timePerBlock(int numBlocks, Function&& processBlock)
+    {
+        for (int i = 0; i < numBlocks; ++i)
+            processBlock();
+
+        double best = std::numeric_limits<double>::max();
+        for (int run = 0; run < NUM_RUNS; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < numBlocks; ++i)
+                processBlock();
+            const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / numBlocks);
+        }
+        return best;
+    }
+
+    // Noise at -12dBFS, copied into the block before each call so nothing feeds back
+    template <typename SampleType>
+    class NoiseSource
+    {
+    public:
+        NoiseSource(int numChannels, int blockSize)
+            : input(numChannels, blockSize * INPUT_BLOCKS), block(numChannels, blockSize)
+        {
+            juce::Random random(1);
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < input.getNumSamples(); ++i)
+                    input.setSample(ch, i, static_cast<SampleType>(0.25f * (2.0f * random.nextFloat() - 1.0f)));
+        }
+
+        juce::AudioBuffer<SampleType>& next()
+        {
+            const int start = position * block.getNumSamples();
+            for (int ch = 0; ch < block.getNumChannels(); ++ch)
+                block.copyFrom(ch, 0, input, ch, start, block.getNumSamples());
+            position = (position + 1) % INPUT_BLOCKS;
+            return block;
+        }
+
+    private:
+        juce::AudioBuffer<SampleType> input, block;
+        int position = 0;
+    };
+
+    // A typical mastering curve: both pass filters, both shelves and every band in use
+    template <typename SampleType>
+    void setUpEQ(MasteringEQ<SampleType>& eq)
+    {
+        eq.setHighPass(30.0f, 24);
+        eq.setHighPassEnabled(true);
+        eq.setLowPass(18000.0f, 12);
+        eq.setLowPassEnabled(true);
+        eq.setLowShelf(100.0f, 2.0f);
+        eq.setLowShelfEnabled(true);
+        eq.setHighShelf(8000.0f, -1.5f);
+        eq.setHighShelfEnabled(true);
+        for (int band = 0; band < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++band)
+        {
+            eq.setBand(band, MasteringEQBase::getDefaultBandFrequency(band), band % 2 == 0 ? 2.0f : -2.0f, 1.0f);
+            eq.setBandEnabled(band, true);
+        }
+    }
+
+    template <typename SampleType>
+    void setUpCompressor(MasteringCompressor<SampleType>& compressor, MasteringCompressorBase::Mode mode)
+    {
+        compressor.setThreshold(-24.0f);
+        compressor.setRatio(3.0f);
+        compressor.setAttack(10.0f);
+        compressor.setRelease(150.0f);
+        compressor.setKnee(6.0f);
+        compressor.setMode(mode);
+    }
+
+    template <typename SampleType>
+    double timeEQ(double sampleRate, int numChannels, MasteringEQBase::FilterTopology topology)
+    {
+        auto eq = std::make_unique<MasteringEQ<SampleType>>();
+        eq->prepare(sampleRate, BLOCK_SIZE, numChannels);
+        eq->setFilterTopology(topology);
+        setUpEQ(*eq);
+
+        NoiseSource<SampleType> source(numChannels, BLOCK_SIZE);
+        return timePerBlock(static_cast<int>(sampleRate) / BLOCK_SIZE, [&] { eq->process(source.next()); });
+    }
+
+    template <typename SampleType>
+    double timeCompressor(double sampleRate, int numChannels, MasteringCompressorBase::Mode mode)
+    {
+        auto compressor = std::make_unique<MasteringCompressor<SampleType>>();
+        compressor->prepare(sampleRate, BLOCK_SIZE, numChannels);
+        setUpCompressor(*compressor, mode);
+
+        NoiseSource<SampleType> source(numChannels, BLOCK_SIZE);
+        return timePerBlock(static_cast<int>(sampleRate) / BLOCK_SIZE, [&] { compressor->process(source.next()); });
+    }
+
+    // The residual of a sine through one filter, in dBFS, once its steady state has been fitted
+    // out. The EQ is linear, so what's left is the rounding of the filter's arithmetic. The sine
+    // runs a whole number of cycles over the one second measured, so the fit is a projection.
+    template <typename SampleType>
+    double measureNoiseFloor(double sampleRate, MasteringEQBase::FilterTopology topology, bool lowShelf)
+    {
+        constexpr int FREQUENCY = 997;
+        constexpr long double AMPLITUDE = 0.5L;
+        const long double twoPi = 2.0L * std::acos(-1.0L);
+        const int rate = static_cast<int>(sampleRate);
+        const int settle = 2 * rate;   // Long enough for a 10Hz corner to ring out
+        const int length = rate;
+
+        // Reduced mod the rate so the phase stays exact however far in
+        auto phase = [&](int n) { return twoPi * static_cast<long double>((static_cast<long long>(FREQUENCY) * n) % rate) / rate; };
+
+        auto eq = std::make_unique<MasteringEQ<SampleType>>();
+        eq->prepare(sampleRate, BLOCK_SIZE, 1);
+        eq->setFilterTopology(topology);
+        if (lowShelf)
+        {
+            eq->setLowShelf(20.0f, 6.0f);
+            eq->setLowShelfEnabled(true);
+        }
+        else
+        {
+            eq->setHighPass(10.0f, 24);
+            eq->setHighPassEnabled(true);
+        }
+
+        std::vector<long double> output(static_cast<size_t>(length));
+        juce::AudioBuffer<SampleType> block(1, BLOCK_SIZE);
+        for (int start = 0; start < settle + length; start += BLOCK_SIZE)
+        {
+            const int numSamples = std::min(BLOCK_SIZE, settle + length - start);
+            block.setSize(1, numSamples, false, false, true);
+            for (int i = 0; i < numSamples; ++i)
+                block.setSample(0, i, static_cast<SampleType>(AMPLITUDE * std::sin(phase(start + i))));
+
+            eq->process(block);
+
+            for (int i = 0; i < numSamples; ++i)
+                if (start + i >= settle)
+                    output[static_cast<size_t>(start + i - settle)] = block.getSample(0, i);
+        }
+
+        long double sine = 0.0L, cosine = 0.0L, mean = 0.0L;
+        for (int i = 0; i < length; ++i)
+        {
+            const long double y = output[static_cast<size_t>(i)];
+            sine += y * std::sin(phase(settle + i));
+            cosine += y * std::cos(phase(settle + i));
+            mean += y;
+        }
+        sine *= 2.0L / length;
+        cosine *= 2.0L / length;
+        mean /= length;
+
+        long double sumSquares = 0.0L;
+        for (int i = 0; i < length; ++i)
+        {
+            const long double fit = sine * std::sin(phase(settle + i)) + cosine * std::cos(phase(settle + i)) + mean;
+            const long double residual = output[static_cast<size_t>(i)] - fit;
+            sumSquares += residual * residual;
+        }
+
+        return 10.0 * std::log10(std::max(static_cast<double>(sumSquares / length), 1.0e-60));
+    }
+
+    // Double against float: CPU for a 512 sample block, and the noise floor of the two filters
+    // float handles worst, a 10Hz high pass and a 20Hz low shelf, at each supported rate
+    void runPrecision()
+    {
+        using Topology = MasteringEQBase::FilterTopology;
+        using Mode = MasteringCompressorBase::Mode;
+
+        std::printf("Precision: CPU in us per %d sample block, float / double\n\n", BLOCK_SIZE);
+        std::printf("         EQ biquad                     EQ SVF                        Compressor (Glue)\n");
+        std::printf("         stereo         6ch            stereo         6ch            stereo         6ch\n");
+        for (const double rate : SAMPLE_RATES)
+        {
+            std::printf("%5.1fk ", rate / 1000.0);
+            for (const auto topology : { Topology::Biquad, Topology::StateVariable })
+                for (const int numChannels : { 2, 6 })
+                    std::printf("  %5.1f / %5.1f", timeEQ<float>(rate, numChannels, topology),
+                                timeEQ<double>(rate, numChannels, topology));
+            for (const int numChannels : { 2, 6 })
+                std::printf("  %5.1f / %5.1f", timeCompressor<float>(rate, numChannels, Mode::Glue),
+                            timeCompressor<double>(rate, numChannels, Mode::Glue));
+            std::printf("\n");
+        }
+
+        std::printf("\nPrecision: noise floor in dBFS (residual RMS of a -6dBFS sine), float / double\n\n");
+        std::printf("         10Hz HPF 24dB/oct             20Hz +6dB low shelf\n");
+        std::printf("         biquad         SVF            biquad         SVF\n");
+        for (const double rate : SAMPLE_RATES)
+        {
+            std::printf("%5.1fk ", rate / 1000.0);
+            for (const bool lowShelf : { false, true })
+                for (const auto topology : { Topology::Biquad, Topology::StateVariable })
+                    std::printf("  %5.0f / %5.0f", measureNoiseFloor<float>(rate, topology, lowShelf),
+                                measureNoiseFloor<double>(rate, topology, lowShelf));
+            std::printf("\n");
+        }
+        std::printf("\n");
+    }
+
+    // Minimum phase IIR when numTaps is 0, otherwise the linear or natural phase FIR at that length
+    template <typename SampleType>
+    std::unique_ptr<MasteringEQ<SampleType>> createEQ(double sampleRate, int numChannels, int numTaps, bool naturalPhase,
+                                                      bool passFilters = true)
+    {
+        auto eq = std::make_unique<MasteringEQ<SampleType>>();
+        eq->prepare(sampleRate, BLOCK_SIZE, numChannels);
+        setUpEQ(*eq);
+        eq->setHighPassEnabled(passFilters);
+        eq->setLowPassEnabled(passFilters);
+        if (numTaps > 0)
+        {
+            eq->setLinearPhase(true);
+            eq->setLinearPhaseLength(numTaps);
+            eq->setNaturalPhase(naturalPhase);
+            eq->startLinearPhase(true);
+        }
+        return eq;
+    }
+
+    // How far the natural phase output is from the minimum phase IIR chain it's designed from, in
+    // dB below that output, over a second of noise once the longest kernel has filled
+    double measureNaturalPhaseError(double sampleRate, int numTaps, bool passFilters)
+    {
+        auto iir = createEQ<float>(sampleRate, 2, 0, false, passFilters);
+        auto fir = createEQ<float>(sampleRate, 2, numTaps, true, passFilters);
+
+        NoiseSource<float> source(2, BLOCK_SIZE);
+        juce::AudioBuffer<float> firBlock(2, BLOCK_SIZE);
+        const int settleBlocks = 3 * static_cast<int>(sampleRate) / BLOCK_SIZE;
+        const int measureBlocks = static_cast<int>(sampleRate) / BLOCK_SIZE;
+        double signal = 0.0, error = 0.0;
+        for (int block = 0; block < settleBlocks + measureBlocks; ++block)
+        {
+            auto& iirBlock = source.next();
+            firBlock.makeCopyOf(iirBlock, true);
+            iir->process(iirBlock);
+            fir->process(firBlock);
+
+            if (block < settleBlocks)
+                continue;
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                for (int i = 0; i < BLOCK_SIZE; ++i)
+                {
+                    const double expected = iirBlock.getSample(ch, i);
+                    const double difference = firBlock.getSample(ch, i) - expected;
+                    signal += expected * expected;
+                    error += difference * difference;
+                }
+            }
+        }
+
+        return 10.0 * std::log10(error / signal);
+    }
+
+    // The natural phase FIR against the IIR cascade, stereo at 48kHz: CPU per block next to
+    // linear phase at the same length, and how closely it follows the IIR. The pass filters' long
+    // rings and their zeros at DC and Nyquist are the hardest part to match, so the error is also
+    // given without them.
+    void runNaturalPhase()
+    {
+        constexpr double RATE = 48000.0;
+        const int numBlocks = static_cast<int>(RATE) / BLOCK_SIZE;
+        auto timeStereo = [&](int numTaps, bool naturalPhase)
+        {
+            auto eq = createEQ<float>(RATE, 2, numTaps, naturalPhase);
+            NoiseSource<float> source(2, BLOCK_SIZE);
+            return timePerBlock(numBlocks, [&] { eq->process(source.next()); });
+        };
+
+        std::printf("Natural phase: stereo at 48kHz, us per %d sample block\n\n", BLOCK_SIZE);
+        std::printf("IIR cascade (biquad): %.1f\n\n", timeStereo(0, false));
+        std::printf("                               natural vs IIR (dB)\n");
+        std::printf("  taps     linear    natural    full curve   no HPF/LPF\n");
+        for (const int numTaps : { 4096, 16384, 65536 })
+            std::printf("%6d   %8.1f   %8.1f   %10.0f   %10.0f\n", numTaps, timeStereo(numTaps, false), timeStereo(numTaps, true),
+                        measureNaturalPhaseError(RATE, numTaps, true), measureNaturalPhaseError(RATE, numTaps, false));
+        std::printf("\n");
+    }
+
+    // The compressor's saturation oversampled at each factor, stereo at 48kHz, with the latency
+    // each factor reports. Clean runs the filters without saturating, so its row is their cost.
+    void runOversampling()
+    {
+        using Mode = MasteringCompressorBase::Mode;
+        constexpr double RATE = 48000.0;
+        constexpr int FACTORS[] = { 1, 2, 4, 8 };
+        const int numBlocks = static_cast<int>(RATE) / BLOCK_SIZE;
+
+        std::printf("Oversampling: compressor stereo at 48kHz, float, us per %d sample block\n\n", BLOCK_SIZE);
+        std::printf("  mode         1x       2x       4x       8x\n");
+
+        int latencies[std::size(FACTORS)] {};
+        const std::pair<const char*, Mode> modes[] = { { "Clean", Mode::Clean }, { "Glue", Mode::Glue },
+                                                       { "Punch", Mode::Punch }, { "Vintage", Mode::Vintage } };
+        for (const auto& [name, mode] : modes)
+        {
+            std::printf("  %-8s", name);
+            for (size_t i = 0; i < std::size(FACTORS); ++i)
+            {
+                auto compressor = std::make_unique<MasteringCompressor<float>>();
+                compressor->prepare(RATE, BLOCK_SIZE, 2);
+                setUpCompressor(*compressor, mode);
+                compressor->setOversampling(FACTORS[i]);
+
+                NoiseSource<float> source(2, BLOCK_SIZE);
+                std::printf(" %8.1f", timePerBlock(numBlocks, [&] { compressor->process(source.next()); }));
+                latencies[i] = compressor->getLatencySamples();
+            }
+            std::printf("\n");
+        }
+
+        std::printf("  latency ");
+        for (const int latency : latencies)
+            std::printf(" %8d", latency);
+        std::printf("\n\n");
+    }
+
+    // The whole processor at 32 sample blocks, stereo at 48kHz, with the same curve as above. Each
+    // block nudges the given parameters back and forth, so their groups are pushed to the DSP
+    // again; with none, processBlock finds nothing dirty and does no coefficient math.
+    // The compressor at each band count, stereo at 48kHz, with and without look-ahead, and the
+    // cost of each against wideband. Every band in a register costs the same in the detectors;
+    // the crossovers grow with the count, and five bands take a second register of floats.
+    void runBands()
+    {
+        constexpr double RATE = 48000.0;
+        constexpr int BAND_COUNTS[] = { 1, 3, 4, 5 };
+        const int numBlocks = static_cast<int>(RATE) / BLOCK_SIZE;
+
+        const auto time = [numBlocks] (auto sample, int numBands, float lookaheadMs)
+        {
+            using SampleType = decltype(sample);
+            auto compressor = std::make_unique<MasteringCompressor<SampleType>>();
+            compressor->prepare(RATE, BLOCK_SIZE, 2);
+            setUpCompressor(*compressor, MasteringCompressorBase::Mode::Clean);
+            compressor->setNumBands(numBands);
+            compressor->setLookahead(lookaheadMs);
+
+            NoiseSource<SampleType> source(2, BLOCK_SIZE);
+            return timePerBlock(numBlocks, [&] { compressor->process(source.next()); });
+        };
+
+        std::printf("Bands: compressor stereo at 48kHz, us per %d sample block (x wideband)\n\n", BLOCK_SIZE);
+        std::printf("  bands     float            float 5ms look-ahead   double\n");
+
+        double wideband[3] {};
+        for (const int numBands : BAND_COUNTS)
+        {
+            const double times[] = { time(0.0f, numBands, 0.0f), time(0.0f, numBands, 5.0f), time(0.0, numBands, 0.0f) };
+            std::printf("  %-5d", numBands);
+            for (size_t i = 0; i < std::size(times); ++i)
+            {
+                if (numBands == 1)
+                    wideband[i] = times[i];
+                std::printf("  %8.1f (%4.2fx)     ", times[i], times[i] / wideband[i]);
+            }
+            std::printf("\n");
+        }
+        std::printf("\n");
+    }
+
+    void runParameters()
+    {
+        // The parameters and the processor's timer need a message manager
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        constexpr double RATE = 48000.0;
+        constexpr int SMALL_BLOCK = 32;
+        const int numBlocks = static_cast<int>(RATE) / SMALL_BLOCK;
+
+        auto processor = std::make_unique<MasterBusAudioProcessor>();
+        auto& apvts = processor->getAPVTS();
+        const auto getParameter = [&](const juce::String& id) { return apvts.getParameter(id); };
+        const auto setParameter = [&](const juce::String& id, float value)
+        {
+            auto* parameter = getParameter(id);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        setParameter("hpfEnabled", 1.0f);
+        setParameter("lpfEnabled", 1.0f);
+        setParameter("lsGain", 2.0f);
+        setParameter("hsGain", -1.5f);
+        for (int band = 0; band < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++band)
+            setParameter("band" + juce::String(band + 1) + "Gain", band % 2 == 0 ? 2.0f : -2.0f);
+        processor->prepareToPlay(RATE, SMALL_BLOCK);
+
+        NoiseSource<float> source(2, SMALL_BLOCK);
+        juce::MidiBuffer midi;
+        const auto timeAutomating = [&](const std::vector<juce::RangedAudioParameter*>& parameters)
+        {
+            std::vector<float> values, nudged;
+            for (auto* parameter : parameters)
+            {
+                values.push_back(parameter->getValue());
+                nudged.push_back(values.back() + (values.back() < 0.5f ? 0.001f : -0.001f));
+            }
+
+            bool flip = false;
+            return timePerBlock(numBlocks, [&]
+            {
+                flip = !flip;
+                for (size_t i = 0; i < parameters.size(); ++i)
+                    parameters[i]->setValueNotifyingHost(flip ? nudged[i] : values[i]);
+                processor->processBlock(source.next(), midi);
+            });
+        };
+
+        // One continuous parameter from every group, which is what pushing every setter each
+        // block used to cost. The EQ's global group is only switches, and its setters do nothing
+        // when the value hasn't changed.
+        std::vector<juce::RangedAudioParameter*> everyGroup { getParameter("hpfFreq"), getParameter("lpfFreq"),
+                                                              getParameter("lsGain"), getParameter("hsGain"),
+                                                              getParameter("compThreshold") };
+        for (int band = 0; band < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++band)
+            everyGroup.push_back(getParameter("band" + juce::String(band + 1) + "Gain"));
+
+        const double idle = timeAutomating({});
+        const double oneBand = timeAutomating({ getParameter("band1Gain") });
+        const double allGroups = timeAutomating(everyGroup);
+
+        std::printf("Parameters: processor stereo at 48kHz, float, us per %d sample block\n\n", SMALL_BLOCK);
+        std::printf("  no changes            %6.2f\n", idle);
+        std::printf("  one band automated    %6.2f\n", oneBand);
+        std::printf("  every group changed   %6.2f\n", allGroups);
+        std::printf("\nSaved by pushing only changed groups, with no changes: %.2f us per block (%.0f%%)\n\n",
+                    allGroups - idle, 100.0 * (allGroups - idle) / allGroups);
+    }
+
+    struct Benchmark
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark benchmarks[] =
+    {
+        { "precision", runPrecision },
+        { "naturalphase", runNaturalPhase },
+        { "oversampling", runOversampling },
+        { "bands", runBands },
+        { "parameters", runParameters }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    bool ranAny = false;
+    for (const auto& benchmark : benchmarks)
+    {
+        bool requested = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            requested = requested || std::strcmp(argv[i], benchmark.name) == 0;
+
+        if (requested)
+        {
+            benchmark.run();
+            ranAny = true;
+        }
+    }
+
+    if (!ranAny)
+    {
+        std::printf("Usage: MasterBusBenchmark [name...]\nBenchmarks:");
+        for (const auto& benchmark : benchmarks)
+            std::printf(" %s", benchmark.name);
+        std::printf("\n");
+        return 1;
+    }
+
+    return 0;
+}
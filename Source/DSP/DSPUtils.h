@@ -2,12 +2,21 @@
 
 #include <cmath>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 namespace DSPUtils
 {
     constexpr float PI = 3.14159265358979323846f;
     constexpr float TWOPI = 6.28318530717958647692f;
 
+    // The same constants at the precision of a filter design
+    template <typename T> constexpr T pi = static_cast<T>(3.14159265358979323846L);
+    template <typename T> constexpr T twoPi = static_cast<T>(6.28318530717958647692L);
+
     inline float linearToDecibels(float linear)
     {
         return linear > 0.0f ? 20.0f * std::log10(linear) : -100.0f;
@@ -18,6 +27,72 @@ namespace DSPUtils
         return std::pow(10.0f, dB / 20.0f);
     }
 
+    // Fast log2/exp2 for detectors, gain computers and meters, good to about 0.0001dB over
+    // any level audio gets to. No libm calls, and limits are applied to the bits with integer
+    // min/max, since float compares don't vectorise under strict IEEE settings, so the block
+    // versions do. Filter designs keep using the std functions.
+    inline float fastLog2(float x)
+    {
+        // Split x into 2^e * m with m in [sqrt(0.5), sqrt(2)), then take log2(m) from the odd
+        // series in t = (m - 1) / (m + 1), |t| < 0.18. Positive normal x only.
+        std::uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const auto exponent = static_cast<std::int32_t>(bits - 0x3f3504f3u) >> 23;
+        bits -= static_cast<std::uint32_t>(exponent) << 23;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        const float t = (m - 1.0f) / (m + 1.0f);
+        const float t2 = t * t;
+        const float series = t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f)));
+        return static_cast<float>(exponent) + series;
+    }
+
+    inline float fastExp2(float x)
+    {
+        // Round to the nearest integer by adding 1.5 * 2^23, which leaves the fraction in
+        // [-0.5, 0.5] for a Taylor polynomial, and build 2^integer from its bits. Results
+        // outside the normal range are held at its ends.
+        const float rounded = (x + 12582912.0f) - 12582912.0f;
+        const float f = x - rounded;
+        const float p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * 0.00133335581f))));
+
+        const auto exponent = std::min(std::max(static_cast<std::int32_t>(rounded), -126), 127);
+        const auto bits = static_cast<std::uint32_t>(exponent + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    // Floored at -100dB, which also covers zero and negative input
+    inline float fastLinearToDecibels(float linear)
+    {
+        std::int32_t bits;
+        std::memcpy(&bits, &linear, sizeof(bits));
+        bits = std::max(bits, std::int32_t { 0x3727c5ac });   // 1.0e-5f
+        float floored;
+        std::memcpy(&floored, &bits, sizeof(floored));
+        return 6.02059991f * fastLog2(floored);
+    }
+
+    inline float fastDecibelsToLinear(float dB)
+    {
+        return fastExp2(dB * 0.166096405f);
+    }
+
+    // Whole blocks, in place if the pointers are the same
+    inline void fastLinearToDecibels(const float* linear, float* dB, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dB[i] = fastLinearToDecibels(linear[i]);
+    }
+
+    inline void fastDecibelsToLinear(const float* dB, float* linear, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            linear[i] = fastDecibelsToLinear(dB[i]);
+    }
+
     inline float mapRange(float value, float inMin, float inMax, float outMin, float outMax)
     {
         return outMin + (outMax - outMin) * (value - inMin) / (inMax - inMin);
@@ -33,6 +108,21 @@ namespace DSPUtils
         return std::clamp(sample, -threshold, threshold);
     }
 
+    // The mid/side matrix over a block, in place: a becomes (a + b) * scale and b becomes
+    // (a - b) * scale. A scale of 0.5 takes left/right to mid/side and 1 takes it back. One
+    // pass with no dependence between samples, so it vectorises.
+    template <typename T>
+    void sumAndDifference(T* a, T* b, int numSamples, T scale)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const T sum = (a[i] + b[i]) * scale;
+            const T difference = (a[i] - b[i]) * scale;
+            a[i] = sum;
+            b[i] = difference;
+        }
+    }
+
     // Calculate one-pole filter coefficient for given time constant
     inline float calculateCoefficient(double sampleRate, float timeMs)
     {
@@ -40,23 +130,73 @@ namespace DSPUtils
         return 1.0f - std::exp(-1.0f / (static_cast<float>(sampleRate) * timeMs * 0.001f));
     }
 
-    // Biquad filter coefficients
-    struct BiquadCoeffs
+    // Biquad filter coefficients, at the precision of the samples they filter. The designs
+    // below run at that precision too: in float, cos(w0) rounds to 1 for a 10Hz corner at
+    // 192kHz, so only a double design keeps low corners at high rates where they belong.
+    template <typename T>
+    struct BiquadCoefficients
+    {
+        T b0 = 1, b1 = 0, b2 = 0;
+        T a1 = 0, a2 = 0;
+
+        bool operator==(const BiquadCoefficients& other) const
+        {
+            return b0 == other.b0 && b1 == other.b1 && b2 == other.b2
+                && a1 == other.a1 && a2 == other.a2;
+        }
+        bool operator!=(const BiquadCoefficients& other) const { return !(*this == other); }
+    };
+
+    using BiquadCoeffs = BiquadCoefficients<float>;
+
+    // Squared magnitude of a biquad at normalised frequency w, given cos(w) and cos(2w).
+    // Evaluated in double so low-frequency responses near DC don't cancel out.
+    template <typename T>
+    double calculateMagnitudeSquared(const BiquadCoefficients<T>& c, double cosW, double cos2W)
+    {
+        const double b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+        double num = b0 * b0 + b1 * b1 + b2 * b2 + 2.0 * (b0 * b1 + b1 * b2) * cosW + 2.0 * b0 * b2 * cos2W;
+        double den = 1.0 + a1 * a1 + a2 * a2 + 2.0 * (a1 + a1 * a2) * cosW + 2.0 * a2 * cos2W;
+
+        // At the zero of a pass filter num cancels to rounding noise of either sign
+        return den > 0.0 ? std::max(num / den, 0.0) : 0.0;
+    }
+
+    // Squared magnitude of a biquad as a ratio of quadratics in phi = sin^2(w / 2):
+    // |H|^2 = (n0 + n1 phi + n2 phi^2) / (d0 + d1 phi + d2 phi^2).
+    // The polynomial is formed in double, where the terms that cancel at DC for pass filters
+    // cancel exactly, so evaluating it in float still holds up at low frequencies.
+    struct MagnitudePolynomial
     {
-        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
-        float a1 = 0.0f, a2 = 0.0f;
+        float n0 = 1.0f, n1 = 0.0f, n2 = 0.0f;
+        float d0 = 1.0f, d1 = 0.0f, d2 = 0.0f;
     };
 
+    template <typename T>
+    MagnitudePolynomial calculateMagnitudePolynomial(const BiquadCoefficients<T>& c)
+    {
+        const double b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+        MagnitudePolynomial p;
+        p.n0 = static_cast<float>((b0 + b1 + b2) * (b0 + b1 + b2));
+        p.n1 = static_cast<float>(-4.0 * (b0 * b1 + 4.0 * b0 * b2 + b1 * b2));
+        p.n2 = static_cast<float>(16.0 * b0 * b2);
+        p.d0 = static_cast<float>((1.0 + a1 + a2) * (1.0 + a1 + a2));
+        p.d1 = static_cast<float>(-4.0 * (a1 + 4.0 * a2 + a1 * a2));
+        p.d2 = static_cast<float>(16.0 * a2);
+        return p;
+    }
+
     // Calculate biquad coefficients for various filter types
-    inline BiquadCoeffs calculateLowPass(float sampleRate, float freq, float Q)
+    template <typename T>
+    BiquadCoefficients<T> calculateLowPass(T sampleRate, T freq, T Q)
     {
-        BiquadCoeffs c;
-        float w0 = TWOPI * freq / sampleRate;
-        float cosW0 = std::cos(w0);
-        float sinW0 = std::sin(w0);
-        float alpha = sinW0 / (2.0f * Q);
+        BiquadCoefficients<T> c;
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / (2.0f * Q);
 
-        float a0 = 1.0f + alpha;
+        T a0 = 1.0f + alpha;
         c.b0 = ((1.0f - cosW0) / 2.0f) / a0;
         c.b1 = (1.0f - cosW0) / a0;
         c.b2 = ((1.0f - cosW0) / 2.0f) / a0;
@@ -65,15 +205,16 @@ namespace DSPUtils
         return c;
     }
 
-    inline BiquadCoeffs calculateHighPass(float sampleRate, float freq, float Q)
+    template <typename T>
+    BiquadCoefficients<T> calculateHighPass(T sampleRate, T freq, T Q)
     {
-        BiquadCoeffs c;
-        float w0 = TWOPI * freq / sampleRate;
-        float cosW0 = std::cos(w0);
-        float sinW0 = std::sin(w0);
-        float alpha = sinW0 / (2.0f * Q);
+        BiquadCoefficients<T> c;
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / (2.0f * Q);
 
-        float a0 = 1.0f + alpha;
+        T a0 = 1.0f + alpha;
         c.b0 = ((1.0f + cosW0) / 2.0f) / a0;
         c.b1 = (-(1.0f + cosW0)) / a0;
         c.b2 = ((1.0f + cosW0) / 2.0f) / a0;
@@ -82,16 +223,56 @@ namespace DSPUtils
         return c;
     }
 
-    inline BiquadCoeffs calculatePeakingEQ(float sampleRate, float freq, float Q, float gainDb)
+    // Band pass with 0 dB at the centre frequency
+    template <typename T>
+    BiquadCoefficients<T> calculateBandPass(T sampleRate, T freq, T Q)
+    {
+        BiquadCoefficients<T> c;
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / (2.0f * Q);
+
+        T a0 = 1.0f + alpha;
+        c.b0 = alpha / a0;
+        c.b1 = 0.0f;
+        c.b2 = -alpha / a0;
+        c.a1 = (-2.0f * cosW0) / a0;
+        c.a2 = (1.0f - alpha) / a0;
+        return c;
+    }
+
+    // All pass with the poles of the low and high pass above. At Q = 1/sqrt(2) it is the sum of
+    // the two squared, so it phase matches a Linkwitz-Riley crossover at the same frequency.
+    template <typename T>
+    BiquadCoefficients<T> calculateAllPass(T sampleRate, T freq, T Q)
+    {
+        BiquadCoefficients<T> c;
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / (2.0f * Q);
+
+        T a0 = 1.0f + alpha;
+        c.b0 = (1.0f - alpha) / a0;
+        c.b1 = (-2.0f * cosW0) / a0;
+        c.b2 = 1.0f;
+        c.a1 = (-2.0f * cosW0) / a0;
+        c.a2 = (1.0f - alpha) / a0;
+        return c;
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculatePeakingEQ(T sampleRate, T freq, T Q, T gainDb)
     {
-        BiquadCoeffs c;
-        float A = std::pow(10.0f, gainDb / 40.0f);
-        float w0 = TWOPI * freq / sampleRate;
-        float cosW0 = std::cos(w0);
-        float sinW0 = std::sin(w0);
-        float alpha = sinW0 / (2.0f * Q);
+        BiquadCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / (2.0f * Q);
 
-        float a0 = 1.0f + alpha / A;
+        T a0 = 1.0f + alpha / A;
         c.b0 = (1.0f + alpha * A) / a0;
         c.b1 = (-2.0f * cosW0) / a0;
         c.b2 = (1.0f - alpha * A) / a0;
@@ -100,17 +281,18 @@ namespace DSPUtils
         return c;
     }
 
-    inline BiquadCoeffs calculateLowShelf(float sampleRate, float freq, float gainDb, float S = 1.0f)
+    template <typename T>
+    BiquadCoefficients<T> calculateLowShelf(T sampleRate, T freq, T gainDb, T S = 1)
     {
-        BiquadCoeffs c;
-        float A = std::pow(10.0f, gainDb / 40.0f);
-        float w0 = TWOPI * freq / sampleRate;
-        float cosW0 = std::cos(w0);
-        float sinW0 = std::sin(w0);
-        float alpha = sinW0 / 2.0f * std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
-        float sqrtA2alpha = 2.0f * std::sqrt(A) * alpha;
+        BiquadCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / 2.0f * std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
+        T sqrtA2alpha = 2.0f * std::sqrt(A) * alpha;
 
-        float a0 = (A + 1.0f) + (A - 1.0f) * cosW0 + sqrtA2alpha;
+        T a0 = (A + 1.0f) + (A - 1.0f) * cosW0 + sqrtA2alpha;
         c.b0 = (A * ((A + 1.0f) - (A - 1.0f) * cosW0 + sqrtA2alpha)) / a0;
         c.b1 = (2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosW0)) / a0;
         c.b2 = (A * ((A + 1.0f) - (A - 1.0f) * cosW0 - sqrtA2alpha)) / a0;
@@ -119,17 +301,18 @@ namespace DSPUtils
         return c;
     }
 
-    inline BiquadCoeffs calculateHighShelf(float sampleRate, float freq, float gainDb, float S = 1.0f)
+    template <typename T>
+    BiquadCoefficients<T> calculateHighShelf(T sampleRate, T freq, T gainDb, T S = 1)
     {
-        BiquadCoeffs c;
-        float A = std::pow(10.0f, gainDb / 40.0f);
-        float w0 = TWOPI * freq / sampleRate;
-        float cosW0 = std::cos(w0);
-        float sinW0 = std::sin(w0);
-        float alpha = sinW0 / 2.0f * std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
-        float sqrtA2alpha = 2.0f * std::sqrt(A) * alpha;
+        BiquadCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        T w0 = twoPi<T> * freq / sampleRate;
+        T cosW0 = std::cos(w0);
+        T sinW0 = std::sin(w0);
+        T alpha = sinW0 / 2.0f * std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
+        T sqrtA2alpha = 2.0f * std::sqrt(A) * alpha;
 
-        float a0 = (A + 1.0f) - (A - 1.0f) * cosW0 + sqrtA2alpha;
+        T a0 = (A + 1.0f) - (A - 1.0f) * cosW0 + sqrtA2alpha;
         c.b0 = (A * ((A + 1.0f) + (A - 1.0f) * cosW0 + sqrtA2alpha)) / a0;
         c.b1 = (-2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosW0)) / a0;
         c.b2 = (A * ((A + 1.0f) + (A - 1.0f) * cosW0 - sqrtA2alpha)) / a0;
@@ -138,20 +321,522 @@ namespace DSPUtils
         return c;
     }
 
-    // Multi-pole filter coefficient calculation for 6/12/18/24 dB slopes
-    inline float calculateButterworthQ(int order, int stage)
+    // Matched magnitude designs (after Vicanek, "Matched Second Order Digital Filters"). The
+    // bilinear designs above squeeze the whole analog axis into DC..Nyquist, so near the top of
+    // a 44.1/48kHz session a bell comes out narrower than its analog shape and every section is
+    // pulled back to its DC gain at Nyquist. Here the poles come from the impulse invariant
+    // mapping and the zeros are solved so that |H| equals the analog magnitude at DC, at the
+    // design frequency and at Nyquist. Worked in double whatever T is, since solving for the
+    // zeros subtracts powers that are nearly equal.
+    namespace detail
     {
-        // Q values for cascaded Butterworth sections
-        if (order == 1) return 0.7071f;
-        if (order == 2) return 0.7071f;
-        if (order == 3) {
-            if (stage == 0) return 1.0f;
-            return 0.5f;
+        // w in radians per sample, powers are |H|^2 of the analog prototype
+        inline BiquadCoefficients<double> matchMagnitude(double poleW, double poleQ, double matchW,
+                                                         double dcPower, double matchPower, double nyquistPower)
+        {
+            const double zeta = 0.5 / poleQ;
+            const double decay = std::exp(-zeta * poleW);
+            const double a1 = zeta <= 1.0 ? -2.0 * decay * std::cos(std::sqrt(1.0 - zeta * zeta) * poleW)
+                                          : -2.0 * decay * std::cosh(std::sqrt(zeta * zeta - 1.0) * poleW);
+            const double a2 = decay * decay;
+
+            // |H|^2 = (B0 phi0 + B1 phi1 + B2 phi2) / (A0 phi0 + A1 phi1 + A2 phi2), with
+            // phi1 = sin^2(w / 2), phi0 = 1 - phi1 and phi2 = 4 phi0 phi1
+            const double A0 = (1.0 + a1 + a2) * (1.0 + a1 + a2);
+            const double A1 = (1.0 - a1 + a2) * (1.0 - a1 + a2);
+            const double A2 = -4.0 * a2;
+
+            const double s = std::sin(0.5 * matchW);
+            const double phi1 = s * s;
+            const double phi0 = 1.0 - phi1;
+            const double phi2 = 4.0 * phi0 * phi1;
+
+            const double B0 = A0 * dcPower;
+            const double B1 = A1 * nyquistPower;
+            const double B2 = (matchPower * (A0 * phi0 + A1 * phi1 + A2 * phi2) - B0 * phi0 - B1 * phi1) / phi2;
+
+            // Back to coefficients: sqrt(B0) = b0 + b1 + b2, sqrt(B1) = b0 - b1 + b2 and
+            // B2 = -4 b0 b2. The larger root for b0 keeps the zeros inside the unit circle.
+            const double rootB0 = std::sqrt(B0);
+            const double rootB1 = std::sqrt(B1);
+            const double W = 0.5 * (rootB0 + rootB1);
+
+            BiquadCoefficients<double> c;
+            c.b0 = 0.5 * (W + std::sqrt(std::max(W * W + B2, 0.0)));
+            c.b1 = 0.5 * (rootB0 - rootB1);
+            c.b2 = -B2 / (4.0 * c.b0);
+            c.a1 = a1;
+            c.a2 = a2;
+            return c;
         }
-        if (order == 4) {
-            if (stage == 0) return 0.5412f;
-            return 1.3065f;
+
+        // Bells and shelves cut by exactly the inverse of the boost with the same settings. The
+        // designs always match the variant whose poles carry the shape, which keeps the sharp
+        // part of a cut from having to be approximated by the zeros alone.
+        inline BiquadCoefficients<double> invert(const BiquadCoefficients<double>& c)
+        {
+            return { 1.0 / c.b0, c.a1 / c.b0, c.a2 / c.b0, c.b1 / c.b0, c.b2 / c.b0 };
+        }
+
+        template <typename T>
+        BiquadCoefficients<T> toPrecision(const BiquadCoefficients<double>& c)
+        {
+            return { static_cast<T>(c.b0), static_cast<T>(c.b1), static_cast<T>(c.b2),
+                     static_cast<T>(c.a1), static_cast<T>(c.a2) };
+        }
+
+        // Shelf Q for slope S, as in the bilinear shelves
+        inline double shelfQ(double A, double S)
+        {
+            return 1.0 / std::sqrt((A + 1.0 / A) * (1.0 / S - 1.0) + 2.0);
+        }
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculateMatchedPeakingEQ(T sampleRate, T freq, T Q, T gainDb)
+    {
+        const double A = std::pow(10.0, std::abs(gainDb) / 40.0);
+        const double w0 = twoPi<double> * freq / sampleRate;
+        const double q = Q;
+
+        // Boost: H(s) = (s^2 + s A / Q + 1) / (s^2 + s / (A Q) + 1), s normalised to the centre
+        const double x = pi<double> / w0;
+        const double re = (1.0 - x * x) * (1.0 - x * x);
+        const double nyquistPower = (re + (A * x / q) * (A * x / q)) / (re + (x / (A * q)) * (x / (A * q)));
+
+        const auto boost = detail::matchMagnitude(w0, A * q, w0, 1.0, A * A * A * A, nyquistPower);
+        return detail::toPrecision<T>(gainDb < 0 ? detail::invert(boost) : boost);
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculateMatchedLowShelf(T sampleRate, T freq, T gainDb, T S = 1)
+    {
+        const double A = std::pow(10.0, std::abs(gainDb) / 40.0);
+        const double w0 = twoPi<double> * freq / sampleRate;
+        const double q = detail::shelfQ(A, S);
+
+        // Boost: H(s) = A (s^2 + s sqrt(A) / Q + A) / (A s^2 + s sqrt(A) / Q + 1)
+        const double x = pi<double> / w0;
+        const double damping = A * x * x / (q * q);
+        const double nyquistPower = A * A * ((A - x * x) * (A - x * x) + damping)
+                                  / ((1.0 - A * x * x) * (1.0 - A * x * x) + damping);
+
+        const auto boost = detail::matchMagnitude(w0 / std::sqrt(A), q, w0, A * A * A * A, A * A, nyquistPower);
+        return detail::toPrecision<T>(gainDb < 0 ? detail::invert(boost) : boost);
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculateMatchedHighShelf(T sampleRate, T freq, T gainDb, T S = 1)
+    {
+        const double A = std::pow(10.0, std::abs(gainDb) / 40.0);
+        const double w0 = twoPi<double> * freq / sampleRate;
+        const double q = detail::shelfQ(A, S);
+
+        // A high shelf's poles sit below its frequency when it cuts, so here the cut is the
+        // one matched: H(s) = (s^2 + s sqrt(A) / Q + A) / (A (A s^2 + s sqrt(A) / Q + 1))
+        const double x = pi<double> / w0;
+        const double damping = A * x * x / (q * q);
+        const double nyquistPower = ((A - x * x) * (A - x * x) + damping)
+                                  / (A * A * ((1.0 - A * x * x) * (1.0 - A * x * x) + damping));
+
+        const auto cut = detail::matchMagnitude(w0 / std::sqrt(A), q, w0, 1.0, 1.0 / (A * A), nyquistPower);
+        return detail::toPrecision<T>(gainDb > 0 ? detail::invert(cut) : cut);
+    }
+
+    // K-weighting pre-filter of ITU-R BS.1770: a high shelf of about +4dB from 1.5kHz, then a
+    // high pass at 38Hz. The standard gives coefficients for 48kHz; these are its analog
+    // prototypes, re-derived for any rate.
+    template <typename T>
+    BiquadCoefficients<T> calculateKWeightingShelf(T sampleRate)
+    {
+        BiquadCoefficients<T> c;
+        T f0 = static_cast<T>(1681.97);
+        T G = static_cast<T>(3.999);
+        T Q = static_cast<T>(0.7072);
+        T K = std::tan(pi<T> * f0 / sampleRate);
+        T Vh = std::pow(static_cast<T>(10), G / 20.0f);
+        T Vb = std::pow(Vh, static_cast<T>(0.5));
+
+        T a0 = 1.0f + K / Q + K * K;
+        c.b0 = (Vh + Vb * K / Q + K * K) / a0;
+        c.b1 = 2.0f * (K * K - Vh) / a0;
+        c.b2 = (Vh - Vb * K / Q + K * K) / a0;
+        c.a1 = 2.0f * (K * K - 1.0f) / a0;
+        c.a2 = (1.0f - K / Q + K * K) / a0;
+        return c;
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculateKWeightingHighPass(T sampleRate)
+    {
+        return calculateHighPass(sampleRate, static_cast<T>(38.1355), static_cast<T>(0.5003));
+    }
+
+    // Trapezoidal state variable filter coefficients (Simper's form). The section's output mixes
+    // the input, band pass and low pass: y = m0 * x + m1 * bp + m2 * lp. Same bilinear designs
+    // as the biquads above, so the steady state responses match.
+    template <typename T>
+    struct SVFCoefficients
+    {
+        T g = 0, k = 2;
+        T m0 = 1, m1 = 0, m2 = 0;
+
+        bool isIdentity() const { return m0 == 1 && m1 == 0 && m2 == 0; }
+
+        // Same tuning, output taken straight from the input
+        SVFCoefficients withoutEffect() const { return { g, k, 1, 0, 0 }; }
+
+        bool operator==(const SVFCoefficients& other) const
+        {
+            return g == other.g && k == other.k && m0 == other.m0 && m1 == other.m1 && m2 == other.m2;
         }
+        bool operator!=(const SVFCoefficients& other) const { return !(*this == other); }
+    };
+
+    using SVFCoeffs = SVFCoefficients<float>;
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFLowPass(T sampleRate, T freq, T Q)
+    {
+        SVFCoefficients<T> c;
+        c.g = std::tan(pi<T> * freq / sampleRate);
+        c.k = 1.0f / Q;
+        c.m0 = 0.0f;
+        c.m1 = 0.0f;
+        c.m2 = 1.0f;
+        return c;
+    }
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFHighPass(T sampleRate, T freq, T Q)
+    {
+        SVFCoefficients<T> c;
+        c.g = std::tan(pi<T> * freq / sampleRate);
+        c.k = 1.0f / Q;
+        c.m0 = 1.0f;
+        c.m1 = -c.k;
+        c.m2 = -1.0f;
+        return c;
+    }
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFPeakingEQ(T sampleRate, T freq, T Q, T gainDb)
+    {
+        SVFCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        c.g = std::tan(pi<T> * freq / sampleRate);
+        c.k = 1.0f / (Q * A);
+        c.m0 = 1.0f;
+        c.m1 = c.k * (A * A - 1.0f);
+        c.m2 = 0.0f;
+        return c;
+    }
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFLowShelf(T sampleRate, T freq, T gainDb, T S = 1)
+    {
+        SVFCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        c.g = std::tan(pi<T> * freq / sampleRate) / std::sqrt(A);
+        c.k = std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
+        c.m0 = 1.0f;
+        c.m1 = c.k * (A - 1.0f);
+        c.m2 = A * A - 1.0f;
+        return c;
+    }
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFHighShelf(T sampleRate, T freq, T gainDb, T S = 1)
+    {
+        SVFCoefficients<T> c;
+        T A = std::pow(10.0f, gainDb / 40.0f);
+        c.g = std::tan(pi<T> * freq / sampleRate) * std::sqrt(A);
+        c.k = std::sqrt((A + 1.0f / A) * (1.0f / S - 1.0f) + 2.0f);
+        c.m0 = A * A;
+        c.m1 = c.k * (1.0f - A) * A;
+        c.m2 = 1.0f - A * A;
+        return c;
+    }
+
+    // Any stable biquad as an SVF: the SVF is the bilinear image of s^2 + k s + 1, so the
+    // analog section behind the digital one is recovered and split into the output mix.
+    // Lets the SVF topology run designs that weren't made for it, like the matched ones.
+    template <typename T>
+    SVFCoefficients<T> biquadToSVF(const BiquadCoefficients<T>& b)
+    {
+        const double b0 = b.b0, b1 = b.b1, b2 = b.b2, a1 = b.a1, a2 = b.a2;
+        const double dcSum = 1.0 + a1 + a2;         // 4 g^2 / (1 + k g + g^2)
+        const double nyquistSum = 1.0 - a1 + a2;    // 4 / (1 + k g + g^2)
+
+        const double g = std::sqrt(dcSum / nyquistSum);
+        const double k = 2.0 * (1.0 - a2) / (nyquistSum * g);
+
+        // Numerator of the analog section, n2 s^2 + n1 s + n0
+        const double n2 = (b0 - b1 + b2) / nyquistSum;
+        const double n1 = 2.0 * (b0 - b2) / (nyquistSum * g);
+        const double n0 = (b0 + b1 + b2) / dcSum;
+
+        SVFCoefficients<T> c;
+        c.g = static_cast<T>(g);
+        c.k = static_cast<T>(k);
+        c.m0 = static_cast<T>(n2);
+        c.m1 = static_cast<T>(n1 - n2 * k);
+        c.m2 = static_cast<T>(n0 - n2);
+        return c;
+    }
+
+    // First order (6 dB/oct) sections, as biquads with b2 = a2 = 0
+    template <typename T>
+    BiquadCoefficients<T> calculateFirstOrderLowPass(T sampleRate, T freq)
+    {
+        BiquadCoefficients<T> c;
+        T K = std::tan(pi<T> * freq / sampleRate);
+        c.b0 = K / (K + 1.0f);
+        c.b1 = c.b0;
+        c.a1 = (K - 1.0f) / (K + 1.0f);
+        return c;
+    }
+
+    template <typename T>
+    BiquadCoefficients<T> calculateFirstOrderHighPass(T sampleRate, T freq)
+    {
+        BiquadCoefficients<T> c;
+        T K = std::tan(pi<T> * freq / sampleRate);
+        c.b0 = 1.0f / (K + 1.0f);
+        c.b1 = -c.b0;
+        c.a1 = (K - 1.0f) / (K + 1.0f);
+        return c;
+    }
+
+    // First order sections on the SVF. With k = 2 both poles sit where the one-pole's is, and
+    // the mix cancels one of them.
+    template <typename T>
+    SVFCoefficients<T> calculateSVFFirstOrderLowPass(T sampleRate, T freq)
+    {
+        SVFCoefficients<T> c;
+        c.g = std::tan(pi<T> * freq / sampleRate);
+        c.k = 2.0f;
+        c.m0 = 0.0f;
+        c.m1 = 1.0f;
+        c.m2 = 1.0f;
+        return c;
+    }
+
+    template <typename T>
+    SVFCoefficients<T> calculateSVFFirstOrderHighPass(T sampleRate, T freq)
+    {
+        SVFCoefficients<T> c;
+        c.g = std::tan(pi<T> * freq / sampleRate);
+        c.k = 2.0f;
+        c.m0 = 1.0f;
+        c.m1 = -1.0f;
+        c.m2 = -1.0f;
+        return c;
+    }
+
+    // Q of each second order section in a Butterworth filter of the given order (1-4).
+    // Odd orders also have a first order section, which isn't counted here.
+    inline float calculateButterworthQ(int order, int section)
+    {
+        if (order == 3) return 1.0f;
+        if (order == 4) return section == 0 ? 0.5412f : 1.3065f;
         return 0.7071f;
     }
+
+    // Half-band low pass for 2x up and down sampling, a Kaiser windowed sinc cut off at a quarter
+    // of the rate. Of its 4K - 1 taps, the centre one is 0.5 and every other one from there is
+    // zero, so only the K at odd offsets either side are returned, nearest the centre first.
+    inline std::vector<double> calculateHalfBand(int numTaps, double attenuationDb)
+    {
+        const auto besselI0 = [] (double x)
+        {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 50; ++k)
+            {
+                term *= (x / (2 * k)) * (x / (2 * k));
+                sum += term;
+            }
+            return sum;
+        };
+
+        const double beta = 0.1102 * (attenuationDb - 8.7);
+        const double halfLength = 2.0 * numTaps;
+        std::vector<double> taps(static_cast<size_t>(numTaps));
+        for (int j = 0; j < numTaps; ++j)
+        {
+            const double offset = 2.0 * j + 1.0;
+            const double ratio = offset / halfLength;
+            const double window = besselI0(beta * std::sqrt(1.0 - ratio * ratio)) / besselI0(beta);
+            const double sinc = (j % 2 == 0 ? 1.0 : -1.0) / (pi<double> * offset);   // sin(pi t / 2) / (pi t)
+            taps[static_cast<size_t>(j)] = sinc * window;
+        }
+        return taps;
+    }
+
+    // Maximum of the last `length` values, for look-ahead detectors. A monotonic deque: every
+    // value goes in once and comes out at most once, so it costs amortised O(1) per sample
+    // whatever the length. The storage is set aside in prepare(), so processing never allocates.
+    class SlidingMaximum
+    {
+    public:
+        void prepare(int maxLength)
+        {
+            entries.assign(static_cast<size_t>(std::max(maxLength, 1)), {});
+            length = std::min(length, static_cast<int>(entries.size()));
+            reset();
+        }
+
+        void reset()
+        {
+            head = 0;
+            size = 0;
+        }
+
+        // Shorter windows drop what falls out of them on the next value; longer ones start
+        // with what is still held
+        void setLength(int newLength) { length = std::max(1, std::min(newLength, static_cast<int>(entries.size()))); }
+        int getLength() const { return length; }
+
+        // Whole blocks, in place if the pointers are the same. Interleaved values are read and
+        // written every stride places.
+        void process(const float* input, float* output, int numSamples, int stride = 1)
+        {
+            const int capacity = static_cast<int>(entries.size());
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float value = input[i * stride];
+
+                // Values that have left the window sit at the front
+                while (size > 0 && time - entries[static_cast<size_t>(head)].time >= static_cast<uint32_t>(length))
+                {
+                    head = head + 1 < capacity ? head + 1 : 0;
+                    --size;
+                }
+
+                // Any that are no larger than the new one can never be the maximum again
+                while (size > 0 && entries[static_cast<size_t>(wrap(head + size - 1, capacity))].value <= value)
+                    --size;
+
+                entries[static_cast<size_t>(wrap(head + size, capacity))] = { time++, value };
+                ++size;
+                output[i * stride] = entries[static_cast<size_t>(head)].value;
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            uint32_t time = 0;   // Wraps, only differences are compared
+            float value = 0.0f;
+        };
+
+        static int wrap(int index, int capacity) { return index < capacity ? index : index - capacity; }
+
+        std::vector<Entry> entries;   // Ring of up to the longest length, decreasing from head
+        int head = 0;
+        int size = 0;
+        int length = 1;
+        uint32_t time = 0;
+    };
+
+    // The same maximum over SIMD registers, lane by lane (van Herk/Gil-Werman). Values go in
+    // blocks of the window's length; the maximum is the running one of the current block against
+    // the suffix maximum of the last, worked out as each block completes. Nothing branches on a
+    // value, so every lane takes the same path, at about three max operations per register.
+    template <typename Register>
+    class LaneSlidingMaximum
+    {
+    public:
+        void prepare(int maxLength)
+        {
+            values.assign(static_cast<size_t>(std::max(maxLength, 1)), Register {});
+            suffixes.assign(values.size(), Register {});
+            length = std::min(length, static_cast<int>(values.size()));
+            reset();
+        }
+
+        void reset()
+        {
+            std::fill(suffixes.begin(), suffixes.end(), Register {});
+            running = Register {};
+            position = 0;
+        }
+
+        // Starts over, as the window is only changed along with the delay it covers
+        void setLength(int newLength)
+        {
+            length = std::max(1, std::min(newLength, static_cast<int>(values.size())));
+            reset();
+        }
+        int getLength() const { return length; }
+
+        // Whole blocks, in place if the pointers are the same, every stride registers
+        void process(const Register* input, Register* output, int numSamples, int stride = 1)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto value = input[i * stride];
+                values[static_cast<size_t>(position)] = value;
+                running = position == 0 ? value : Register::max(running, value);
+
+                if (position + 1 < length)
+                {
+                    output[i * stride] = Register::max(suffixes[static_cast<size_t>(position + 1)], running);
+                    ++position;
+                    continue;
+                }
+
+                // The block is complete, and its suffixes serve the next one
+                output[i * stride] = running;
+                auto suffix = value;
+                suffixes[static_cast<size_t>(length - 1)] = suffix;
+                for (int k = length - 2; k >= 0; --k)
+                    suffixes[static_cast<size_t>(k)] = suffix = Register::max(values[static_cast<size_t>(k)], suffix);
+                position = 0;
+            }
+        }
+
+    private:
+        std::vector<Register> values;     // The current block so far
+        std::vector<Register> suffixes;   // Maximum from each place to the end of the last block
+        Register running {};
+        int position = 0;
+        int length = 1;
+    };
+
+    // Lock-free hand-off of the latest value from one producer thread to one consumer thread.
+    // Neither side ever blocks, intermediate values may be skipped.
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        // Producer: fill the write buffer, then publish it
+        T& getWriteBuffer() { return buffers[writeIndex]; }
+
+        void publish()
+        {
+            writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Consumer: returns true if a newer value was published since the last update
+        bool update()
+        {
+            if ((middle.load(std::memory_order_acquire) & FRESH) == 0)
+                return false;
+
+            readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+
+        const T& getReadBuffer() const { return buffers[readIndex]; }
+
+    private:
+        static constexpr int INDEX_MASK = 3;
+        static constexpr int FRESH = 4;
+
+        std::array<T, 3> buffers {};
+        int writeIndex = 0;
+        int readIndex = 1;
+        std::atomic<int> middle { 2 };
+    };
 }
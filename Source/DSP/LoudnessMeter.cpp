@@ -3,6 +3,15 @@
 #include <numeric>
 #include <cmath>
 
+namespace
+{
+    // BS.1770 loudness of a K-weighted mean square, floored at -100dB
+    float meanSquareToLUFS(float meanSquare)
+    {
+        return -0.691f + 3.01029996f * DSPUtils::fastLog2(std::max(meanSquare, 1e-10f));
+    }
+}
+
 LoudnessMeter::LoudnessMeter()
 {
 }
@@ -13,31 +22,9 @@ void LoudnessMeter::prepare(double sampleRate, int samplesPerBlock)
     currentBlockSize = samplesPerBlock;
 
     // Calculate K-weighting filter coefficients (ITU-R BS.1770-4)
-    // Stage 1: High shelf boosting high frequencies
-    // f0 = 1681.97Hz, gain = +3.999dB, Q = 0.7072
-    {
-        float f0 = 1681.97f;
-        float G = 3.999f;
-        float Q = 0.7072f;
-        float K = std::tan(DSPUtils::PI * f0 / static_cast<float>(sampleRate));
-        float Vh = std::pow(10.0f, G / 20.0f);
-        float Vb = std::pow(Vh, 0.5f);
-
-        float a0 = 1.0f + K / Q + K * K;
-        kShelfCoeffs.b0 = (Vh + Vb * K / Q + K * K) / a0;
-        kShelfCoeffs.b1 = 2.0f * (K * K - Vh) / a0;
-        kShelfCoeffs.b2 = (Vh - Vb * K / Q + K * K) / a0;
-        kShelfCoeffs.a1 = 2.0f * (K * K - 1.0f) / a0;
-        kShelfCoeffs.a2 = (1.0f - K / Q + K * K) / a0;
-    }
-
-    // Stage 2: High-pass filter
-    // f0 = 38.1355Hz, Q = 0.5003
-    {
-        float f0 = 38.1355f;
-        float Q = 0.5003f;
-        kHpfCoeffs = DSPUtils::calculateHighPass(static_cast<float>(sampleRate), f0, Q);
-    }
+    // Stage 1: High shelf boosting high frequencies, Stage 2: High-pass filter
+    kShelfCoeffs = DSPUtils::calculateKWeightingShelf(static_cast<float>(sampleRate));
+    kHpfCoeffs = DSPUtils::calculateKWeightingHighPass(static_cast<float>(sampleRate));
 
     // Calculate buffer sizes
     momentarySamples = static_cast<int>(sampleRate * 0.4);   // 400ms
@@ -126,7 +113,7 @@ void LoudnessMeter::calculateTruePeak(const float* input, int numSamples, int ch
     }
 
     float currentTruePeak = truePeakLevel.load();
-    float peakDb = DSPUtils::linearToDecibels(maxPeak);
+    float peakDb = DSPUtils::fastLinearToDecibels(maxPeak);
     if (peakDb > currentTruePeak)
         truePeakLevel.store(peakDb);
 }
@@ -179,7 +166,7 @@ void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer)
             maxPeak = std::max(maxPeak, std::abs(data[i]));
     }
     float currentPeak = peakLevel.load();
-    float newPeakDb = DSPUtils::linearToDecibels(maxPeak);
+    float newPeakDb = DSPUtils::fastLinearToDecibels(maxPeak);
     if (newPeakDb > currentPeak)
         peakLevel.store(newPeakDb);
     else
@@ -237,7 +224,7 @@ void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer)
     if (currentBlockSamples >= samplesPerBlock100ms)
     {
         float blockMeanSquare = currentBlockSum / currentBlockSamples;
-        float blockLUFS = -0.691f + 10.0f * std::log10(std::max(blockMeanSquare, 1e-10f));
+        float blockLUFS = meanSquareToLUFS(blockMeanSquare);
 
         // Store for integrated calculation (with gating)
         if (blockLUFS > ABSOLUTE_GATE)
@@ -263,7 +250,7 @@ void LoudnessMeter::updateMomentary()
         sum += val;
 
     float meanSquare = sum / momentaryBuffer.size();
-    float lufs = -0.691f + 10.0f * std::log10(std::max(meanSquare, 1e-10f));
+    float lufs = meanSquareToLUFS(meanSquare);
     momentaryLUFS.store(lufs);
 }
 
@@ -276,7 +263,7 @@ void LoudnessMeter::updateShortTerm()
         sum += val;
 
     float meanSquare = sum / shortTermBuffer.size();
-    float lufs = -0.691f + 10.0f * std::log10(std::max(meanSquare, 1e-10f));
+    float lufs = meanSquareToLUFS(meanSquare);
     shortTermLUFS.store(lufs);
 }
 
@@ -293,17 +280,18 @@ void LoudnessMeter::updateIntegrated()
     for (float ms : integratedBlocks)
         sumAll += ms;
     float ungatedMean = sumAll / integratedBlocks.size();
-    float ungatedLUFS = -0.691f + 10.0f * std::log10(std::max(ungatedMean, 1e-10f));
+    float ungatedLUFS = meanSquareToLUFS(ungatedMean);
 
     // Second pass: apply relative gate
+    // Compared as mean squares, so the history doesn't need a log per block on every update
     float relativeGate = ungatedLUFS + RELATIVE_GATE;
+    float relativeGateMeanSquare = std::pow(10.0f, (relativeGate + 0.691f) / 10.0f);
     float gatedSum = 0.0f;
     int gatedCount = 0;
 
     for (float ms : integratedBlocks)
     {
-        float blockLUFS = -0.691f + 10.0f * std::log10(std::max(ms, 1e-10f));
-        if (blockLUFS > relativeGate)
+        if (ms > relativeGateMeanSquare)
         {
             gatedSum += ms;
             gatedCount++;
@@ -313,7 +301,7 @@ void LoudnessMeter::updateIntegrated()
     if (gatedCount > 0)
     {
         float gatedMean = gatedSum / gatedCount;
-        float intLUFS = -0.691f + 10.0f * std::log10(std::max(gatedMean, 1e-10f));
+        float intLUFS = meanSquareToLUFS(gatedMean);
         integratedLUFS.store(intLUFS);
 
         // Calculate loudness range (LRA)
@@ -1,44 +1,141 @@
 #include "MasteringCompressor.h"
 
-MasteringCompressor::MasteringCompressor()
+float MasteringCompressorBase::getDefaultCrossoverFrequency(int index)
 {
+    static constexpr std::array<float, MAX_CROSSOVERS> defaults { 120.0f, 600.0f, 3000.0f, 10000.0f };
+    return defaults[static_cast<size_t>(std::clamp(index, 0, MAX_CROSSOVERS - 1))];
+}
+
+int MasteringCompressorBase::getOversamplingStages(int factor)
+{
+    int stages = 0;
+    while (stages < MAX_OVERSAMPLING_STAGES && (2 << stages) <= factor)
+        ++stages;
+    return stages;
+}
+
+int MasteringCompressorBase::getOversamplingLatency(int factor)
+{
+    static_assert((4 * HALF_BAND_TAPS[MAX_OVERSAMPLING_STAGES - 1]) % MAX_OVERSAMPLING == 0,
+                  "The last stage's latency must come to whole samples at the base rate");
+
+    // 2K each way at the stage's upper rate
+    int latency = 0;
+    for (int stage = 0; stage < getOversamplingStages(factor); ++stage)
+        latency += (4 * HALF_BAND_TAPS[static_cast<size_t>(stage)]) >> (stage + 1);
+    return latency;
+}
+
+template <typename SampleType>
+MasteringCompressor<SampleType>::MasteringCompressor()
+{
+    for (int i = 0; i < MAX_CROSSOVERS; ++i)
+        crossoverFrequencies[static_cast<size_t>(i)] = getDefaultCrossoverFrequency(i);
+
     updateCoefficients();
+    updateAutoReleaseTable();
+    updateGainTable();
+    updateCrossovers();
+    updateBandCoefficients();
+
+    for (int stage = 0; stage < MAX_OVERSAMPLING_STAGES; ++stage)
+    {
+        for (const double tap : DSPUtils::calculateHalfBand(HALF_BAND_TAPS[static_cast<size_t>(stage)], HALF_BAND_ATTENUATION_DB))
+        {
+            upTaps[static_cast<size_t>(stage)].push_back(Register::expand(static_cast<SampleType>(2.0 * tap)));
+            downTaps[static_cast<size_t>(stage)].push_back(Register::expand(static_cast<SampleType>(tap)));
+        }
+    }
 }
 
-void MasteringCompressor::prepare(double sampleRate, int samplesPerBlock)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::prepare(double sampleRate, int samplesPerBlock, int numChannels)
 {
     currentSampleRate = sampleRate;
-    currentBlockSize = samplesPerBlock;
+    currentBlockSize = std::max(samplesPerBlock, 1);
+    numPreparedChannels = std::clamp(numChannels, 1, MAX_CHANNELS);
+
+    const auto numGroups = static_cast<size_t>((numPreparedChannels + LANES - 1) / LANES);
+    const auto numFrames = numGroups * static_cast<size_t>(currentBlockSize);
+    inputFrames.assign(numFrames, Register::expand(0.0f));
+    sidechainFrames.assign(numFrames, Register::expand(0.0f));
+    gainFrames.assign(numFrames, Register::expand(0.0f));
+    peakLevels.assign(static_cast<size_t>(currentBlockSize), 0.0f);
+    gainTableIndices.assign(static_cast<size_t>(currentBlockSize), 0);
+    detectorLevels.assign(static_cast<size_t>(numPreparedChannels * currentBlockSize), 0.0f);
+
+    // Room for the longest look-ahead and the most oversampling, so changing them never allocates
+    maxLookaheadSamples = static_cast<int>(std::ceil(MAX_LOOKAHEAD_MS * 0.001 * sampleRate));
+    maxDryDelaySamples = maxLookaheadSamples + getOversamplingLatency(MAX_OVERSAMPLING);
+    wetDelay.assign(numGroups * static_cast<size_t>(maxLookaheadSamples), Register::expand(0.0f));
+    dryDelay.assign(static_cast<size_t>(numPreparedChannels * maxDryDelaySamples), 0.0f);
+    peakWindow.prepare(maxLookaheadSamples + 1);
+    for (int ch = 0; ch < numPreparedChannels; ++ch)
+        levelWindows[static_cast<size_t>(ch)].prepare(maxLookaheadSamples + 1);
+
+    // Multiband scratch and state, for the most bands whatever the current count
+    const auto channelStates = static_cast<size_t>(MAX_BAND_REGISTERS * MAX_CROSSOVERS * SECTIONS_PER_CROSSOVER);
+    bandStates.resize(2 * static_cast<size_t>(numPreparedChannels) * channelStates);
+    dryAllPassStates.resize(numGroups * MAX_CROSSOVERS);
+    bandFrames.assign(static_cast<size_t>(numPreparedChannels * MAX_BAND_REGISTERS * currentBlockSize), Register::expand(0.0f));
+    sidechainBands.assign(static_cast<size_t>(2 * MAX_BAND_REGISTERS * currentBlockSize), Register::expand(0.0f));
+    bandLevels.assign(static_cast<size_t>(numPreparedChannels * MAX_LEVEL_REGISTERS * currentBlockSize), LevelRegister::expand(0.0f));
+    bandPeaks.assign(static_cast<size_t>(MAX_LEVEL_REGISTERS * currentBlockSize), LevelRegister::expand(0.0f));
+    bandWindows.resize(static_cast<size_t>(numPreparedChannels * MAX_LEVEL_REGISTERS));
+    for (auto& window : bandWindows)
+        window.prepare(maxLookaheadSamples + 1);
+
+    // Oversampling state and scratch, for every stage whatever the current factor. The first
+    // stage has the most taps.
+    for (int stage = 0; stage < MAX_OVERSAMPLING_STAGES; ++stage)
+    {
+        const auto taps = static_cast<size_t>(HALF_BAND_TAPS[static_cast<size_t>(stage)]);
+        upHistories[static_cast<size_t>(stage)].resize(numGroups * (2 * taps - 1));
+        evenHistories[static_cast<size_t>(stage)].resize(numGroups * taps);
+        oddHistories[static_cast<size_t>(stage)].resize(numGroups * 2 * taps);
+    }
+    oversampledFrames.assign(numFrames * MAX_OVERSAMPLING, Register::expand(0.0f));
+    oversamplingScratch.assign(static_cast<size_t>(currentBlockSize * MAX_OVERSAMPLING / 2), Register::expand(0.0f));
+    halfBandBuffer.assign(static_cast<size_t>(3 * HALF_BAND_TAPS[0] + currentBlockSize * MAX_OVERSAMPLING), Register::expand(0.0f));
+
     updateCoefficients();
+    updateAutoReleaseTable();
+    updateCrossovers();
+    updateBandCoefficients();
+    updateDelays();
     reset();
 }
 
-void MasteringCompressor::reset()
+template <typename SampleType>
+void MasteringCompressor<SampleType>::reset()
 {
-    envelopeL = 0.0f;
-    envelopeR = 0.0f;
-    gainReductionL = 0.0f;
-    gainReductionR = 0.0f;
+    envelopes.fill(0.0f);
     autoReleaseEnvelope = 0.0f;
     saturationState = 0.0f;
     currentGainReduction.store(0.0f);
 
     // Reset sidechain HPF states
-    scHpfStateL = {};
-    scHpfStateR = {};
+    scHpfStates.fill({});
+
+    clearBands();
+    clearDelays();
 }
 
-void MasteringCompressor::updateCoefficients()
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateCoefficients()
 {
     attackCoeff = DSPUtils::calculateCoefficient(currentSampleRate, attackMs);
     releaseCoeff = DSPUtils::calculateCoefficient(currentSampleRate, releaseMs);
+    autoReleaseSmoothCoeff = DSPUtils::calculateCoefficient(currentSampleRate, AUTO_RELEASE_SMOOTH_MS);
     makeupLinear = DSPUtils::decibelsToLinear(makeupGain);
 
     // Update sidechain HPF
-    scHpfCoeffs = DSPUtils::calculateHighPass(static_cast<float>(currentSampleRate), sidechainHPFFreq, 0.707f);
+    scHpfCoeffs = DSPUtils::calculateHighPass<SampleType>(static_cast<SampleType>(currentSampleRate), sidechainHPFFreq, 0.707f);
 }
 
-float MasteringCompressor::computeGain(float inputDb)
+// The static curve, by how far the level is over the threshold
+template <typename SampleType>
+float MasteringCompressor<SampleType>::computeGainReduction(float overDb) const
 {
     float gainReductionDb = 0.0f;
 
@@ -46,59 +143,268 @@ float MasteringCompressor::computeGain(float inputDb)
     {
         // Soft knee compression
         float halfKnee = kneeDb / 2.0f;
-        float kneeStart = threshold - halfKnee;
-        float kneeEnd = threshold + halfKnee;
 
-        if (inputDb < kneeStart)
+        if (overDb < -halfKnee)
         {
             // Below knee - no compression
             gainReductionDb = 0.0f;
         }
-        else if (inputDb > kneeEnd)
+        else if (overDb > halfKnee)
         {
             // Above knee - full compression
-            float overDb = inputDb - threshold;
             gainReductionDb = overDb * (1.0f - 1.0f / ratio);
         }
         else
         {
             // In knee - gradual transition
-            float kneeRatio = (inputDb - kneeStart) / kneeDb;
+            float kneeRatio = (overDb + halfKnee) / kneeDb;
             float currentRatio = 1.0f + (ratio - 1.0f) * kneeRatio * kneeRatio;
-            float overDb = inputDb - threshold;
             gainReductionDb = overDb * (1.0f - 1.0f / currentRatio);
         }
     }
     else
     {
         // Hard knee compression
-        if (inputDb > threshold)
-        {
-            float overDb = inputDb - threshold;
+        if (overDb > 0.0f)
             gainReductionDb = overDb * (1.0f - 1.0f / ratio);
-        }
     }
 
     return gainReductionDb;
 }
 
-float MasteringCompressor::computeAutoRelease(float inputLevel)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateGainTable()
+{
+    for (int i = 0; i < GAIN_TABLE_SIZE; ++i)
+        gainTable[static_cast<size_t>(i)] = -computeGainReduction(GAIN_TABLE_MIN_DB + static_cast<float>(i) / GAIN_TABLE_POINTS_PER_DB);
+
+    for (int i = 0; i < GAIN_TABLE_SIZE - 1; ++i)
+        gainTableSlope[static_cast<size_t>(i)] = gainTable[static_cast<size_t>(i + 1)] - gainTable[static_cast<size_t>(i)];
+}
+
+// Envelope levels to linear gains, in place. Each stage runs over the whole block with nothing
+// carried between samples, so they vectorise. Gain reduction only grows with the level, so the
+// most of it, which is returned, comes from the loudest level.
+template <typename SampleType>
+float MasteringCompressor<SampleType>::levelsToGains(float* levels, int numSamples, float loudest)
+{
+    DSPUtils::fastLinearToDecibels(levels, levels, numSamples);
+
+    // One interpolated lookup per sample. The index is clamped rather than the position, so
+    // past either end the fraction runs on and extends the end segment. Indices and fractions
+    // are worked out in a pass of their own, which vectorises; without gathers the table reads
+    // can't, and in the same loop they'd hold the arithmetic back too.
+    const float offset = -(threshold + GAIN_TABLE_MIN_DB) * GAIN_TABLE_POINTS_PER_DB;
+    int* indices = gainTableIndices.data();
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float position = levels[i] * GAIN_TABLE_POINTS_PER_DB + offset;
+        const int index = std::min(std::max(static_cast<int>(position), 0), GAIN_TABLE_SIZE - 2);
+        indices[i] = index;
+        levels[i] = position - static_cast<float>(index);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+        levels[i] = gainTable[static_cast<size_t>(indices[i])] + levels[i] * gainTableSlope[static_cast<size_t>(indices[i])];
+
+    DSPUtils::fastDecibelsToLinear(levels, levels, numSamples);
+    return computeGainReduction(DSPUtils::fastLinearToDecibels(loudest) - threshold);
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateDelays()
+{
+    lookaheadSamples = std::min(juce::roundToInt(lookaheadMs * 0.001 * currentSampleRate), maxLookaheadSamples);
+    dryDelaySamples = lookaheadSamples + getSaturationLatency();
+
+    // The window covers the sample coming out of the delay and every one behind it
+    peakWindow.setLength(lookaheadSamples + 1);
+    for (auto& window : levelWindows)
+        window.setLength(lookaheadSamples + 1);
+    for (auto& window : bandWindows)
+        window.setLength(lookaheadSamples + 1);
+
+    // Audio left in the delays was lined up for the old lengths
+    clearDelays();
+}
+
+// The look-ahead and dry delays, and everything clearHistories() covers
+template <typename SampleType>
+void MasteringCompressor<SampleType>::clearDelays()
+{
+    std::fill(wetDelay.begin(), wetDelay.end(), Register::expand(0.0f));
+    std::fill(dryDelay.begin(), dryDelay.end(), SampleType(0));
+    lookaheadPosition = 0;
+    dryDelayPosition = 0;
+    clearHistories();
+}
+
+// The detectors' look-ahead windows and the half-band filters' histories
+template <typename SampleType>
+void MasteringCompressor<SampleType>::clearHistories()
+{
+    const auto zero = Register::expand(0.0f);
+    peakWindow.reset();
+    for (auto& window : levelWindows)
+        window.reset();
+    for (auto& window : bandWindows)
+        window.reset();
+
+    for (auto* histories : { &upHistories, &evenHistories, &oddHistories })
+        for (auto& history : *histories)
+            std::fill(history.begin(), history.end(), zero);
+}
+
+template <typename SampleType>
+int MasteringCompressor<SampleType>::getSaturationLatency() const
+{
+    return getOversamplingLatency(1 << oversamplingStages);
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateCrossovers()
+{
+    // Butterworth sections at Q = 1/sqrt(2): two make a Linkwitz-Riley low or high pass, and the
+    // all pass with the same poles is what the two add up to. Lanes past the last band are
+    // silenced, so they add nothing to the levels or the sum.
+    const auto rate = static_cast<SampleType>(currentSampleRate);
+    const auto q = static_cast<SampleType>(1.0 / std::sqrt(2.0));
+    const DSPUtils::BiquadCoefficients<SampleType> identity;
+    const DSPUtils::BiquadCoefficients<SampleType> silence { 0, 0, 0, 0, 0 };
+    float lowest = 20.0f;
+
+    for (int crossover = 0; crossover < MAX_CROSSOVERS; ++crossover)
+    {
+        const float freq = std::min(std::max(crossoverFrequencies[static_cast<size_t>(crossover)], lowest),
+                                    static_cast<float>(currentSampleRate * 0.45));
+        lowest = freq;
+
+        const auto lowPass = DSPUtils::calculateLowPass<SampleType>(rate, static_cast<SampleType>(freq), q);
+        const auto highPass = DSPUtils::calculateHighPass<SampleType>(rate, static_cast<SampleType>(freq), q);
+        const auto allPass = DSPUtils::calculateAllPass<SampleType>(rate, static_cast<SampleType>(freq), q);
+        crossoverAllPasses[static_cast<size_t>(crossover)] = { Register::expand(allPass.b0), Register::expand(allPass.b1),
+                                                               Register::expand(allPass.b2), Register::expand(allPass.a1),
+                                                               Register::expand(allPass.a2) };
+
+        for (int band = 0; band < MAX_BAND_REGISTERS * LANES; ++band)
+        {
+            for (int section = 0; section < SECTIONS_PER_CROSSOVER; ++section)
+            {
+                const auto& c = band >= numBands ? silence
+                              : band < crossover ? (section == 0 ? allPass : identity)
+                              : band == crossover ? lowPass : highPass;
+                auto& s = crossoverSections[static_cast<size_t>(sectionIndex(band / LANES, crossover, section))];
+                const auto lane = static_cast<size_t>(band % LANES);
+                s.b0.set(lane, c.b0);
+                s.b1.set(lane, c.b1);
+                s.b2.set(lane, c.b2);
+                s.a1.set(lane, c.a1);
+                s.a2.set(lane, c.a2);
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateBandCoefficients()
+{
+    for (int band = 0; band < MAX_LEVEL_REGISTERS * LEVEL_LANES; ++band)
+    {
+        const auto index = static_cast<size_t>(band / LEVEL_LANES);
+        const auto lane = static_cast<size_t>(band % LEVEL_LANES);
+        if (band < MAX_BANDS)
+        {
+            const auto& settings = bandSettings[static_cast<size_t>(band)];
+            bandThresholds[index].set(lane, settings.thresholdDb);
+            bandSlopes[index].set(lane, 1.0f - 1.0f / settings.ratio);
+            bandAttackCoeffs[index].set(lane, DSPUtils::calculateCoefficient(currentSampleRate, settings.attackMs));
+            bandReleaseCoeffs[index].set(lane, DSPUtils::calculateCoefficient(currentSampleRate, settings.releaseMs));
+        }
+        else
+        {
+            bandThresholds[index].set(lane, 0.0f);
+            bandSlopes[index].set(lane, 0.0f);
+            bandAttackCoeffs[index].set(lane, 1.0f);
+            bandReleaseCoeffs[index].set(lane, 1.0f);
+        }
+    }
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::clearBands()
+{
+    const auto zero = Register::expand(0.0f);
+    std::fill(bandStates.begin(), bandStates.end(), RegisterBiquadState { zero, zero, zero, zero });
+    for (auto& envelopes : bandEnvelopes)
+        envelopes.fill(LevelRegister::expand(0.0f));
+    std::fill(dryAllPassStates.begin(), dryAllPassStates.end(), RegisterBiquadState { zero, zero, zero, zero });
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::delayPaths(SampleType* const* data, int numChannels, int numSamples)
+{
+    // Each sample is swapped with the one that went in a delay's length ago, a run at a time up
+    // to where the delay wraps. The wet path is delayed by the look-ahead as frames, the dry one
+    // in the channels by that and the saturation's latency.
+    const auto delayRuns = [numSamples] (auto* samples, auto* delay, int length, int position)
+    {
+        for (int done = 0; done < numSamples;)
+        {
+            const int run = std::min(numSamples - done, length - position);
+            std::swap_ranges(samples + done, samples + done + run, delay + position);
+            done += run;
+            position += run;
+            if (position == length)
+                position = 0;
+        }
+    };
+
+    if (lookaheadSamples > 0)
+    {
+        const int numGroups = (numChannels + LANES - 1) / LANES;
+        for (int group = 0; group < numGroups; ++group)
+            delayRuns(inputFrames.data() + group * currentBlockSize, wetDelay.data() + group * maxLookaheadSamples,
+                      lookaheadSamples, lookaheadPosition);
+        lookaheadPosition = (lookaheadPosition + numSamples) % lookaheadSamples;
+    }
+
+    if (dryDelaySamples > 0)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            delayRuns(data[ch], dryDelay.data() + ch * maxDryDelaySamples, dryDelaySamples, dryDelayPosition);
+        dryDelayPosition = (dryDelayPosition + numSamples) % dryDelaySamples;
+    }
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::updateAutoReleaseTable()
+{
+    // Release time falls linearly from the slowest to the fastest as the smoothed level goes
+    // from 0 to full scale
+    for (int i = 0; i <= AUTO_RELEASE_TABLE_SEGMENTS; ++i)
+    {
+        const float level = static_cast<float>(i) / AUTO_RELEASE_TABLE_SEGMENTS;
+        const float releaseTime = AUTO_RELEASE_MAX_MS - (AUTO_RELEASE_MAX_MS - AUTO_RELEASE_MIN_MS) * level;
+        autoReleaseTable[static_cast<size_t>(i)] = DSPUtils::calculateCoefficient(currentSampleRate, releaseTime);
+    }
+}
+
+template <typename SampleType>
+float MasteringCompressor<SampleType>::computeAutoRelease(float inputLevel)
 {
     // Program-dependent release time
     // Higher input levels = faster release, lower levels = slower release
-    float minRelease = 50.0f;
-    float maxRelease = 500.0f;
+    autoReleaseEnvelope += autoReleaseSmoothCoeff * (inputLevel - autoReleaseEnvelope);
 
-    // Smooth the input level for auto-release calculation
-    float smoothCoeff = DSPUtils::calculateCoefficient(currentSampleRate, 100.0f);
-    autoReleaseEnvelope += smoothCoeff * (inputLevel - autoReleaseEnvelope);
-
-    // Map envelope to release time
-    float releaseTime = maxRelease - (maxRelease - minRelease) * std::min(1.0f, autoReleaseEnvelope);
-    return DSPUtils::calculateCoefficient(currentSampleRate, releaseTime);
+    const float position = std::min(1.0f, autoReleaseEnvelope) * AUTO_RELEASE_TABLE_SEGMENTS;
+    const int index = std::min(static_cast<int>(position), AUTO_RELEASE_TABLE_SEGMENTS - 1);
+    const float from = autoReleaseTable[static_cast<size_t>(index)];
+    const float to = autoReleaseTable[static_cast<size_t>(index + 1)];
+    return from + (position - static_cast<float>(index)) * (to - from);
 }
 
-void MasteringCompressor::applySaturation(float& sample, Mode mode)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::applySaturation(SampleType& sample, Mode mode)
 {
     switch (mode)
     {
@@ -114,7 +420,7 @@ void MasteringCompressor::applySaturation(float& sample, Mode mode)
         case Mode::Punch:
             // Transient enhancement - asymmetric soft clip
             {
-                float x = sample * 1.2f;
+                SampleType x = sample * 1.2f;
                 if (x > 0)
                     sample = std::tanh(x) * 0.95f;
                 else
@@ -126,7 +432,7 @@ void MasteringCompressor::applySaturation(float& sample, Mode mode)
             // Tube-style saturation with slight frequency-dependent behavior
             {
                 float drive = 1.3f;
-                float x = sample * drive;
+                SampleType x = sample * drive;
                 // Asymmetric soft saturation
                 if (x > 0)
                     sample = x / (1.0f + std::abs(x * 0.5f));
@@ -134,244 +440,884 @@ void MasteringCompressor::applySaturation(float& sample, Mode mode)
                     sample = x / (1.0f + std::abs(x * 0.7f));
 
                 // Add subtle second harmonic
-                saturationState = saturationState * 0.99f + sample * 0.01f;
+                saturationState = saturationState * saturationSmoothing + sample * (1 - saturationSmoothing);
                 sample = sample + saturationState * 0.02f;
             }
             break;
     }
 }
 
-void MasteringCompressor::process(juce::AudioBuffer<float>& buffer)
+// Saturation at the oversampled rate. Each group goes up through the stages, alternating between
+// the scratch and its own oversampled frames so the last lands in the frames; then every channel
+// is saturated in the usual order and the groups come back down the same way.
+template <typename SampleType>
+void MasteringCompressor<SampleType>::saturateOversampled(int numChannels, int numSamples)
+{
+    const int numGroups = (numChannels + LANES - 1) / LANES;
+    const int groupFrames = currentBlockSize * MAX_OVERSAMPLING;
+    const int factor = 1 << oversamplingStages;
+    const auto stageFrames = [this, groupFrames] (int group, bool scratch)
+    {
+        return scratch ? oversamplingScratch.data() : oversampledFrames.data() + group * groupFrames;
+    };
+
+    for (int group = 0; group < numGroups; ++group)
+    {
+        const Register* source = inputFrames.data() + group * currentBlockSize;
+        for (int stage = 0, length = numSamples; stage < oversamplingStages; ++stage, length *= 2)
+        {
+            auto* destination = stageFrames(group, (oversamplingStages - 1 - stage) % 2 != 0);
+            upsample(stage, group, source, destination, length);
+            source = destination;
+        }
+    }
+
+    auto* samples = reinterpret_cast<SampleType*>(oversampledFrames.data());
+    if (currentMode != Mode::Clean)
+        for (int i = 0; i < numSamples * factor; ++i)
+            for (int ch = 0; ch < numChannels; ++ch)
+                applySaturation(samples[((ch / LANES) * groupFrames + i) * LANES + ch % LANES], currentMode);
+
+    for (int group = 0; group < numGroups; ++group)
+    {
+        const Register* source = stageFrames(group, false);
+        for (int stage = oversamplingStages - 1; stage >= 0; --stage)
+        {
+            auto* destination = stage == 0 ? inputFrames.data() + group * currentBlockSize
+                                           : stageFrames(group, (oversamplingStages - 1 - stage) % 2 == 0);
+            downsample(stage, group, source, destination, numSamples << stage);
+            source = destination;
+        }
+    }
+}
+
+// Twice the rate through a stage's half-band. Every other output is the input K samples back,
+// where the centre tap lands; the ones between take the K taps either side.
+template <typename SampleType>
+void MasteringCompressor<SampleType>::upsample(int stage, int group, const Register* input, Register* output, int numSamples)
 {
-    if (bypassed) return;
+    const int taps = HALF_BAND_TAPS[static_cast<size_t>(stage)];
+    const int historyLength = 2 * taps - 1;
+    auto* history = upHistories[static_cast<size_t>(stage)].data() + group * historyLength;
+    const auto* coefficients = upTaps[static_cast<size_t>(stage)].data();
+    auto* x = halfBandBuffer.data();
+    std::copy_n(history, historyLength, x);
+    std::copy_n(input, numSamples, x + historyLength);
+
+    // A tap at a time over the block, so the sums don't wait on each other
+    for (int i = 0; i < numSamples; ++i)
+    {
+        output[2 * i] = x[i + taps - 1];
+        output[2 * i + 1] = coefficients[0] * (x[i + taps] + x[i + taps - 1]);
+    }
+
+    for (int j = 1; j < taps; ++j)
+        for (int i = 0; i < numSamples; ++i)
+            output[2 * i + 1] += coefficients[j] * (x[i + taps + j] + x[i + taps - 1 - j]);
+
+    std::copy_n(x + numSamples, historyLength, history);
+}
+
+// Half the rate through the same half-band, working out only the outputs that are kept. The even
+// inputs meet the centre tap and the odd ones the K either side. numSamples is the output count.
+template <typename SampleType>
+void MasteringCompressor<SampleType>::downsample(int stage, int group, const Register* input, Register* output, int numSamples)
+{
+    const int taps = HALF_BAND_TAPS[static_cast<size_t>(stage)];
+    auto* evenHistory = evenHistories[static_cast<size_t>(stage)].data() + group * taps;
+    auto* oddHistory = oddHistories[static_cast<size_t>(stage)].data() + group * 2 * taps;
+    const auto* coefficients = downTaps[static_cast<size_t>(stage)].data();
+    auto* even = halfBandBuffer.data();
+    auto* odd = even + taps + numSamples;
+    std::copy_n(evenHistory, taps, even);
+    std::copy_n(oddHistory, 2 * taps, odd);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        even[taps + i] = input[2 * i];
+        odd[2 * taps + i] = input[2 * i + 1];
+    }
 
-    const int numChannels = buffer.getNumChannels();
+    const auto centre = Register::expand(static_cast<SampleType>(0.5));
+    for (int i = 0; i < numSamples; ++i)
+        output[i] = centre * even[i] + coefficients[0] * (odd[i + taps] + odd[i + taps - 1]);
+
+    for (int j = 1; j < taps; ++j)
+        for (int i = 0; i < numSamples; ++i)
+            output[i] += coefficients[j] * (odd[i + taps + j] + odd[i + taps - 1 - j]);
+
+    std::copy_n(even + numSamples, taps, evenHistory);
+    std::copy_n(odd + numSamples, 2 * taps, oddHistory);
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::process(juce::AudioBuffer<SampleType>& buffer)
+{
+    const int numChannels = std::min(buffer.getNumChannels(), numPreparedChannels);
     const int numSamples = buffer.getNumSamples();
 
-    if (numChannels < 1) return;
+    if (numChannels < 1 || inputFrames.empty()) return;
 
     // Calculate input level for metering
     float inLevel = 0.0f;
     for (int ch = 0; ch < numChannels; ++ch)
-        inLevel = std::max(inLevel, buffer.getMagnitude(ch, 0, numSamples));
+        inLevel = std::max(inLevel, static_cast<float>(buffer.getMagnitude(ch, 0, numSamples)));
     inputLevel.store(inLevel);
 
-    float* leftData = buffer.getWritePointer(0);
-    float* rightData = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
-
+    std::array<SampleType*, MAX_CHANNELS> channelData;
     float maxGR = 0.0f;
 
-    for (int i = 0; i < numSamples; ++i)
+    for (int start = 0; start < numSamples; start += currentBlockSize)
     {
-        float inputL = leftData[i];
-        float inputR = rightData ? rightData[i] : inputL;
-        float dryL = inputL;
-        float dryR = inputR;
+        for (int ch = 0; ch < numChannels; ++ch)
+            channelData[static_cast<size_t>(ch)] = buffer.getWritePointer(ch) + start;
+
+        maxGR = std::max(maxGR, processChunk(channelData.data(), numChannels,
+                                             std::min(currentBlockSize, numSamples - start)));
+    }
+
+    currentGainReduction.store(maxGR);
+
+    // Calculate output level for metering
+    float outLevel = 0.0f;
+    for (int ch = 0; ch < numChannels; ++ch)
+        outLevel = std::max(outLevel, static_cast<float>(buffer.getMagnitude(ch, 0, numSamples)));
+    outputLevel.store(outLevel);
+}
+
+template <typename SampleType>
+float MasteringCompressor<SampleType>::processChunk(SampleType* const* data, int numChannels, int numSamples)
+{
+    // Channels run LANES to a register, so the filters and gains cost one pass per group. The
+    // link needs every channel's level before any gain, so each stage covers the whole chunk.
+    const int numGroups = (numChannels + LANES - 1) / LANES;
+    auto* input = reinterpret_cast<SampleType*>(inputFrames.data());
+
+    // Interleave, leaving unused lanes silent
+    for (int group = 0; group < numGroups; ++group)
+    {
+        for (int lane = 0; lane < LANES; ++lane)
+        {
+            const int channel = group * LANES + lane;
+            const SampleType* source = channel < numChannels ? data[channel] : nullptr;
+            for (int i = 0; i < numSamples; ++i)
+                input[frame(group * LANES, i) + lane] = source != nullptr ? source[i] : 0.0f;
+        }
+    }
+
+    // M/S encoding if enabled
+    const bool useMidSide = midSideMode && numChannels > 1;
+    if (useMidSide)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto& left = input[frame(0, i)];
+            auto& right = input[frame(1, i)];
+            const SampleType mid = (left + right) * 0.5f;
+            const SampleType side = (left - right) * 0.5f;
+            left = mid;
+            right = side;
+        }
+    }
+
+    // Bypassed, the audio still goes through the delays: the dry one keeps the latency the
+    // same, and the wet one is full of the right audio when the compressor comes back
+    if (bypassed)
+    {
+        delayPaths(data, numChannels, numSamples);
+        return 0.0f;
+    }
+
+    for (int group = 0; group < numGroups; ++group)
+        filterSidechain(group, std::min(LANES, numChannels - group * LANES), numSamples);
+
+    // The detector below runs on the sidechain as it is now, while the audio goes through the
+    // look-ahead delay. Listening to the sidechain takes the dry path, which is delayed by the
+    // whole latency, so it lines up too.
+    if (sidechainListen)
+    {
+        const auto* sidechain = reinterpret_cast<const SampleType*>(sidechainFrames.data());
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numSamples; ++i)
+                data[ch][i] = sidechain[frame(ch, i)];
+    }
+
+    delayPaths(data, numChannels, numSamples);
+
+    if (sidechainListen)
+        return 0.0f;
+
+    const float maxGR = numBands > 1 ? compressBands(numChannels, numSamples)
+                                     : compressWideband(numChannels, numSamples);
+
+    // Apply saturation based on mode. The vintage mode's state runs through the channels in
+    // order, so this stays a sample at a time. Oversampled, Clean still goes through the
+    // filters, as the delay that keeps its latency the same as the other modes'.
+    if (oversamplingStages > 0)
+        saturateOversampled(numChannels, numSamples);
+    else if (currentMode != Mode::Clean)
+        for (int i = 0; i < numSamples; ++i)
+            for (int ch = 0; ch < numChannels; ++ch)
+                applySaturation(input[frame(ch, i)], currentMode);
 
-        // M/S encoding if enabled
-        if (midSideMode && rightData)
+    // M/S decoding if enabled
+    if (useMidSide)
+    {
+        for (int i = 0; i < numSamples; ++i)
         {
-            float mid = (inputL + inputR) * 0.5f;
-            float side = (inputL - inputR) * 0.5f;
-            inputL = mid;
-            inputR = side;
+            auto& mid = input[frame(0, i)];
+            auto& side = input[frame(1, i)];
+            const SampleType left = mid + side;
+            const SampleType right = mid - side;
+            mid = left;
+            side = right;
         }
+    }
+
+    // Only needed once the dry path is heard, so it picks up from wherever it was left when
+    // the mix comes off 100%
+    if (numBands > 1 && mix < 1.0f)
+        alignDryPhase(data, numChannels, numSamples);
 
-        // Apply sidechain HPF
-        float scL = scHpfCoeffs.b0 * inputL + scHpfCoeffs.b1 * scHpfStateL.x1 + scHpfCoeffs.b2 * scHpfStateL.x2
-                    - scHpfCoeffs.a1 * scHpfStateL.y1 - scHpfCoeffs.a2 * scHpfStateL.y2;
-        scHpfStateL.x2 = scHpfStateL.x1;
-        scHpfStateL.x1 = inputL;
-        scHpfStateL.y2 = scHpfStateL.y1;
-        scHpfStateL.y1 = scL;
+    // Wet/dry mix (parallel compression) against the untouched input
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < numSamples; ++i)
+            data[ch][i] = data[ch][i] * (1.0f - mix) + input[frame(ch, i)] * mix;
+
+    return maxGR;
+}
+
+// One detector and gain computer for the whole band: a single gain per sample when fully
+// linked, one per channel otherwise. The gains and makeup are applied to the frames in place.
+template <typename SampleType>
+float MasteringCompressor<SampleType>::compressWideband(int numChannels, int numSamples)
+{
+    const int numGroups = (numChannels + LANES - 1) / LANES;
+    auto* sidechain = reinterpret_cast<SampleType*>(sidechainFrames.data());
+    auto* gains = reinterpret_cast<SampleType*>(gainFrames.data());
+
+    // Loudest sidechain level across all channels, for the link and auto-release
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto peak = Register::abs(sidechainFrames[static_cast<size_t>(i)]);
+        for (int group = 1; group < numGroups; ++group)
+            peak = Register::max(peak, Register::abs(sidechainFrames[static_cast<size_t>(group * currentBlockSize + i)]));
 
-        float scR = inputR;
-        if (rightData)
+        SampleType level = 0;
+        for (size_t lane = 0; lane < Register::SIMDNumElements; ++lane)
+            level = std::max(level, peak.get(lane));
+        peakLevels[static_cast<size_t>(i)] = static_cast<float>(level);
+    }
+
+    // With look-ahead each level is the loudest still in the delay, so the envelope starts
+    // moving as a peak goes in rather than as it comes out
+    if (lookaheadSamples > 0)
+        peakWindow.process(peakLevels.data(), peakLevels.data(), numSamples);
+
+    float maxGR = 0.0f;
+
+    if (stereoLink >= 1.0f)
+    {
+        // Fully linked: one envelope on the loudest channel, so one gain per sample whatever
+        // the channel count
+        float& envelope = envelopes[0];
+        float loudest = 0.0f;
+        for (int i = 0; i < numSamples; ++i)
         {
-            scR = scHpfCoeffs.b0 * inputR + scHpfCoeffs.b1 * scHpfStateR.x1 + scHpfCoeffs.b2 * scHpfStateR.x2
-                  - scHpfCoeffs.a1 * scHpfStateR.y1 - scHpfCoeffs.a2 * scHpfStateR.y2;
-            scHpfStateR.x2 = scHpfStateR.x1;
-            scHpfStateR.x1 = inputR;
-            scHpfStateR.y2 = scHpfStateR.y1;
-            scHpfStateR.y1 = scR;
+            const float linkedLevel = peakLevels[static_cast<size_t>(i)];
+            float releaseCoeffToUse = autoRelease ? computeAutoRelease(linkedLevel) : releaseCoeff;
+
+            if (linkedLevel > envelope)
+                envelope += attackCoeff * (linkedLevel - envelope);
+            else
+                envelope += releaseCoeffToUse * (linkedLevel - envelope);
+
+            detectorLevels[static_cast<size_t>(i)] = envelope;
+            loudest = std::max(loudest, envelope);
         }
 
-        // If sidechain listen is enabled, output sidechain signal
-        if (sidechainListen)
+        maxGR = levelsToGains(detectorLevels.data(), numSamples, loudest);
+
+        for (int i = 0; i < numSamples; ++i)
         {
-            leftData[i] = scL;
-            if (rightData) rightData[i] = scR;
-            continue;
+            const auto gain = Register::expand(detectorLevels[static_cast<size_t>(i)]);
+            for (int group = 0; group < numGroups; ++group)
+                gainFrames[static_cast<size_t>(group * currentBlockSize + i)] = gain;
         }
+    }
+    else
+    {
+        // Each channel follows its own level, pulled towards the loudest by the link amount
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* levels = detectorLevels.data() + ch * currentBlockSize;
+            for (int i = 0; i < numSamples; ++i)
+                levels[i] = static_cast<float>(std::abs(sidechain[frame(ch, i)]));
 
-        // Get input levels (absolute for envelope)
-        float levelL = std::abs(scL);
-        float levelR = std::abs(scR);
+            if (lookaheadSamples > 0)
+                levelWindows[static_cast<size_t>(ch)].process(levels, levels, numSamples);
+        }
 
-        // Stereo linking
-        float linkedLevel;
-        if (stereoLink >= 1.0f)
+        std::array<float, MAX_CHANNELS> loudest {};
+        for (int i = 0; i < numSamples; ++i)
         {
-            linkedLevel = std::max(levelL, levelR);
+            const float peakLevel = peakLevels[static_cast<size_t>(i)];
+            float releaseCoeffToUse = autoRelease ? computeAutoRelease(peakLevel) : releaseCoeff;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const float level = detectorLevels[static_cast<size_t>(ch * currentBlockSize + i)];
+                const float linkedLevel = level + stereoLink * (peakLevel - level);
+                float& envelope = envelopes[static_cast<size_t>(ch)];
+
+                if (linkedLevel > envelope)
+                    envelope += attackCoeff * (linkedLevel - envelope);
+                else
+                    envelope += releaseCoeffToUse * (linkedLevel - envelope);
+
+                detectorLevels[static_cast<size_t>(ch * currentBlockSize + i)] = envelope;
+                loudest[static_cast<size_t>(ch)] = std::max(loudest[static_cast<size_t>(ch)], envelope);
+            }
         }
-        else if (stereoLink <= 0.0f)
+
+        for (int ch = 0; ch < numChannels; ++ch)
         {
-            // Independent processing handled below
-            linkedLevel = levelL; // Won't be used
+            auto* levels = detectorLevels.data() + ch * currentBlockSize;
+            maxGR = std::max(maxGR, levelsToGains(levels, numSamples, loudest[static_cast<size_t>(ch)]));
+            for (int i = 0; i < numSamples; ++i)
+                gains[frame(ch, i)] = levels[i];
+        }
+    }
+
+    // Apply gain reduction
+    const auto makeup = Register::expand(makeupLinear);
+    for (int group = 0; group < numGroups; ++group)
+    {
+        auto* frames = inputFrames.data() + group * currentBlockSize;
+        const auto* frameGains = gainFrames.data() + group * currentBlockSize;
+        for (int i = 0; i < numSamples; ++i)
+            frames[i] = frames[i] * frameGains[i] * makeup;
+    }
+
+    return maxGR;
+}
+
+// Multiband detectors and gains. The sidechain is split for the detectors and the audio for the
+// gains, so the sidechain filter and look-ahead work as they do for the wideband compressor.
+template <typename SampleType>
+float MasteringCompressor<SampleType>::compressBands(int numChannels, int numSamples)
+{
+    const int numLevelRegisters = (numBands + LEVEL_LANES - 1) / LEVEL_LANES;
+    const int stride = numLevelRegisters * LEVEL_LANES;
+    auto* input = reinterpret_cast<SampleType*>(inputFrames.data());
+    const auto bandSample = [this] (int band, int i)
+    {
+        return ((band / LANES) * currentBlockSize + i) * LANES + band % LANES;
+    };
+    const auto levelIndex = [this, numLevelRegisters] (int channel, int i)
+    {
+        return static_cast<size_t>(channel * MAX_LEVEL_REGISTERS * currentBlockSize + i * numLevelRegisters);
+    };
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        // Channels are split in pairs, so each crossover pass runs four filter chains at once
+        const int pairChannel = ch % 2;
+        if (pairChannel == 0)
+            splitBands(ch, std::min(2, numChannels - ch), numSamples);
+
+        // Band levels. In float the band and level registers are the same width, so they're
+        // taken a register at a time.
+        const auto* sidechain = sidechainBands.data() + pairChannel * MAX_BAND_REGISTERS * currentBlockSize;
+        auto* levels = reinterpret_cast<float*>(bandLevels.data() + levelIndex(ch, 0));
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                for (int index = 0; index < numLevelRegisters; ++index)
+                    bandLevels[levelIndex(ch, i) + static_cast<size_t>(index)] = LevelRegister::abs(sidechain[index * currentBlockSize + i]);
         }
         else
         {
-            float maxLevel = std::max(levelL, levelR);
-            linkedLevel = levelL + stereoLink * (maxLevel - levelL);
+            const auto* bands = reinterpret_cast<const SampleType*>(sidechain);
+            for (int i = 0; i < numSamples; ++i)
+                for (int band = 0; band < stride; ++band)
+                    levels[i * stride + band] = band < numBands ? static_cast<float>(std::abs(bands[bandSample(band, i)])) : 0.0f;
         }
 
-        // Get release coefficient (auto or fixed)
-        float releaseCoeffToUse = autoRelease ? computeAutoRelease(linkedLevel) : releaseCoeff;
+        // A window per level register covers all its bands at once
+        if (lookaheadSamples > 0)
+        {
+            for (int index = 0; index < numLevelRegisters; ++index)
+            {
+                auto* bandLevel = bandLevels.data() + levelIndex(ch, 0) + index;
+                bandWindows[static_cast<size_t>(ch * MAX_LEVEL_REGISTERS + index)].process(bandLevel, bandLevel, numSamples, numLevelRegisters);
+            }
+        }
+    }
+
+    // Envelopes for every band at once: attack where the level is above, release where below
+    const auto zero = LevelRegister::expand(0.0f);
+    const auto follow = [this, zero] (LevelRegister& envelope, LevelRegister level, int index)
+    {
+        const auto difference = level - envelope;
+        envelope += bandAttackCoeffs[static_cast<size_t>(index)] * LevelRegister::max(difference, zero)
+                  + bandReleaseCoeffs[static_cast<size_t>(index)] * LevelRegister::min(difference, zero);
+    };
+
+    const bool fullyLinked = stereoLink >= 1.0f;
+    const auto link = LevelRegister::expand(stereoLink);
+    float maxGR = 0.0f;
 
-        // Envelope follower for left/linked
-        if (stereoLink > 0.0f)
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (int index = 0; index < numLevelRegisters; ++index)
         {
-            if (linkedLevel > envelopeL)
-                envelopeL += attackCoeff * (linkedLevel - envelopeL);
-            else
-                envelopeL += releaseCoeffToUse * (linkedLevel - envelopeL);
+            auto peak = bandLevels[levelIndex(0, i) + static_cast<size_t>(index)];
+            for (int ch = 1; ch < numChannels; ++ch)
+                peak = LevelRegister::max(peak, bandLevels[levelIndex(ch, i) + static_cast<size_t>(index)]);
 
-            // Calculate gain reduction
-            float inputDb = DSPUtils::linearToDecibels(envelopeL);
-            gainReductionL = computeGain(inputDb);
-            gainReductionR = gainReductionL;
+            if (fullyLinked)
+            {
+                auto& envelope = bandEnvelopes[0][static_cast<size_t>(index)];
+                follow(envelope, peak, index);
+                bandPeaks[static_cast<size_t>(i * numLevelRegisters + index)] = envelope;
+                continue;
+            }
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto& level = bandLevels[levelIndex(ch, i) + static_cast<size_t>(index)];
+                auto& envelope = bandEnvelopes[static_cast<size_t>(ch)][static_cast<size_t>(index)];
+                follow(envelope, level + link * (peak - level), index);
+                level = envelope;
+            }
+        }
+    }
+
+    if (fullyLinked)
+        maxGR = bandLevelsToGains(bandPeaks.data(), numSamples);
+    else
+        for (int ch = 0; ch < numChannels; ++ch)
+            maxGR = std::max(maxGR, bandLevelsToGains(bandLevels.data() + levelIndex(ch, 0), numSamples));
+
+    // Sum the bands back with their gains and the makeup
+    const auto makeup = static_cast<SampleType>(makeupLinear);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto* bandRegisters = bandFrames.data() + ch * MAX_BAND_REGISTERS * currentBlockSize;
+        const auto* gainRegisters = fullyLinked ? bandPeaks.data() : bandLevels.data() + levelIndex(ch, 0);
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto sum = bandRegisters[i] * gainRegisters[i * numLevelRegisters];
+                for (int index = 1; index < numLevelRegisters; ++index)
+                    sum += bandRegisters[index * currentBlockSize + i] * gainRegisters[i * numLevelRegisters + index];
+                input[frame(ch, i)] = sum.sum() * makeup;
+            }
         }
         else
         {
-            // Independent L/R processing
-            if (levelL > envelopeL)
-                envelopeL += attackCoeff * (levelL - envelopeL);
-            else
-                envelopeL += releaseCoeffToUse * (levelL - envelopeL);
+            const auto* bands = reinterpret_cast<const SampleType*>(bandRegisters);
+            const auto* gains = reinterpret_cast<const float*>(gainRegisters);
+            for (int i = 0; i < numSamples; ++i)
+            {
+                SampleType sum = 0;
+                for (int band = 0; band < numBands; ++band)
+                    sum += bands[bandSample(band, i)] * static_cast<SampleType>(gains[i * stride + band]);
+                input[frame(ch, i)] = sum * makeup;
+            }
+        }
+    }
 
-            if (levelR > envelopeR)
-                envelopeR += attackCoeff * (levelR - envelopeR);
-            else
-                envelopeR += releaseCoeffToUse * (levelR - envelopeR);
+    return maxGR;
+}
 
-            float inputDbL = DSPUtils::linearToDecibels(envelopeL);
-            float inputDbR = DSPUtils::linearToDecibels(envelopeR);
-            gainReductionL = computeGain(inputDbL);
-            gainReductionR = computeGain(inputDbR);
+// A pair of channels' sidechain and audio into bands. Every lane starts from the same sample,
+// and each crossover section filters all the lanes of a register at once. Each sample waits on
+// the one before, so the sidechain and audio of both channels go through a section together:
+// four independent chains keep the pipeline full where one would leave it waiting.
+template <typename SampleType>
+void MasteringCompressor<SampleType>::splitBands(int firstChannel, int numChannels, int numSamples)
+{
+    const int numBandRegisters = (numBands + LANES - 1) / LANES;
+    const auto* sidechain = reinterpret_cast<const SampleType*>(sidechainFrames.data());
+    const auto* input = reinterpret_cast<const SampleType*>(inputFrames.data());
+    const auto channelStates = MAX_BAND_REGISTERS * MAX_CROSSOVERS * SECTIONS_PER_CROSSOVER;
+
+    for (int index = 0; index < numBandRegisters; ++index)
+    {
+        std::array<Register*, 4> samples {};
+        std::array<RegisterBiquadState*, 4> states {};
+        for (int pair = 0; pair < numChannels; ++pair)
+        {
+            const int channel = firstChannel + pair;
+            samples[static_cast<size_t>(2 * pair)] = sidechainBands.data() + (pair * MAX_BAND_REGISTERS + index) * currentBlockSize;
+            samples[static_cast<size_t>(2 * pair + 1)] = bandFrames.data() + (channel * MAX_BAND_REGISTERS + index) * currentBlockSize;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                samples[static_cast<size_t>(2 * pair)][i] = Register::expand(sidechain[frame(channel, i)]);
+                samples[static_cast<size_t>(2 * pair + 1)][i] = Register::expand(input[frame(channel, i)]);
+            }
         }
 
-        // Track max gain reduction for metering
-        maxGR = std::max(maxGR, std::max(gainReductionL, gainReductionR));
+        for (int crossover = 0; crossover < numBands - 1; ++crossover)
+        {
+            for (int section = 0; section < SECTIONS_PER_CROSSOVER; ++section)
+            {
+                const auto& c = crossoverSections[static_cast<size_t>(sectionIndex(index, crossover, section))];
+                for (int pair = 0; pair < numChannels; ++pair)
+                {
+                    const int channel = firstChannel + pair;
+                    states[static_cast<size_t>(2 * pair)] = bandStates.data() + channel * channelStates + sectionIndex(index, crossover, section);
+                    states[static_cast<size_t>(2 * pair + 1)] = bandStates.data() + (numPreparedChannels + channel) * channelStates
+                                                              + sectionIndex(index, crossover, section);
+                }
 
-        // Apply gain reduction
-        float gainL = DSPUtils::decibelsToLinear(-gainReductionL);
-        float gainR = DSPUtils::decibelsToLinear(-gainReductionR);
+                if (numChannels == 2)
+                    filterChains<4>(c, samples, states, numSamples);
+                else
+                    filterChains<2>(c, { samples[0], samples[1] }, { states[0], states[1] }, numSamples);
+            }
+        }
+    }
+}
+
+// One biquad section over several signals in step, the states held in registers throughout
+template <typename SampleType>
+template <int NumChains>
+void MasteringCompressor<SampleType>::filterChains(const RegisterBiquad& c, const std::array<Register*, NumChains>& samples,
+                                                   const std::array<RegisterBiquadState*, NumChains>& states, int numSamples)
+{
+    std::array<RegisterBiquadState, NumChains> s;
+    for (int k = 0; k < NumChains; ++k)
+        s[static_cast<size_t>(k)] = *states[static_cast<size_t>(k)];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (int k = 0; k < NumChains; ++k)
+        {
+            auto& state = s[static_cast<size_t>(k)];
+            const auto x = samples[static_cast<size_t>(k)][i];
+            const auto y = c.b0 * x + c.b1 * state.x1 + c.b2 * state.x2 - c.a1 * state.y1 - c.a2 * state.y2;
+            state = { x, state.x1, y, state.y1 };
+            samples[static_cast<size_t>(k)][i] = y;
+        }
+    }
 
-        float outputL = inputL * gainL * makeupLinear;
-        float outputR = inputR * gainR * makeupLinear;
+    for (int k = 0; k < NumChains; ++k)
+        *states[static_cast<size_t>(k)] = s[static_cast<size_t>(k)];
+}
 
-        // Apply saturation based on mode
-        if (currentMode != Mode::Clean)
+// The dry path through every active crossover's all pass, the phase shift the bands pick up
+// on their way to the sum. The channels go through in their lanes, interleaved in the gain
+// frames, which are free again once the gains are applied.
+template <typename SampleType>
+void MasteringCompressor<SampleType>::alignDryPhase(SampleType* const* data, int numChannels, int numSamples)
+{
+    const int numGroups = (numChannels + LANES - 1) / LANES;
+    auto* dry = reinterpret_cast<SampleType*>(gainFrames.data());
+    for (int group = 0; group < numGroups; ++group)
+    {
+        for (int lane = 0; lane < LANES; ++lane)
         {
-            applySaturation(outputL, currentMode);
-            applySaturation(outputR, currentMode);
+            const int channel = group * LANES + lane;
+            const SampleType* source = channel < numChannels ? data[channel] : nullptr;
+            for (int i = 0; i < numSamples; ++i)
+                dry[frame(group * LANES, i) + lane] = source != nullptr ? source[i] : 0.0f;
         }
+    }
 
-        // M/S decoding if enabled
-        if (midSideMode && rightData)
+    for (int group = 0; group < numGroups; ++group)
+    {
+        auto* frames = gainFrames.data() + group * currentBlockSize;
+        for (int crossover = 0; crossover < numBands - 1; ++crossover)
         {
-            float mid = outputL;
-            float side = outputR;
-            outputL = mid + side;
-            outputR = mid - side;
+            const auto& c = crossoverAllPasses[static_cast<size_t>(crossover)];
+            auto& s = dryAllPassStates[static_cast<size_t>(group * MAX_CROSSOVERS + crossover)];
+            auto x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto x = frames[i];
+                const auto y = c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+                frames[i] = y;
+            }
+            s = { x1, x2, y1, y2 };
         }
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < numSamples; ++i)
+            data[ch][i] = dry[frame(ch, i)];
+}
 
-        // Wet/dry mix (parallel compression)
-        leftData[i] = dryL * (1.0f - mix) + outputL * mix;
-        if (rightData)
-            rightData[i] = dryR * (1.0f - mix) + outputR * mix;
+// Band envelopes to linear gains, in place, every band's gain computer in the lanes at once.
+// Returns the most gain reduction in any band.
+template <typename SampleType>
+float MasteringCompressor<SampleType>::bandLevelsToGains(LevelRegister* levels, int numSamples)
+{
+    const int numLevelRegisters = (numBands + LEVEL_LANES - 1) / LEVEL_LANES;
+    const int count = numSamples * numLevelRegisters;
+    auto* values = reinterpret_cast<float*>(levels);
+    DSPUtils::fastLinearToDecibels(values, values, count * LEVEL_LANES);
+
+    // The quadratic soft knee: slope * (over + knee / 2)^2 / (2 knee) inside it, which meets the
+    // straight line above and nothing below. Unlike the wideband curve it needs no division, so
+    // it stays in registers. A hard knee is a very narrow soft one.
+    const float knee = std::max(kneeDb, 0.01f);
+    const auto halfKnee = LevelRegister::expand(0.5f * knee);
+    const auto kneeWidth = LevelRegister::expand(knee);
+    const auto kneeScale = LevelRegister::expand(0.5f / knee);
+    const auto zero = LevelRegister::expand(0.0f);
+    auto most = zero;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const auto index = static_cast<size_t>(i % numLevelRegisters);
+        const auto over = levels[i] - bandThresholds[index];
+        const auto inKnee = LevelRegister::min(LevelRegister::max(over + halfKnee, zero), kneeWidth);
+        const auto reduction = bandSlopes[index] * (inKnee * inKnee * kneeScale + LevelRegister::max(over - halfKnee, zero));
+        most = LevelRegister::max(most, reduction);
+        levels[i] = zero - reduction;
     }
 
-    currentGainReduction.store(maxGR);
+    DSPUtils::fastDecibelsToLinear(values, values, count * LEVEL_LANES);
 
-    // Calculate output level for metering
-    float outLevel = 0.0f;
-    for (int ch = 0; ch < numChannels; ++ch)
-        outLevel = std::max(outLevel, buffer.getMagnitude(ch, 0, numSamples));
-    outputLevel.store(outLevel);
+    float maxGR = 0.0f;
+    for (size_t lane = 0; lane < LevelRegister::SIMDNumElements; ++lane)
+        maxGR = std::max(maxGR, most.get(lane));
+    return maxGR;
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::filterSidechain(int group, int numLanes, int numSamples)
+{
+    alignas(Register::SIMDRegisterSize) SampleType state[4][LANES] {};
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        const auto& s = scHpfStates[static_cast<size_t>(group * LANES + lane)];
+        state[0][lane] = s.x1;
+        state[1][lane] = s.x2;
+        state[2][lane] = s.y1;
+        state[3][lane] = s.y2;
+    }
+
+    const auto b0 = Register::expand(scHpfCoeffs.b0);
+    const auto b1 = Register::expand(scHpfCoeffs.b1);
+    const auto b2 = Register::expand(scHpfCoeffs.b2);
+    const auto a1 = Register::expand(scHpfCoeffs.a1);
+    const auto a2 = Register::expand(scHpfCoeffs.a2);
+    auto x1 = Register::fromRawArray(state[0]);
+    auto x2 = Register::fromRawArray(state[1]);
+    auto y1 = Register::fromRawArray(state[2]);
+    auto y2 = Register::fromRawArray(state[3]);
+
+    const auto* input = inputFrames.data() + group * currentBlockSize;
+    auto* output = sidechainFrames.data() + group * currentBlockSize;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto x = input[i];
+        const auto y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        output[i] = y;
+    }
+
+    x1.copyToRawArray(state[0]);
+    x2.copyToRawArray(state[1]);
+    y1.copyToRawArray(state[2]);
+    y2.copyToRawArray(state[3]);
+    for (int lane = 0; lane < numLanes; ++lane)
+        scHpfStates[static_cast<size_t>(group * LANES + lane)] = { state[0][lane], state[1][lane], state[2][lane], state[3][lane] };
 }
 
 // Parameter setters
-void MasteringCompressor::setThreshold(float thresholdDb)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setThreshold(float thresholdDb)
 {
     threshold = std::clamp(thresholdDb, -40.0f, 0.0f);
 }
 
-void MasteringCompressor::setRatio(float newRatio)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setRatio(float newRatio)
 {
-    ratio = std::clamp(newRatio, 1.0f, 10.0f);
+    newRatio = std::clamp(newRatio, 1.0f, 10.0f);
+    if (newRatio == ratio)
+        return;
+
+    ratio = newRatio;
+    updateGainTable();
 }
 
-void MasteringCompressor::setAttack(float newAttackMs)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setAttack(float newAttackMs)
 {
     attackMs = std::clamp(newAttackMs, 0.1f, 100.0f);
     updateCoefficients();
 }
 
-void MasteringCompressor::setRelease(float newReleaseMs)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setRelease(float newReleaseMs)
 {
     releaseMs = std::clamp(newReleaseMs, 50.0f, 2000.0f);
     updateCoefficients();
 }
 
-void MasteringCompressor::setKnee(float newKneeDb)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setKnee(float newKneeDb)
 {
-    kneeDb = std::clamp(newKneeDb, 0.0f, 20.0f);
+    newKneeDb = std::clamp(newKneeDb, 0.0f, 20.0f);
+    if (newKneeDb == kneeDb)
+        return;
+
+    kneeDb = newKneeDb;
+    updateGainTable();
 }
 
-void MasteringCompressor::setMakeupGain(float gainDb)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setMakeupGain(float gainDb)
 {
     makeupGain = std::clamp(gainDb, 0.0f, 12.0f);
     makeupLinear = DSPUtils::decibelsToLinear(makeupGain);
 }
 
-void MasteringCompressor::setMix(float mixPercent)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setMix(float mixPercent)
 {
     mix = std::clamp(mixPercent / 100.0f, 0.0f, 1.0f);
 }
 
-void MasteringCompressor::setAutoRelease(bool enabled)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setAutoRelease(bool enabled)
 {
     autoRelease = enabled;
 }
 
-void MasteringCompressor::setMode(Mode mode)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setLookahead(float newLookaheadMs)
+{
+    newLookaheadMs = std::clamp(newLookaheadMs, 0.0f, MAX_LOOKAHEAD_MS);
+    if (newLookaheadMs == lookaheadMs)
+        return;
+
+    lookaheadMs = newLookaheadMs;
+    updateDelays();
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setNumBands(int newNumBands)
+{
+    newNumBands = newNumBands <= 1 ? 1 : std::clamp(newNumBands, 3, MAX_BANDS);
+    if (newNumBands == numBands)
+        return;
+
+    // New crossovers come in with whatever their sections last held, so every band starts over
+    numBands = newNumBands;
+    updateCrossovers();
+    clearBands();
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setCrossover(int index, float freq)
 {
+    if (index < 0 || index >= MAX_CROSSOVERS)
+        return;
+
+    freq = std::clamp(freq, 20.0f, 20000.0f);
+    if (freq == crossoverFrequencies[static_cast<size_t>(index)])
+        return;
+
+    crossoverFrequencies[static_cast<size_t>(index)] = freq;
+    updateCrossovers();
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setBand(int band, float thresholdDb, float newRatio, float newAttackMs, float newReleaseMs)
+{
+    if (band < 0 || band >= MAX_BANDS)
+        return;
+
+    BandSettings settings;
+    settings.thresholdDb = std::clamp(thresholdDb, -40.0f, 0.0f);
+    settings.ratio = std::clamp(newRatio, 1.0f, 10.0f);
+    settings.attackMs = std::clamp(newAttackMs, 0.1f, 100.0f);
+    settings.releaseMs = std::clamp(newReleaseMs, 50.0f, 2000.0f);
+
+    auto& current = bandSettings[static_cast<size_t>(band)];
+    if (settings.thresholdDb == current.thresholdDb && settings.ratio == current.ratio
+        && settings.attackMs == current.attackMs && settings.releaseMs == current.releaseMs)
+        return;
+
+    current = settings;
+    updateBandCoefficients();
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setMode(Mode mode)
+{
+    // The latency is the oversampling's in every mode, so the delays are left running
     currentMode = mode;
 }
 
-void MasteringCompressor::setSidechainHPF(float freq)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setOversampling(int factor)
+{
+    const int stages = getOversamplingStages(factor);
+    if (stages == oversamplingStages)
+        return;
+
+    oversamplingStages = stages;
+    saturationSmoothing = static_cast<SampleType>(std::pow(0.99, 1.0 / (1 << stages)));
+    updateDelays();
+}
+
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setSidechainHPF(float freq)
 {
     sidechainHPFFreq = std::clamp(freq, 20.0f, 300.0f);
-    scHpfCoeffs = DSPUtils::calculateHighPass(static_cast<float>(currentSampleRate), sidechainHPFFreq, 0.707f);
+    scHpfCoeffs = DSPUtils::calculateHighPass<SampleType>(static_cast<SampleType>(currentSampleRate), sidechainHPFFreq, 0.707f);
 }
 
-void MasteringCompressor::setSidechainListen(bool enabled)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setSidechainListen(bool enabled)
 {
     sidechainListen = enabled;
 }
 
-void MasteringCompressor::setStereoLink(float linkPercent)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setStereoLink(float linkPercent)
 {
     stereoLink = std::clamp(linkPercent / 100.0f, 0.0f, 1.0f);
 }
 
-void MasteringCompressor::setMidSideMode(bool enabled)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setMidSideMode(bool enabled)
 {
     midSideMode = enabled;
 }
 
-void MasteringCompressor::setBypass(bool shouldBypass)
+template <typename SampleType>
+void MasteringCompressor<SampleType>::setBypass(bool shouldBypass)
 {
+    if (shouldBypass == bypassed)
+        return;
+
+    // The delays keep running while bypassed, but the detectors and the oversampling stop, so
+    // what they held would come out late
     bypassed = shouldBypass;
+    clearHistories();
 }
+
+template <typename SampleType>
+int MasteringCompressor<SampleType>::getLatencySamples() const
+{
+    return dryDelaySamples;
+}
+
+template class MasteringCompressor<float>;
+template class MasteringCompressor<double>;
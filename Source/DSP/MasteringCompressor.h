@@ -3,8 +3,10 @@
 #include <JuceHeader.h>
 #include "DSPUtils.h"
 #include <array>
+#include <vector>
 
-class MasteringCompressor
+// The parts of the compressor that don't depend on the sample type
+class MasteringCompressorBase
 {
 public:
     enum class Mode
@@ -15,10 +17,40 @@ public:
         Vintage     // Modeled on classic hardware
     };
 
+    static constexpr int MAX_CHANNELS = 16;   // Up to 9.1.6, as MasteringEQ
+
+    // Multiband mode splits into 3 to MAX_BANDS bands at the lowest numBands - 1 crossovers
+    static constexpr int MAX_BANDS = 5;
+    static constexpr int MAX_CROSSOVERS = MAX_BANDS - 1;
+    static float getDefaultCrossoverFrequency(int index);
+
+    // Saturation can run at 2, 4 or 8 times the rate, through a half-band stage per doubling.
+    // They're linear phase and the dry path is delayed to match, so parallel compression still
+    // lines up. The latency is in samples at the base rate, none for a factor of 1.
+    static constexpr int MAX_OVERSAMPLING_STAGES = 3;
+    static constexpr int MAX_OVERSAMPLING = 1 << MAX_OVERSAMPLING_STAGES;
+    static int getOversamplingLatency(int factor);
+
+protected:
+    // K taps either side of each stage's centre (DSPUtils::calculateHalfBand), fewer as the
+    // images move further from the audio band. A stage delays by 2K at its upper rate each way,
+    // and the last K is even, so every factor comes to whole samples at the base rate.
+    static constexpr std::array<int, MAX_OVERSAMPLING_STAGES> HALF_BAND_TAPS { 32, 8, 6 };
+    static constexpr double HALF_BAND_ATTENUATION_DB = 90.0;
+    static int getOversamplingStages(int factor);
+};
+
+// Instantiated for float and double. The audio path and sidechain filter run at the sample
+// type's precision; the detector and gain computer work in float dB either way.
+template <typename SampleType>
+class MasteringCompressor : public MasteringCompressorBase
+{
+public:
     MasteringCompressor();
 
-    void prepare(double sampleRate, int samplesPerBlock);
-    void process(juce::AudioBuffer<float>& buffer);
+    // Channels beyond numChannels pass through. M/S applies to the first two channels.
+    void prepare(double sampleRate, int samplesPerBlock, int numChannels);
+    void process(juce::AudioBuffer<SampleType>& buffer);
     void reset();
 
     // Main compressor controls
@@ -30,19 +62,33 @@ public:
     void setMakeupGain(float gainDb);           // 0dB to 12dB
     void setMix(float mixPercent);              // 0-100% (parallel compression)
     void setAutoRelease(bool enabled);
+    void setLookahead(float lookaheadMs);       // 0 to 10ms, delays the audio by as much
     void setMode(Mode mode);
+    void setOversampling(int factor);           // 1, 2, 4 or 8, around the saturation
 
     // Sidechain controls
     void setSidechainHPF(float freq);           // 20Hz to 300Hz
     void setSidechainListen(bool enabled);
 
-    // Stereo controls
+    // Stereo controls. The link pulls every channel's detector towards the loudest channel.
     void setStereoLink(float linkPercent);      // 0-100%
     void setMidSideMode(bool enabled);
 
+    // Multiband. One band is the wideband compressor; 3 to 5 split the signal with 4th order
+    // Linkwitz-Riley crossovers, and each band has its own threshold, ratio, attack and release.
+    // Knee, makeup, mix, link, mode, look-ahead and the sidechain filter are shared; auto-release
+    // is wideband only.
+    void setNumBands(int numBands);             // 1, or 3 to 5
+    void setCrossover(int index, float freq);   // 20Hz to 20kHz, kept above the one below
+    void setBand(int band, float thresholdDb, float ratio, float attackMs, float releaseMs);
+
     // Global
     void setBypass(bool shouldBypass);
 
+    // Latency from the look-ahead, plus the oversampling's. The same in every mode, and while
+    // bypassed: the dry path is still delayed.
+    int getLatencySamples() const;
+
     // Metering
     float getGainReduction() const { return currentGainReduction.load(); }
     float getInputLevel() const { return inputLevel.load(); }
@@ -55,14 +101,41 @@ public:
     float getRelease() const { return releaseMs; }
     float getKnee() const { return kneeDb; }
     float getMakeupGain() const { return makeupGain; }
+    float getLookahead() const { return lookaheadMs; }
+    int getNumBands() const { return numBands; }
+    int getOversampling() const { return 1 << oversamplingStages; }
     Mode getMode() const { return currentMode; }
 
 private:
-    float computeGain(float inputDb);
-    float processSampleStereoLinked(float inputL, float inputR, float& outputL, float& outputR);
+    // A SIMD register of channels, one channel per lane
+    using Register = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int LANES = static_cast<int>(Register::SIMDNumElements);
+
+    // Where a channel's sample sits in the interleaved frames
+    int frame(int channel, int i) const { return ((channel / LANES) * currentBlockSize + i) * LANES + channel % LANES; }
+
+    float computeGainReduction(float overDb) const;
+    void updateGainTable();
+    void updateAutoReleaseTable();
     float computeAutoRelease(float inputLevel);
+    float levelsToGains(float* levels, int numSamples, float loudest);
+    float processChunk(SampleType* const* data, int numChannels, int numSamples);
+    float compressWideband(int numChannels, int numSamples);
+    float compressBands(int numChannels, int numSamples);
+    void filterSidechain(int group, int numLanes, int numSamples);
     void updateCoefficients();
-    void applySaturation(float& sample, Mode mode);
+    void updateCrossovers();
+    void updateBandCoefficients();
+    void clearBands();
+    void updateDelays();
+    void clearDelays();
+    void clearHistories();
+    void delayPaths(SampleType* const* data, int numChannels, int numSamples);
+    int getSaturationLatency() const;
+    void applySaturation(SampleType& sample, Mode mode);
+    void saturateOversampled(int numChannels, int numSamples);
+    void upsample(int stage, int group, const Register* input, Register* output, int numSamples);
+    void downsample(int stage, int group, const Register* input, Register* output, int numSamples);
 
     // Parameters
     float threshold = -20.0f;
@@ -74,12 +147,22 @@ private:
     float mix = 1.0f;
     float stereoLink = 1.0f;
     float sidechainHPFFreq = 60.0f;
+    float lookaheadMs = 0.0f;
     bool autoRelease = false;
     bool sidechainListen = false;
     bool midSideMode = false;
     bool bypassed = false;
     Mode currentMode = Mode::Clean;
 
+    // Gain computer. The static curve is baked into a table indexed by level over the
+    // threshold, rebuilt when the ratio or knee changes. It spans the widest knee with a point
+    // to spare either side; the flat first segment and the straight last one extend past it.
+    static constexpr int GAIN_TABLE_POINTS_PER_DB = 32;
+    static constexpr float GAIN_TABLE_MIN_DB = -11.0f;
+    static constexpr int GAIN_TABLE_SIZE = 22 * GAIN_TABLE_POINTS_PER_DB + 1;   // Up to +11dB
+    std::array<float, GAIN_TABLE_SIZE> gainTable {};        // Gain in dB, zero or below
+    std::array<float, GAIN_TABLE_SIZE> gainTableSlope {};   // Change to the next point
+
     // Coefficients
     float attackCoeff = 0.0f;
     float releaseCoeff = 0.0f;
@@ -88,23 +171,119 @@ private:
     // State
     double currentSampleRate = 44100.0;
     int currentBlockSize = 512;
+    int numPreparedChannels = 2;
 
-    // Envelope followers (L/R or M/S)
-    float envelopeL = 0.0f;
-    float envelopeR = 0.0f;
-    float gainReductionL = 0.0f;
-    float gainReductionR = 0.0f;
+    // Envelope followers, one per channel (L/R or M/S on the first pair). A fully linked
+    // detector uses the first.
+    std::array<float, MAX_CHANNELS> envelopes {};
 
     // Sidechain HPF
     struct BiquadState
     {
-        float x1 = 0.0f, x2 = 0.0f;
-        float y1 = 0.0f, y2 = 0.0f;
+        SampleType x1 = 0, x2 = 0;
+        SampleType y1 = 0, y2 = 0;
+    };
+    std::array<BiquadState, MAX_CHANNELS> scHpfStates;
+    DSPUtils::BiquadCoefficients<SampleType> scHpfCoeffs;
+
+    // Interleaved scratch, currentBlockSize frames per group of LANES channels
+    std::vector<Register> inputFrames, sidechainFrames, gainFrames;
+    std::vector<float> peakLevels;   // Loudest sidechain level across all channels per sample
+    std::vector<float> detectorLevels;   // Envelope, then gain, per sample for each detector
+    std::vector<int> gainTableIndices;
+
+    // Look-ahead. The wet and dry paths are delayed while the detector takes the loudest
+    // sidechain level over the delay, so the gain is already down when a peak comes out. The dry
+    // path also makes up for the oversampled saturation's latency.
+    static constexpr float MAX_LOOKAHEAD_MS = 10.0f;
+    int lookaheadSamples = 0;
+    int maxLookaheadSamples = 0;
+    int lookaheadPosition = 0;
+    int dryDelaySamples = 0;
+    int maxDryDelaySamples = 0;
+    int dryDelayPosition = 0;
+    std::vector<Register> wetDelay;     // maxLookaheadSamples frames per group
+    std::vector<SampleType> dryDelay;   // maxDryDelaySamples per channel
+    DSPUtils::SlidingMaximum peakWindow;
+    std::array<DSPUtils::SlidingMaximum, MAX_CHANNELS> levelWindows;
+
+    // Multiband. Bands take the lanes of a register, LANES to one for the crossovers and
+    // LEVEL_LANES for the detectors, so the detectors, gains and sum cost the same for every
+    // band in a register. Each crossover is a stage every band goes through: the bands either
+    // side of it take its low or high pass, those below take the matching all pass, which keeps
+    // them in phase so they sum back flat. The crossovers are most of the cost, two filter
+    // passes over the block each, so it still grows with the band count: four bands came to
+    // about twice the wideband compressor. Five bands don't fit a four lane register (SSE
+    // float), and the second register about doubles that again. The benchmark's "bands" table
+    // measures it.
+    using LevelRegister = juce::dsp::SIMDRegister<float>;
+    static constexpr int LEVEL_LANES = static_cast<int>(LevelRegister::SIMDNumElements);
+    static constexpr int MAX_BAND_REGISTERS = (MAX_BANDS + LANES - 1) / LANES;
+    static constexpr int MAX_LEVEL_REGISTERS = (MAX_BANDS + LEVEL_LANES - 1) / LEVEL_LANES;
+    static constexpr int SECTIONS_PER_CROSSOVER = 2;   // Two Butterworth sections make an LR4
+
+    struct BandSettings
+    {
+        float thresholdDb = -20.0f;
+        float ratio = 2.0f;
+        float attackMs = 10.0f;
+        float releaseMs = 200.0f;
+    };
+
+    struct RegisterBiquad
+    {
+        Register b0, b1, b2, a1, a2;
+    };
+
+    struct RegisterBiquadState
+    {
+        Register x1, x2, y1, y2;
     };
-    BiquadState scHpfStateL, scHpfStateR;
-    DSPUtils::BiquadCoeffs scHpfCoeffs;
 
-    // Auto-release state
+    // Crossover sections by band register, then crossover, then section
+    static constexpr int sectionIndex(int bandRegister, int crossover, int section)
+    {
+        return (bandRegister * MAX_CROSSOVERS + crossover) * SECTIONS_PER_CROSSOVER + section;
+    }
+
+    void splitBands(int firstChannel, int numChannels, int numSamples);
+    template <int NumChains>
+    static void filterChains(const RegisterBiquad& c, const std::array<Register*, NumChains>& samples,
+                             const std::array<RegisterBiquadState*, NumChains>& states, int numSamples);
+    void alignDryPhase(SampleType* const* data, int numChannels, int numSamples);
+    float bandLevelsToGains(LevelRegister* levels, int numSamples);
+
+    int numBands = 1;
+    std::array<float, MAX_CROSSOVERS> crossoverFrequencies {};
+    std::array<BandSettings, MAX_BANDS> bandSettings;
+    std::array<RegisterBiquad, MAX_BAND_REGISTERS * MAX_CROSSOVERS * SECTIONS_PER_CROSSOVER> crossoverSections {};
+
+    // The bands sum to the crossovers' all passes rather than to the input, so the dry path of
+    // a parallel mix goes through the same all passes to stay in phase with them
+    std::array<RegisterBiquad, MAX_CROSSOVERS> crossoverAllPasses {};
+    std::vector<RegisterBiquadState> dryAllPassStates;   // MAX_CROSSOVERS per group
+
+    // Per band lane; unused lanes get no gain
+    std::array<LevelRegister, MAX_LEVEL_REGISTERS> bandThresholds {}, bandSlopes {};
+    std::array<LevelRegister, MAX_LEVEL_REGISTERS> bandAttackCoeffs {}, bandReleaseCoeffs {};
+    std::array<std::array<LevelRegister, MAX_LEVEL_REGISTERS>, MAX_CHANNELS> bandEnvelopes {};
+
+    // Filter states for the sidechain's split, then the audio's, sectionIndex() order per channel
+    std::vector<RegisterBiquadState> bandStates;
+    std::vector<Register> bandFrames;        // Audio bands, MAX_BAND_REGISTERS per channel
+    std::vector<Register> sidechainBands;    // One pair of channels' sidechain bands
+    std::vector<LevelRegister> bandLevels;   // Per sample, the band levels of each channel, then gains
+    std::vector<LevelRegister> bandPeaks;    // Per sample, the loudest channel in each band
+    std::vector<DSPUtils::LaneSlidingMaximum<LevelRegister>> bandWindows;   // Look-ahead, per channel and level register
+
+    // Auto-release. Release coefficients are tabulated against the smoothed level whenever the
+    // sample rate changes and interpolated per sample.
+    static constexpr float AUTO_RELEASE_MIN_MS = 50.0f;
+    static constexpr float AUTO_RELEASE_MAX_MS = 500.0f;
+    static constexpr float AUTO_RELEASE_SMOOTH_MS = 100.0f;
+    static constexpr int AUTO_RELEASE_TABLE_SEGMENTS = 128;
+    std::array<float, AUTO_RELEASE_TABLE_SEGMENTS + 1> autoReleaseTable {};
+    float autoReleaseSmoothCoeff = 0.0f;
     float autoReleaseEnvelope = 0.0f;
 
     // Metering (atomic for thread safety)
@@ -112,6 +291,21 @@ private:
     std::atomic<float> inputLevel { 0.0f };
     std::atomic<float> outputLevel { 0.0f };
 
-    // Saturation state for vintage mode
-    float saturationState = 0.0f;
+    // Saturation state for vintage mode. Its smoothing is scaled to the oversampled rate, so the
+    // time constant stays what it is at the base rate.
+    SampleType saturationState = 0;
+    SampleType saturationSmoothing = static_cast<SampleType>(0.99);
+
+    // Oversampled saturation. Polyphase: going up, the zeros stuffed between samples are never
+    // multiplied, and going down only the outputs that are kept get worked out. Channels stay in
+    // their lanes, so each stage costs one pass per group. Clean goes through the same filters
+    // without saturating, so its latency matches and switching mode never clears anything.
+    int oversamplingStages = 0;
+    std::array<std::vector<Register>, MAX_OVERSAMPLING_STAGES> upTaps, downTaps;   // K each, x2 going up
+    std::array<std::vector<Register>, MAX_OVERSAMPLING_STAGES> upHistories;      // 2K - 1 per group
+    std::array<std::vector<Register>, MAX_OVERSAMPLING_STAGES> evenHistories;    // K per group
+    std::array<std::vector<Register>, MAX_OVERSAMPLING_STAGES> oddHistories;     // 2K per group
+    std::vector<Register> oversampledFrames;     // currentBlockSize * MAX_OVERSAMPLING per group
+    std::vector<Register> oversamplingScratch;   // The stages between, one group at a time
+    std::vector<Register> halfBandBuffer;        // A stage's input after its history
 };
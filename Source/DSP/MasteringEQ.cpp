@@ -1,39 +1,406 @@
 #include "MasteringEQ.h"
+#include <complex>
 
 //==============================================================================
 // BiquadFilter
 //==============================================================================
-void BiquadFilter::setCoefficients(const DSPUtils::BiquadCoeffs& c)
+template <typename SampleType>
+void BiquadFilter<SampleType>::setCoefficients(const Coefficients& c)
 {
     coeffs = c;
 }
 
-void BiquadFilter::reset()
+template <typename SampleType>
+void BiquadFilter<SampleType>::reset()
 {
     x1 = x2 = y1 = y2 = 0.0f;
 }
 
-float BiquadFilter::processSample(float input)
+template <typename SampleType>
+template <int NumSections>
+void BiquadFilter<SampleType>::processSections(BiquadFilter* const* sections, SampleType* data, int numSamples)
 {
-    float output = coeffs.b0 * input + coeffs.b1 * x1 + coeffs.b2 * x2
-                   - coeffs.a1 * y1 - coeffs.a2 * y2;
-    x2 = x1;
-    x1 = input;
-    y2 = y1;
-    y1 = output;
-    return output;
+    std::array<SampleType, NumSections> b0, b1, b2, a1, a2, sx1, sx2, sy1, sy2;
+    for (int s = 0; s < NumSections; ++s)
+    {
+        const auto& f = *sections[s];
+        b0[s] = f.coeffs.b0; b1[s] = f.coeffs.b1; b2[s] = f.coeffs.b2;
+        a1[s] = f.coeffs.a1; a2[s] = f.coeffs.a2;
+        sx1[s] = f.x1; sx2[s] = f.x2; sy1[s] = f.y1; sy2[s] = f.y2;
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        SampleType sample = data[i];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const SampleType output = b0[s] * sample + b1[s] * sx1[s] + b2[s] * sx2[s] - a1[s] * sy1[s] - a2[s] * sy2[s];
+            sx2[s] = sx1[s];
+            sx1[s] = sample;
+            sy2[s] = sy1[s];
+            sy1[s] = output;
+            sample = output;
+        }
+        data[i] = sample;
+    }
+
+    for (int s = 0; s < NumSections; ++s)
+    {
+        auto& f = *sections[s];
+        f.x1 = sx1[s]; f.x2 = sx2[s]; f.y1 = sy1[s]; f.y2 = sy2[s];
+    }
+}
+
+template <typename SampleType>
+void BiquadFilter<SampleType>::processCascade(BiquadFilter* const* sections, int numSections, SampleType* data, int numSamples)
+{
+    while (numSections > 0)
+    {
+        const int numInPass = std::min(numSections, 4);
+        switch (numInPass)
+        {
+            case 4:  processSections<4>(sections, data, numSamples); break;
+            case 3:  processSections<3>(sections, data, numSamples); break;
+            case 2:  processSections<2>(sections, data, numSamples); break;
+            default: processSections<1>(sections, data, numSamples); break;
+        }
+
+        sections += numInPass;
+        numSections -= numInPass;
+    }
+}
+
+//==============================================================================
+// SVFFilter
+//==============================================================================
+template <typename SampleType>
+void SVFFilter<SampleType>::prepare(double sampleRate)
+{
+    rampLength = juce::roundToInt(sampleRate * RAMP_SECONDS);
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::setTarget(const Coefficients& newTarget)
+{
+    setTarget(newTarget, rampLength);
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::setTarget(const Coefficients& newTarget, int numRampSamples)
+{
+    if (newTarget == target)
+        return;
+
+    if (!isActive())
+    {
+        // Joining the signal path: start clean at the new tuning and let only the mix ramp in
+        reset();
+        current = newTarget.withoutEffect();
+    }
+
+    target = newTarget;
+    if (numRampSamples <= 0 || !isActive())
+    {
+        snapToTarget();
+        return;
+    }
+
+    const SampleType scale = 1.0f / static_cast<SampleType>(numRampSamples);
+    step.g = (target.g - current.g) * scale;
+    step.k = (target.k - current.k) * scale;
+    step.m0 = (target.m0 - current.m0) * scale;
+    step.m1 = (target.m1 - current.m1) * scale;
+    step.m2 = (target.m2 - current.m2) * scale;
+    rampRemaining = numRampSamples;
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::snapToTarget()
+{
+    current = target;
+    rampRemaining = 0;
+    updateGains();
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::reset()
+{
+    ic1eq = ic2eq = 0.0f;
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::updateGains()
+{
+    a1 = 1.0f / (1.0f + current.g * (current.g + current.k));
+    a2 = current.g * a1;
+    a3 = current.g * a2;
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::process(SampleType* data, int numSamples)
+{
+    SampleType s1 = ic1eq, s2 = ic2eq;
+    int i = 0;
+
+    // While ramping every coefficient steps once per sample and the gains are rederived,
+    // which costs a division but no trig
+    const int numRamp = std::min(rampRemaining, numSamples);
+    if (numRamp > 0)
+    {
+        auto c = current;
+        for (; i < numRamp; ++i)
+        {
+            c.g += step.g;
+            c.k += step.k;
+            c.m0 += step.m0;
+            c.m1 += step.m1;
+            c.m2 += step.m2;
+
+            const SampleType g1 = 1.0f / (1.0f + c.g * (c.g + c.k));
+            const SampleType g2 = c.g * g1;
+            const SampleType v0 = data[i];
+            const SampleType v3 = v0 - s2;
+            const SampleType v1 = g1 * s1 + g2 * v3;
+            const SampleType v2 = s2 + g2 * s1 + c.g * g2 * v3;
+            s1 = 2.0f * v1 - s1;
+            s2 = 2.0f * v2 - s2;
+            data[i] = c.m0 * v0 + c.m1 * v1 + c.m2 * v2;
+        }
+
+        rampRemaining -= numRamp;
+        current = rampRemaining == 0 ? target : c;   // Drop the rounding the steps picked up
+        updateGains();
+    }
+
+    const SampleType m0 = current.m0, m1 = current.m1, m2 = current.m2;
+    for (; i < numSamples; ++i)
+    {
+        const SampleType v0 = data[i];
+        const SampleType v3 = v0 - s2;
+        const SampleType v1 = a1 * s1 + a2 * v3;
+        const SampleType v2 = s2 + a2 * s1 + a3 * v3;
+        s1 = 2.0f * v1 - s1;
+        s2 = 2.0f * v2 - s2;
+        data[i] = m0 * v0 + m1 * v1 + m2 * v2;
+    }
+
+    ic1eq = s1;
+    ic2eq = s2;
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::processCascade(SVFFilter* const* sections, int numSections, SampleType* data, int numSamples)
+{
+    for (int i = 0; i < numSections; ++i)
+        sections[i]->process(data, numSamples);
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::processRampLanes(SVFFilter* const* filters, int numLanes, Frame* frames, int numSamples)
+{
+    const auto lanes = [filters, numLanes] (auto&& value)
+    {
+        auto reg = Frame::expand(0.0f);
+        for (int lane = 0; lane < numLanes; ++lane)
+            reg.set(static_cast<size_t>(lane), value(*filters[lane]));
+        return reg;
+    };
+
+    auto g = lanes([] (const SVFFilter& f) { return f.current.g; });
+    auto k = lanes([] (const SVFFilter& f) { return f.current.k; });
+    auto m0 = lanes([] (const SVFFilter& f) { return f.current.m0; });
+    auto m1 = lanes([] (const SVFFilter& f) { return f.current.m1; });
+    auto m2 = lanes([] (const SVFFilter& f) { return f.current.m2; });
+    const auto stepG = lanes([] (const SVFFilter& f) { return f.step.g; });
+    const auto stepK = lanes([] (const SVFFilter& f) { return f.step.k; });
+    const auto stepM0 = lanes([] (const SVFFilter& f) { return f.step.m0; });
+    const auto stepM1 = lanes([] (const SVFFilter& f) { return f.step.m1; });
+    const auto stepM2 = lanes([] (const SVFFilter& f) { return f.step.m2; });
+    auto s1 = lanes([] (const SVFFilter& f) { return f.ic1eq; });
+    auto s2 = lanes([] (const SVFFilter& f) { return f.ic2eq; });
+    const auto one = Frame::expand(1.0f);
+
+    // SIMDRegister has no division, so the reciprocals go through memory. Unused lanes have
+    // g = 0 and so a denominator of 1.
+    alignas(Frame::SIMDRegisterSize) SampleType denominators[Frame::SIMDNumElements];
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        g = g + stepG;
+        k = k + stepK;
+        m0 = m0 + stepM0;
+        m1 = m1 + stepM1;
+        m2 = m2 + stepM2;
+
+        (one + g * (g + k)).copyToRawArray(denominators);
+        for (int lane = 0; lane < numLanes; ++lane)
+            denominators[lane] = 1.0f / denominators[lane];
+        const auto g1 = Frame::fromRawArray(denominators);
+        const auto g2 = g * g1;
+
+        const auto v0 = frames[i];
+        const auto v3 = v0 - s2;
+        const auto v1 = g1 * s1 + g2 * v3;
+        const auto v2 = s2 + g2 * s1 + g * g2 * v3;
+        s1 = v1 + v1 - s1;
+        s2 = v2 + v2 - s2;
+        frames[i] = m0 * v0 + m1 * v1 + m2 * v2;
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto& filter = *filters[lane];
+        const auto l = static_cast<size_t>(lane);
+        filter.current = { g.get(l), k.get(l), m0.get(l), m1.get(l), m2.get(l) };
+        filter.rampRemaining -= numSamples;
+        if (filter.rampRemaining == 0)
+            filter.current = filter.target;
+        filter.updateGains();
+        filter.ic1eq = s1.get(l);
+        filter.ic2eq = s2.get(l);
+    }
+}
+
+template <typename SampleType>
+template <int NumSections>
+void SVFFilter<SampleType>::processSectionsLanes(SVFFilter* const* const* sections, int numLanes, int first,
+                                                 Frame* frames, int numSamples)
+{
+    // Gathered through plain arrays for the same reason as BiquadCascade::processSectionsLanes
+    constexpr int numTerms = 8;
+    constexpr auto numElements = Frame::SIMDNumElements;
+    alignas(Frame::SIMDRegisterSize) SampleType terms[numTerms][NumSections][numElements];
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const auto& f = *sections[lane][first + s];
+            const SampleType values[numTerms] = { f.a1, f.a2, f.a3, f.current.m0, f.current.m1, f.current.m2,
+                                                  f.ic1eq, f.ic2eq };
+            for (int t = 0; t < numTerms; ++t)
+                terms[t][s][lane] = values[t];
+        }
+    }
+    for (int t = 0; t < numTerms; ++t)
+        for (int s = 0; s < NumSections; ++s)
+            for (auto lane = static_cast<size_t>(numLanes); lane < numElements; ++lane)
+                terms[t][s][lane] = 0.0f;
+
+    std::array<Frame, NumSections> a1, a2, a3, m0, m1, m2, s1, s2;
+    for (int s = 0; s < NumSections; ++s)
+    {
+        a1[s] = Frame::fromRawArray(terms[0][s]); a2[s] = Frame::fromRawArray(terms[1][s]);
+        a3[s] = Frame::fromRawArray(terms[2][s]);
+        m0[s] = Frame::fromRawArray(terms[3][s]); m1[s] = Frame::fromRawArray(terms[4][s]);
+        m2[s] = Frame::fromRawArray(terms[5][s]);
+        s1[s] = Frame::fromRawArray(terms[6][s]); s2[s] = Frame::fromRawArray(terms[7][s]);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto sample = frames[i];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const auto v3 = sample - s2[s];
+            const auto v1 = a1[s] * s1[s] + a2[s] * v3;
+            const auto v2 = s2[s] + a2[s] * s1[s] + a3[s] * v3;
+            s1[s] = v1 + v1 - s1[s];
+            s2[s] = v2 + v2 - s2[s];
+            sample = m0[s] * sample + m1[s] * v1 + m2[s] * v2;
+        }
+        frames[i] = sample;
+    }
+
+    for (int s = 0; s < NumSections; ++s)
+    {
+        s1[s].copyToRawArray(terms[6][s]);
+        s2[s].copyToRawArray(terms[7][s]);
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        for (int s = 0; s < NumSections; ++s)
+        {
+            auto& f = *sections[lane][first + s];
+            f.ic1eq = terms[6][s][lane];
+            f.ic2eq = terms[7][s][lane];
+        }
+    }
+}
+
+template <typename SampleType>
+void SVFFilter<SampleType>::processCascadeLanes(SVFFilter* const* const* lanes, int numLanes, int numSections,
+                                                Frame* frames, int numSamples)
+{
+    // Ramps are short, so the samples any section is still ramping over go one section at a
+    // time and the rest of the block takes the interleaved path below
+    int rampEnd = 0;
+    for (int s = 0; s < numSections; ++s)
+        rampEnd = std::max(rampEnd, std::min(lanes[0][s]->rampRemaining, numSamples));
+
+    if (rampEnd > 0)
+    {
+        std::array<SVFFilter*, Frame::SIMDNumElements> filters;
+        for (int s = 0; s < numSections; ++s)
+        {
+            const int numRamp = std::min(lanes[0][s]->rampRemaining, rampEnd);
+            if (numRamp > 0)
+            {
+                for (int lane = 0; lane < numLanes; ++lane)
+                    filters[static_cast<size_t>(lane)] = lanes[lane][s];
+                processRampLanes(filters.data(), numLanes, frames, numRamp);
+            }
+            if (numRamp < rampEnd)
+                processSectionsLanes<1>(lanes, numLanes, s, frames + numRamp, rampEnd - numRamp);
+        }
+
+        frames += rampEnd;
+        numSamples -= rampEnd;
+    }
+
+    for (int first = 0; first < numSections;)
+    {
+        const int numInPass = std::min(numSections - first, 4);
+        switch (numInPass)
+        {
+            case 4:  processSectionsLanes<4>(lanes, numLanes, first, frames, numSamples); break;
+            case 3:  processSectionsLanes<3>(lanes, numLanes, first, frames, numSamples); break;
+            case 2:  processSectionsLanes<2>(lanes, numLanes, first, frames, numSamples); break;
+            default: processSectionsLanes<1>(lanes, numLanes, first, frames, numSamples); break;
+        }
+
+        first += numInPass;
+    }
 }
 
 //==============================================================================
 // MultiStageFilter
 //==============================================================================
-void MultiStageFilter::prepare(double sampleRate)
+template <typename SampleType>
+void MultiStageFilter<SampleType>::prepare(double sampleRate)
 {
     currentSampleRate = sampleRate;
+    for (auto& stage : svfStages)
+        stage.prepare(sampleRate);
+
+    updateCoefficients();
+    for (auto& stage : svfStages)
+        stage.snapToTarget();
     reset();
 }
 
-void MultiStageFilter::setParameters(Type type, float freq, int order)
+template <typename SampleType>
+void MultiStageFilter<SampleType>::setEnabled(bool shouldEnable)
+{
+    if (shouldEnable == enabled)
+        return;
+
+    enabled = shouldEnable;
+    updateSVFTargets();
+}
+
+template <typename SampleType>
+void MultiStageFilter<SampleType>::setParameters(Type type, float freq, int order)
 {
     filterType = type;
     frequency = std::clamp(freq, 10.0f, static_cast<float>(currentSampleRate * 0.45));
@@ -41,365 +408,1928 @@ void MultiStageFilter::setParameters(Type type, float freq, int order)
     updateCoefficients();
 }
 
-void MultiStageFilter::reset()
+template <typename SampleType>
+void MultiStageFilter<SampleType>::reset()
 {
     for (auto& stage : stages)
         stage.reset();
+    for (auto& stage : svfStages)
+        stage.reset();
 }
 
-void MultiStageFilter::updateCoefficients()
+template <typename SampleType>
+void MultiStageFilter<SampleType>::updateCoefficients()
 {
-    int numStages = filterOrder;
-    for (int i = 0; i < numStages; ++i)
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    const bool highPass = filterType == Type::HighPass;
+    int section = 0;
+
+    if (filterOrder % 2 == 1)
+    {
+        stages[0].setCoefficients(highPass ? DSPUtils::calculateFirstOrderHighPass<SampleType>(sampleRate, frequency)
+                                           : DSPUtils::calculateFirstOrderLowPass<SampleType>(sampleRate, frequency));
+        svfCoeffs[0] = highPass ? DSPUtils::calculateSVFFirstOrderHighPass<SampleType>(sampleRate, frequency)
+                                : DSPUtils::calculateSVFFirstOrderLowPass<SampleType>(sampleRate, frequency);
+        ++section;
+    }
+
+    for (int i = 0; i < filterOrder / 2; ++i, ++section)
     {
         float Q = DSPUtils::calculateButterworthQ(filterOrder, i);
-        DSPUtils::BiquadCoeffs c;
 
-        if (filterType == Type::HighPass)
-            c = DSPUtils::calculateHighPass(static_cast<float>(currentSampleRate), frequency, Q);
+        if (highPass)
+        {
+            stages[section].setCoefficients(DSPUtils::calculateHighPass<SampleType>(sampleRate, frequency, Q));
+            svfCoeffs[section] = DSPUtils::calculateSVFHighPass<SampleType>(sampleRate, frequency, Q);
+        }
         else
-            c = DSPUtils::calculateLowPass(static_cast<float>(currentSampleRate), frequency, Q);
+        {
+            stages[section].setCoefficients(DSPUtils::calculateLowPass<SampleType>(sampleRate, frequency, Q));
+            svfCoeffs[section] = DSPUtils::calculateSVFLowPass<SampleType>(sampleRate, frequency, Q);
+        }
+    }
 
-        stages[i].setCoefficients(c);
+    updateSVFTargets();
+}
+
+template <typename SampleType>
+void MultiStageFilter<SampleType>::updateSVFTargets()
+{
+    // Sections dropped by a lower order keep their last tuning while they ramp out
+    const int numSections = (filterOrder + 1) / 2;
+    for (int i = 0; i < MAX_SECTIONS; ++i)
+    {
+        const bool inPath = enabled && i < numSections;
+        svfStages[i].setTarget(inPath ? svfCoeffs[i] : svfCoeffs[i].withoutEffect());
+    }
+}
+
+//==============================================================================
+// BiquadCascade
+//==============================================================================
+template <typename SampleType>
+void BiquadCascade<SampleType>::setCoefficients(int section, const DSPUtils::BiquadCoefficients<SampleType>& c)
+{
+    b0[section] = c.b0; b1[section] = c.b1; b2[section] = c.b2;
+    a1[section] = c.a1; a2[section] = c.a2;
+}
+
+template <typename SampleType>
+void BiquadCascade<SampleType>::reset()
+{
+    x1.fill(0.0f); x2.fill(0.0f);
+    y1.fill(0.0f); y2.fill(0.0f);
+}
+
+template <typename SampleType>
+void BiquadCascade<SampleType>::copyState(int section, const BiquadCascade& source, int sourceSection)
+{
+    x1[section] = source.x1[sourceSection]; x2[section] = source.x2[sourceSection];
+    y1[section] = source.y1[sourceSection]; y2[section] = source.y2[sourceSection];
+}
+
+template <typename SampleType>
+void BiquadCascade<SampleType>::setPassThroughState(int section, SampleType previous, SampleType beforePrevious)
+{
+    x1[section] = y1[section] = previous;
+    x2[section] = y2[section] = beforePrevious;
+}
+
+template <typename SampleType>
+template <int NumSections>
+void BiquadCascade<SampleType>::processSections(int first, SampleType* data, int numSamples)
+{
+    std::array<SampleType, NumSections> sb0, sb1, sb2, sa1, sa2, sx1, sx2, sy1, sy2;
+    for (int s = 0; s < NumSections; ++s)
+    {
+        sb0[s] = b0[first + s]; sb1[s] = b1[first + s]; sb2[s] = b2[first + s];
+        sa1[s] = a1[first + s]; sa2[s] = a2[first + s];
+        sx1[s] = x1[first + s]; sx2[s] = x2[first + s]; sy1[s] = y1[first + s]; sy2[s] = y2[first + s];
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        SampleType sample = data[i];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const SampleType output = sb0[s] * sample + sb1[s] * sx1[s] + sb2[s] * sx2[s] - sa1[s] * sy1[s] - sa2[s] * sy2[s];
+            sx2[s] = sx1[s];
+            sx1[s] = sample;
+            sy2[s] = sy1[s];
+            sy1[s] = output;
+            sample = output;
+        }
+        data[i] = sample;
+    }
+
+    for (int s = 0; s < NumSections; ++s)
+    {
+        x1[first + s] = sx1[s]; x2[first + s] = sx2[s]; y1[first + s] = sy1[s]; y2[first + s] = sy2[s];
+    }
+}
+
+template <typename SampleType>
+void BiquadCascade<SampleType>::process(SampleType* data, int numSamples)
+{
+    for (int first = 0; first < numSections;)
+    {
+        const int numInPass = std::min(numSections - first, 4);
+        switch (numInPass)
+        {
+            case 4:  processSections<4>(first, data, numSamples); break;
+            case 3:  processSections<3>(first, data, numSamples); break;
+            case 2:  processSections<2>(first, data, numSamples); break;
+            default: processSections<1>(first, data, numSamples); break;
+        }
+
+        first += numInPass;
+    }
+}
+
+template <typename SampleType>
+template <int NumSections>
+void BiquadCascade<SampleType>::processSectionsLanes(BiquadCascade* const* cascades, int numLanes, int first,
+                                                     Frame* frames, int numSamples)
+{
+    // Gather through plain arrays first: filling the registers lane by lane inside the section
+    // loop stops the compiler keeping the cascade in registers across the sample loop
+    constexpr int numTerms = 9;
+    constexpr auto numElements = Frame::SIMDNumElements;
+    alignas(Frame::SIMDRegisterSize) SampleType terms[numTerms][NumSections][numElements];
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        const auto& c = *cascades[lane];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const auto index = static_cast<size_t>(first + s);
+            const SampleType values[numTerms] = { c.b0[index], c.b1[index], c.b2[index], c.a1[index], c.a2[index],
+                                                  c.x1[index], c.x2[index], c.y1[index], c.y2[index] };
+            for (int t = 0; t < numTerms; ++t)
+                terms[t][s][lane] = values[t];
+        }
+    }
+    for (int t = 0; t < numTerms; ++t)
+        for (int s = 0; s < NumSections; ++s)
+            for (auto lane = static_cast<size_t>(numLanes); lane < numElements; ++lane)
+                terms[t][s][lane] = 0.0f;
+
+    std::array<Frame, NumSections> b0, b1, b2, a1, a2, sx1, sx2, sy1, sy2;
+    for (int s = 0; s < NumSections; ++s)
+    {
+        b0[s] = Frame::fromRawArray(terms[0][s]); b1[s] = Frame::fromRawArray(terms[1][s]);
+        b2[s] = Frame::fromRawArray(terms[2][s]);
+        a1[s] = Frame::fromRawArray(terms[3][s]); a2[s] = Frame::fromRawArray(terms[4][s]);
+        sx1[s] = Frame::fromRawArray(terms[5][s]); sx2[s] = Frame::fromRawArray(terms[6][s]);
+        sy1[s] = Frame::fromRawArray(terms[7][s]); sy2[s] = Frame::fromRawArray(terms[8][s]);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto sample = frames[i];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const auto output = b0[s] * sample + b1[s] * sx1[s] + b2[s] * sx2[s] - a1[s] * sy1[s] - a2[s] * sy2[s];
+            sx2[s] = sx1[s];
+            sx1[s] = sample;
+            sy2[s] = sy1[s];
+            sy1[s] = output;
+            sample = output;
+        }
+        frames[i] = sample;
+    }
+
+    for (int s = 0; s < NumSections; ++s)
+    {
+        sx1[s].copyToRawArray(terms[5][s]); sx2[s].copyToRawArray(terms[6][s]);
+        sy1[s].copyToRawArray(terms[7][s]); sy2[s].copyToRawArray(terms[8][s]);
+    }
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto& c = *cascades[lane];
+        for (int s = 0; s < NumSections; ++s)
+        {
+            const auto index = static_cast<size_t>(first + s);
+            c.x1[index] = terms[5][s][lane]; c.x2[index] = terms[6][s][lane];
+            c.y1[index] = terms[7][s][lane]; c.y2[index] = terms[8][s][lane];
+        }
     }
 }
 
-float MultiStageFilter::processSample(float input)
+template <typename SampleType>
+void BiquadCascade<SampleType>::processLanes(BiquadCascade* const* cascades, int numLanes, Frame* frames, int numSamples)
 {
-    if (!enabled) return input;
+    const int numSections = cascades[0]->numSections;
+    for (int first = 0; first < numSections;)
+    {
+        const int numInPass = std::min(numSections - first, 4);
+        switch (numInPass)
+        {
+            case 4:  processSectionsLanes<4>(cascades, numLanes, first, frames, numSamples); break;
+            case 3:  processSectionsLanes<3>(cascades, numLanes, first, frames, numSamples); break;
+            case 2:  processSectionsLanes<2>(cascades, numLanes, first, frames, numSamples); break;
+            default: processSectionsLanes<1>(cascades, numLanes, first, frames, numSamples); break;
+        }
 
-    float output = input;
-    for (int i = 0; i < filterOrder; ++i)
-        output = stages[i].processSample(output);
-    return output;
+        first += numInPass;
+    }
 }
 
 //==============================================================================
-// ParametricBand
+// BandDynamics
 //==============================================================================
-void ParametricBand::prepare(double sampleRate)
+void BandDynamics::prepare(double sampleRate)
 {
-    currentSampleRate = sampleRate;
+    controlRate = sampleRate / CONTROL_INTERVAL;
     updateCoefficients();
+    reset();
 }
 
-void ParametricBand::setParameters(float freq, float gain, float q)
+void BandDynamics::setParameters(bool shouldBeEnabled, float thresholdDb, float newRatio, float newAttackMs, float newReleaseMs)
 {
-    frequency = std::clamp(freq, 20.0f, static_cast<float>(currentSampleRate * 0.45));
-    gainDb = std::clamp(gain, -18.0f, 18.0f);
-    qFactor = std::clamp(q, 0.1f, 10.0f);
+    // A band that comes back starts from rest rather than from an old envelope
+    if (shouldBeEnabled && !enabled)
+        reset();
+
+    enabled = shouldBeEnabled;
+    threshold = std::clamp(thresholdDb, -60.0f, 0.0f);
+    ratio = std::clamp(newRatio, 1.0f, 10.0f);
+    attackMs = std::clamp(newAttackMs, 0.1f, 100.0f);
+    releaseMs = std::clamp(newReleaseMs, 10.0f, 2000.0f);
     updateCoefficients();
 }
 
-void ParametricBand::reset()
+void BandDynamics::updateCoefficients()
 {
-    filter.reset();
+    attackCoeff = DSPUtils::calculateCoefficient(controlRate, attackMs);
+    releaseCoeff = DSPUtils::calculateCoefficient(controlRate, releaseMs);
+    thresholdLinear = DSPUtils::decibelsToLinear(threshold);
+}
+
+float BandDynamics::process(float peak, float rangeDb)
+{
+    envelope += (peak > envelope ? attackCoeff : releaseCoeff) * (peak - envelope);
+
+    // Most intervals sit under the threshold, and those don't need the log
+    if (envelope <= thresholdLinear)
+        return 0.0f;
+
+    const float overDb = DSPUtils::fastLinearToDecibels(envelope) - threshold;
+    const float amountDb = overDb * (1.0f - 1.0f / ratio);
+    return rangeDb < 0.0f ? std::max(-amountDb, rangeDb) : std::min(amountDb, rangeDb);
 }
 
-void ParametricBand::updateCoefficients()
+//==============================================================================
+// BandLevelDetector
+//==============================================================================
+template <typename SampleType>
+void BandLevelDetector<SampleType>::setBand(int band, const DSPUtils::BiquadCoefficients<SampleType>& coeffs)
+{
+    const auto reg = static_cast<size_t>(band / Register::SIMDNumElements);
+    const auto lane = static_cast<size_t>(band % Register::SIMDNumElements);
+    b0[reg].set(lane, coeffs.b0);
+    b1[reg].set(lane, coeffs.b1);
+    b2[reg].set(lane, coeffs.b2);
+    a1[reg].set(lane, coeffs.a1);
+    a2[reg].set(lane, coeffs.a2);
+}
+
+template <typename SampleType>
+void BandLevelDetector<SampleType>::reset()
+{
+    y1 = {};
+    y2 = {};
+    x1 = {};
+    x2 = {};
+}
+
+template <typename SampleType>
+void BandLevelDetector<SampleType>::process(const SampleType* const* data, int numChannels, int stride, int numSamples,
+                                            int intervalLength, Levels* levels)
 {
-    auto c = DSPUtils::calculatePeakingEQ(static_cast<float>(currentSampleRate), frequency, qFactor, gainDb);
-    filter.setCoefficients(c);
+    numChannels = std::min(numChannels, MAX_CHANNELS);
+    for (int first = 0; first < numChannels; first += 2)
+    {
+        if (numChannels - first >= 2)
+            processChannels<2>(data + first, first, stride, numSamples, intervalLength, levels, first > 0);
+        else
+            processChannels<1>(data + first, first, stride, numSamples, intervalLength, levels, first > 0);
+    }
+}
+
+template <typename SampleType>
+template <int NumChannels>
+void BandLevelDetector<SampleType>::processChannels(const SampleType* const* data, int firstChannel, int stride, int numSamples,
+                                                    int intervalLength, Levels* levels, bool combine)
+{
+    // Every lane of a channel sees the same input, so its history is kept as broadcast registers
+    std::array<Register, NumChannels> sx1, sx2;
+    std::array<Levels, NumChannels> sy1, sy2;
+    for (int ch = 0; ch < NumChannels; ++ch)
+    {
+        sx1[ch] = Register::expand(x1[firstChannel + ch]);
+        sx2[ch] = Register::expand(x2[firstChannel + ch]);
+        sy1[ch] = y1[firstChannel + ch];
+        sy2[ch] = y2[firstChannel + ch];
+    }
+
+    for (int start = 0; start < numSamples; start += intervalLength, ++levels)
+    {
+        Levels peak {};
+        const int end = std::min(start + intervalLength, numSamples);
+
+        for (int i = start; i < end; ++i)
+        {
+            for (int ch = 0; ch < NumChannels; ++ch)
+            {
+                const auto input = Register::expand(data[ch][i * stride]);
+                for (int r = 0; r < NUM_REGISTERS; ++r)
+                {
+                    const auto output = b0[r] * input + b1[r] * sx1[ch] + b2[r] * sx2[ch]
+                                      - a1[r] * sy1[ch][r] - a2[r] * sy2[ch][r];
+                    sy2[ch][r] = sy1[ch][r];
+                    sy1[ch][r] = output;
+                    peak[r] = Register::max(peak[r], Register::abs(output));
+                }
+                sx2[ch] = sx1[ch];
+                sx1[ch] = input;
+            }
+        }
+
+        if (combine)
+            for (int r = 0; r < NUM_REGISTERS; ++r)
+                peak[r] = Register::max(peak[r], (*levels)[r]);
+        *levels = peak;
+    }
+
+    for (int ch = 0; ch < NumChannels; ++ch)
+    {
+        x1[firstChannel + ch] = sx1[ch].get(0);
+        x2[firstChannel + ch] = sx2[ch].get(0);
+        y1[firstChannel + ch] = sy1[ch];
+        y2[firstChannel + ch] = sy2[ch];
+    }
 }
 
-float ParametricBand::processSample(float input)
+template <typename SampleType>
+float BandLevelDetector<SampleType>::getLevel(const Levels& levels, int band)
 {
-    if (!enabled || std::abs(gainDb) < 0.01f) return input;
-    return filter.processSample(input);
+    const auto reg = static_cast<size_t>(band / Register::SIMDNumElements);
+    return static_cast<float>(levels[reg].get(static_cast<size_t>(band % Register::SIMDNumElements)));
 }
 
 //==============================================================================
-// ShelfBand
+// ParametricBand
 //==============================================================================
-void ShelfBand::prepare(double sampleRate)
+template <typename SampleType>
+void ParametricBand<SampleType>::prepare(double sampleRate)
 {
     currentSampleRate = sampleRate;
+    svf.prepare(sampleRate);
     updateCoefficients();
+    svf.snapToTarget();
 }
 
-void ShelfBand::setParameters(Type type, float freq, float gain)
+template <typename SampleType>
+void ParametricBand<SampleType>::setEnabled(bool shouldEnable)
+{
+    if (shouldEnable == enabled)
+        return;
+
+    enabled = shouldEnable;
+    updateSVFTarget();
+}
+
+template <typename SampleType>
+void ParametricBand<SampleType>::setParameters(float freq, float gain, float q)
 {
-    shelfType = type;
     frequency = std::clamp(freq, 20.0f, static_cast<float>(currentSampleRate * 0.45));
-    gainDb = std::clamp(gain, -12.0f, 12.0f);
+    gainDb = std::clamp(gain, -18.0f, 18.0f);
+    qFactor = std::clamp(q, 0.1f, 10.0f);
     updateCoefficients();
 }
 
-void ShelfBand::reset()
+template <typename SampleType>
+void ParametricBand<SampleType>::reset()
 {
     filter.reset();
+    svf.reset();
 }
 
-void ShelfBand::updateCoefficients()
+template <typename SampleType>
+void ParametricBand<SampleType>::setDynamic(bool shouldBeDynamic)
 {
-    DSPUtils::BiquadCoeffs c;
-    if (shelfType == Type::Low)
-        c = DSPUtils::calculateLowShelf(static_cast<float>(currentSampleRate), frequency, gainDb);
-    else
-        c = DSPUtils::calculateHighShelf(static_cast<float>(currentSampleRate), frequency, gainDb);
-    filter.setCoefficients(c);
+    if (shouldBeDynamic == dynamic)
+        return;
+
+    dynamic = shouldBeDynamic;
+    dynamicGainDb = 0.0f;
+    updateCoefficients();
 }
 
-float ShelfBand::processSample(float input)
+template <typename SampleType>
+void ParametricBand<SampleType>::setDynamicGain(float newGainDb)
 {
-    if (!enabled || std::abs(gainDb) < 0.01f) return input;
-    return filter.processSample(input);
+    // Redesigning costs some trig, so gains that barely moved are left alone
+    if (!dynamic || std::abs(newGainDb - dynamicGainDb) < 0.01f)
+        return;
+
+    dynamicGainDb = newGainDb;
+    updateFilters(dynamicGainDb, BandDynamics::CONTROL_INTERVAL);
 }
 
-//==============================================================================
-// MasteringEQ
-//==============================================================================
-MasteringEQ::MasteringEQ()
+template <typename SampleType>
+void ParametricBand<SampleType>::setMatchedDesign(bool shouldMatch)
 {
-    // Set default band frequencies
-    // Band 1: 30-300Hz (Low)
-    // Band 2: 100Hz-1kHz (Low-Mid)
-    // Band 3: 300Hz-5kHz (Mid)
-    // Band 4: 1kHz-10kHz (High-Mid)
-    for (auto& ch : channels)
-    {
-        ch.parametric[0].setParameters(80.0f, 0.0f, 1.0f);
-        ch.parametric[1].setParameters(300.0f, 0.0f, 1.0f);
-        ch.parametric[2].setParameters(1000.0f, 0.0f, 1.0f);
-        ch.parametric[3].setParameters(4000.0f, 0.0f, 1.0f);
+    if (shouldMatch == matchedDesign)
+        return;
 
-        ch.lowShelf.setParameters(ShelfBand::Type::Low, 100.0f, 0.0f);
-        ch.highShelf.setParameters(ShelfBand::Type::High, 8000.0f, 0.0f);
+    matchedDesign = shouldMatch;
+    updateCoefficients();
+}
 
-        ch.highPass.setParameters(MultiStageFilter::Type::HighPass, 20.0f, 2);
+template <typename SampleType>
+DSPUtils::BiquadCoefficients<SampleType> ParametricBand<SampleType>::design(float bandGainDb) const
+{
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    return matchedDesign ? DSPUtils::calculateMatchedPeakingEQ<SampleType>(sampleRate, frequency, qFactor, bandGainDb)
+                         : DSPUtils::calculatePeakingEQ<SampleType>(sampleRate, frequency, qFactor, bandGainDb);
+}
+
+template <typename SampleType>
+void ParametricBand<SampleType>::updateCoefficients()
+{
+    coeffs = design(gainDb);
+    updateFilters(dynamic ? dynamicGainDb : gainDb, -1);
+}
+
+template <typename SampleType>
+void ParametricBand<SampleType>::updateFilters(float appliedGainDb, int numRampSamples)
+{
+    const auto applied = appliedGainDb == gainDb ? coeffs : design(appliedGainDb);
+    filter.setCoefficients(applied);
+
+    // The SVF has no matched design of its own, so it runs the biquad's
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    svfCoeffs = matchedDesign ? DSPUtils::biquadToSVF(applied)
+                              : DSPUtils::calculateSVFPeakingEQ<SampleType>(sampleRate, frequency, qFactor, appliedGainDb);
+    if (numRampSamples < 0)
+        updateSVFTarget();
+    else
+        svf.setTarget(isActive() ? svfCoeffs : svfCoeffs.withoutEffect(), numRampSamples);
+}
+
+template <typename SampleType>
+void ParametricBand<SampleType>::updateSVFTarget()
+{
+    svf.setTarget(isActive() ? svfCoeffs : svfCoeffs.withoutEffect());
+}
+
+//==============================================================================
+// ShelfBand
+//==============================================================================
+template <typename SampleType>
+void ShelfBand<SampleType>::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    svf.prepare(sampleRate);
+    updateCoefficients();
+    svf.snapToTarget();
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::setEnabled(bool shouldEnable)
+{
+    if (shouldEnable == enabled)
+        return;
+
+    enabled = shouldEnable;
+    updateSVFTarget();
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::setParameters(Type type, float freq, float gain)
+{
+    shelfType = type;
+    frequency = std::clamp(freq, 20.0f, static_cast<float>(currentSampleRate * 0.45));
+    gainDb = std::clamp(gain, -12.0f, 12.0f);
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::reset()
+{
+    filter.reset();
+    svf.reset();
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::setDynamic(bool shouldBeDynamic)
+{
+    if (shouldBeDynamic == dynamic)
+        return;
+
+    dynamic = shouldBeDynamic;
+    dynamicGainDb = 0.0f;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::setDynamicGain(float newGainDb)
+{
+    if (!dynamic || std::abs(newGainDb - dynamicGainDb) < 0.01f)
+        return;
+
+    dynamicGainDb = newGainDb;
+    updateFilters(dynamicGainDb, BandDynamics::CONTROL_INTERVAL);
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::setMatchedDesign(bool shouldMatch)
+{
+    if (shouldMatch == matchedDesign)
+        return;
+
+    matchedDesign = shouldMatch;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+DSPUtils::BiquadCoefficients<SampleType> ShelfBand<SampleType>::design(float bandGainDb) const
+{
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    if (shelfType == Type::Low)
+        return matchedDesign ? DSPUtils::calculateMatchedLowShelf<SampleType>(sampleRate, frequency, bandGainDb)
+                             : DSPUtils::calculateLowShelf<SampleType>(sampleRate, frequency, bandGainDb);
+
+    return matchedDesign ? DSPUtils::calculateMatchedHighShelf<SampleType>(sampleRate, frequency, bandGainDb)
+                         : DSPUtils::calculateHighShelf<SampleType>(sampleRate, frequency, bandGainDb);
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::updateCoefficients()
+{
+    coeffs = design(gainDb);
+    updateFilters(dynamic ? dynamicGainDb : gainDb, -1);
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::updateFilters(float appliedGainDb, int numRampSamples)
+{
+    const auto applied = appliedGainDb == gainDb ? coeffs : design(appliedGainDb);
+    filter.setCoefficients(applied);
+
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    if (matchedDesign)
+        svfCoeffs = DSPUtils::biquadToSVF(applied);
+    else if (shelfType == Type::Low)
+        svfCoeffs = DSPUtils::calculateSVFLowShelf<SampleType>(sampleRate, frequency, appliedGainDb);
+    else
+        svfCoeffs = DSPUtils::calculateSVFHighShelf<SampleType>(sampleRate, frequency, appliedGainDb);
+
+    if (numRampSamples < 0)
+        updateSVFTarget();
+    else
+        svf.setTarget(isActive() ? svfCoeffs : svfCoeffs.withoutEffect(), numRampSamples);
+}
+
+template <typename SampleType>
+void ShelfBand<SampleType>::updateSVFTarget()
+{
+    svf.setTarget(isActive() ? svfCoeffs : svfCoeffs.withoutEffect());
+}
+
+//==============================================================================
+// MasteringEQ
+//==============================================================================
+template <typename SampleType>
+MasteringEQ<SampleType>::MasteringEQ()
+    : channels(4), sectionPlans(4)
+{
+    for (auto& ch : channels)
+    {
+        for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+            ch.parametric[i].setParameters(getDefaultBandFrequency(i), 0.0f, 1.0f);
+
+        ch.lowShelf.setParameters(ShelfBand<SampleType>::Type::Low, 100.0f, 0.0f);
+        ch.highShelf.setParameters(ShelfBand<SampleType>::Type::High, 8000.0f, 0.0f);
+
+        ch.highPass.setParameters(MultiStageFilter<SampleType>::Type::HighPass, 20.0f, 2);
         ch.highPass.setEnabled(false);
-        ch.lowPass.setParameters(MultiStageFilter::Type::LowPass, 20000.0f, 2);
+        ch.lowPass.setParameters(MultiStageFilter<SampleType>::Type::LowPass, 20000.0f, 2);
         ch.lowPass.setEnabled(false);
     }
 }
 
-void MasteringEQ::prepare(double sampleRate, int samplesPerBlock)
+template <typename SampleType>
+MasteringEQ<SampleType>::~MasteringEQ()
+{
+    kernelDesigner.stopThread(1000);
+}
+
+float MasteringEQBase::getDefaultBandFrequency(int band)
+{
+    if (NUM_PARAMETRIC_BANDS == 4)
+    {
+        // Low, Low-Mid, Mid, High-Mid
+        constexpr float standardBands[] = { 80.0f, 300.0f, 1000.0f, 4000.0f };
+        return standardBands[band];
+    }
+
+    if (NUM_PARAMETRIC_BANDS == 1)
+        return 1000.0f;
+
+    const float position = static_cast<float>(band) / static_cast<float>(NUM_PARAMETRIC_BANDS - 1);
+    return 40.0f * std::pow(300.0f, position);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::prepare(double sampleRate, int samplesPerBlock, int numChannels)
+{
+    // The designer reads the sample rate and lays out the convolvers, so it has to be stopped
+    // before either changes. startLinearPhase() starts it again.
+    kernelDesigner.stopThread(1000);
+
+    currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlock;
+    laneFrames.assign(static_cast<size_t>(std::max(samplesPerBlock, 1)), Frame::expand(0.0f));
+
+    // New channels take the settings the others already have. The mid and side views follow
+    // the bus's channels.
+    numBusChannels = std::clamp(numChannels, 1, MAX_CHANNELS);
+    numChannels = numBusChannels;
+    const auto settings = channels.front();
+    channels.resize(static_cast<size_t>(numChannels + 2), settings);
+    sectionPlans.resize(static_cast<size_t>(numChannels + 2));
+    linearPhaseConvolvers.resize(static_cast<size_t>(numChannels));
+    incomingConvolvers.resize(static_cast<size_t>(numChannels));
+    linearPhaseScratch.resize(static_cast<size_t>(std::max(samplesPerBlock, 1)));
+    incomingScratch.resize(linearPhaseScratch.size());
+
+    for (auto& ch : channels)
+    {
+        ch.highPass.prepare(sampleRate);
+        ch.lowPass.prepare(sampleRate);
+        ch.lowShelf.prepare(sampleRate);
+        ch.highShelf.prepare(sampleRate);
+        for (auto& band : ch.parametric)
+        {
+            band.prepare(sampleRate);
+            band.reset();
+        }
+        ch.lowShelf.reset();
+        ch.highShelf.reset();
+    }
+
+    for (auto& plan : sectionPlans)
+    {
+        plan.cascade.reset();
+        plan.inputHistory = {};
+    }
+    sectionPlanDirty = true;
+
+    for (auto& dynamics : bandDynamics)
+        dynamics.prepare(sampleRate);
+    levelDetector.reset();
+
+    const int maxIntervals = (std::max(samplesPerBlock, 1) + BandDynamics::CONTROL_INTERVAL - 1) / BandDynamics::CONTROL_INTERVAL;
+    detectorLevels.resize(static_cast<size_t>(maxIntervals));
+    dynamicGains.resize(static_cast<size_t>(maxIntervals));
+
+    prepareLinearPhase(false);
+    prepareAutoGain();
+    publishResponse();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::reset()
+{
+    for (auto& ch : channels)
+    {
+        ch.highPass.reset();
+        ch.lowPass.reset();
+        ch.lowShelf.reset();
+        ch.highShelf.reset();
+        for (auto& band : ch.parametric)
+            band.reset();
+    }
+
+    for (auto& plan : sectionPlans)
+    {
+        plan.cascade.reset();
+        plan.inputHistory = {};
+    }
+
+    for (auto& dynamics : bandDynamics)
+        dynamics.reset();
+    levelDetector.reset();
+
+    resetLinearPhase();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::process(juce::AudioBuffer<SampleType>& buffer)
+{
+    // Linear phase keeps its convolvers running while bypassed, on a kernel that's only the delay
+    if (bypassed && !(linearPhaseMode && linearPhaseReady)) return;
+
+    if (sectionPlanDirty)
+        updateSectionPlans();
+
+    // The dynamics tables hold one prepared block's worth of control intervals
+    const int numSamples = buffer.getNumSamples();
+    if (dynamicBandMask != 0 && numSamples > currentBlockSize)
+    {
+        for (int start = 0; start < numSamples; start += currentBlockSize)
+        {
+            juce::AudioBuffer<SampleType> part(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                               start, std::min(currentBlockSize, numSamples - start));
+            processChunk(part);
+        }
+        return;
+    }
+
+    processChunk(buffer);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::processChunk(juce::AudioBuffer<SampleType>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    if (linearPhaseMode)
+        processLinearPhase(buffer);
+    else
+        processMinimumPhase(buffer);
+
+    if (bypassed)
+        return;
+
+    // Apply output gain, with the auto gain compensation. Ramped over the block when it moves,
+    // since auto gain follows every redesign.
+    const float targetGain = outputGainLinear * autoGainLinear;
+    if (targetGain != appliedOutputGain)
+    {
+        buffer.applyGainRamp(0, numSamples, appliedOutputGain, targetGain);
+        appliedOutputGain = targetGain;
+    }
+    else if (std::abs(targetGain - 1.0f) > 0.0001f)
+    {
+        buffer.applyGain(targetGain);
+    }
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::processMinimumPhase(juce::AudioBuffer<SampleType>& buffer)
+{
+    const int numChannels = std::min(buffer.getNumChannels(), numBusChannels);
+    const int numSamples = buffer.getNumSamples();
+    SampleType* const* data = buffer.getArrayOfWritePointers();
+
+    // Detection is linked across every channel, so it sees the whole block before any of it is filtered
+    if (dynamicBandMask != 0)
+        measureDynamics(buffer.getArrayOfReadPointers(), numChannels, 1, numSamples);
+
+    constexpr int laneCount = static_cast<int>(Frame::SIMDNumElements);
+    for (int first = 0; first < numChannels; first += laneCount)
+    {
+        const int numLanes = std::min(laneCount, numChannels - first);
+        if (numLanes == 1)
+            processChannelBlock(data[first], numSamples, first);
+        else
+            processLaneGroup(data + first, first, numLanes, numSamples);
+    }
+
+    if (numChannels > 1 && hasMidSideBands())
+        processMidSide(data[0], data[1], numSamples);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::processMidSide(SampleType* left, SampleType* right, int numSamples)
+{
+    DSPUtils::sumAndDifference(left, right, numSamples, static_cast<SampleType>(0.5));
+
+    if (linearPhaseMode && linearPhaseReady)
+    {
+        processUnsharedSections(left, numSamples, numBusChannels);
+        processUnsharedSections(right, numSamples, numBusChannels + 1);
+    }
+    else
+    {
+        SampleType* const views[] = { left, right };
+        processLaneGroup(views, numBusChannels, 2, numSamples);
+    }
+
+    DSPUtils::sumAndDifference(left, right, numSamples, static_cast<SampleType>(1));
+}
+
+template <typename SampleType>
+bool MasteringEQ<SampleType>::hasMidSideBands() const
+{
+    // Placed rather than active, so SVF sections on a band that was just switched off can ramp out
+    return numBusChannels > 1 && std::any_of(placements.begin(), placements.end(), [] (Placement placement) {
+        return placement == Placement::Mid || placement == Placement::Side;
+    });
+}
+
+template <typename SampleType>
+bool MasteringEQ<SampleType>::isPlacedOn(int band, int channel) const
+{
+    const auto placement = placements[band];
+    if (channel >= numBusChannels)
+        return placement == (channel == numBusChannels ? Placement::Mid : Placement::Side) && numBusChannels > 1;
+
+    if (placement == Placement::Stereo || numBusChannels == 1)
+        return true;
+
+    return (placement == Placement::Left && channel == 0) || (placement == Placement::Right && channel == 1);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::processLinearPhase(juce::AudioBuffer<SampleType>& buffer)
+{
+    const int numChannels = std::min(buffer.getNumChannels(), numBusChannels);
+
+    // Kernels are designed on the designer thread; here we only ask and pick up. Until it has
+    // set up the convolvers and handed over a first kernel, the EQ stays minimum phase.
+    if (linearPhaseReady || linearPhaseAllocated.load(std::memory_order_acquire))
+    {
+        requestLinearPhaseKernel();
+        acceptLinearPhaseKernel(numChannels);
+    }
+
+    if (!linearPhaseReady)
+    {
+        processMinimumPhase(buffer);
+        return;
+    }
+
+    const int numSamples = buffer.getNumSamples();
+    for (int ch = 0; ch < numChannels; ++ch)
+        convolveLinearPhase(buffer.getWritePointer(ch), numSamples, ch);
+
+    if (incomingKernel >= 0)
+    {
+        switchPosition += numSamples;
+        if (switchPosition >= linearPhaseKernels[incomingKernel].getLength() + LATENCY_SWITCH_FADE)
+            finishLatencySwitch();
+    }
+
+    if (bypassed)
+        return;
+
+    // Dynamic and placed bands are left out of the kernel and follow it as minimum phase
+    // sections, dynamic ones detecting on the delayed signal they actually process
+    if (dynamicBandMask != 0)
+        measureDynamics(buffer.getArrayOfReadPointers(), numChannels, 1, numSamples);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        processUnsharedSections(buffer.getWritePointer(ch), numSamples, ch);
+
+    if (numChannels > 1 && hasMidSideBands())
+        processMidSide(buffer.getWritePointer(0), buffer.getWritePointer(1), numSamples);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::convolveLinearPhase(SampleType* data, int numSamples, int channel)
+{
+    auto& convolver = linearPhaseConvolvers[static_cast<size_t>(channel)];
+    if constexpr (std::is_same_v<SampleType, float>)
+    {
+        if (incomingKernel < 0)
+        {
+            convolver.process(data, numSamples);
+            return;
+        }
+    }
+
+    // The convolvers run in float. The kernel has no feedback, so in double that costs one
+    // rounding per output sample rather than error that builds up in a recursion.
+    auto& incoming = incomingConvolvers[static_cast<size_t>(channel)];
+    const int fadeStart = incomingKernel >= 0 ? linearPhaseKernels[incomingKernel].getLength() : 0;
+    const int maxChunk = static_cast<int>(linearPhaseScratch.size());
+    for (int start = 0; start < numSamples; start += maxChunk)
+    {
+        const int chunk = std::min(maxChunk, numSamples - start);
+        for (int i = 0; i < chunk; ++i)
+            linearPhaseScratch[i] = static_cast<float>(data[start + i]);
+
+        if (incomingKernel < 0)
+        {
+            convolver.process(linearPhaseScratch.data(), chunk);
+            for (int i = 0; i < chunk; ++i)
+                data[start + i] = linearPhaseScratch[i];
+            continue;
+        }
+
+        // Both banks run on the same input, and the output moves over once the incoming one has
+        // seen a whole kernel's worth of it
+        std::copy(linearPhaseScratch.begin(), linearPhaseScratch.begin() + chunk, incomingScratch.begin());
+        convolver.process(linearPhaseScratch.data(), chunk);
+        incoming.process(incomingScratch.data(), chunk);
+
+        for (int i = 0; i < chunk; ++i)
+        {
+            const float fade = juce::jlimit(0.0f, 1.0f, static_cast<float>(switchPosition + start + i - fadeStart) / LATENCY_SWITCH_FADE);
+            data[start + i] = linearPhaseScratch[i] + fade * (incomingScratch[i] - linearPhaseScratch[i]);
+        }
+    }
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::prepareLinearPhase(bool designFirstKernel)
+{
+    kernelDesigner.stopThread(1000);
+
+    for (auto& state : kernelStates)
+        state.store(KernelState::Free);
+    readyKernel.store(-1);
+    numRetiredKernels = 0;
+    activeKernel = -1;
+    incomingKernel = -1;
+    switchPosition = 0;
+    linearPhaseReady = false;
+
+    // Drop any request left from before, and have the first block ask again
+    linearPhaseRequests.update();
+    lastLinearPhaseRequest = {};
+
+    // Laid out again even if they already were, for the channels the bus has now
+    if (!designFirstKernel && !linearPhaseAllocated.load())
+        return;
+    allocateLinearPhase();
+    if (!designFirstKernel)
+        return;
+
+    // Nothing is running, so design the first kernel here
+    collectLinearPhaseRequest(lastLinearPhaseRequest);
+    kernelDesigner.design(lastLinearPhaseRequest, linearPhaseKernels[0]);
+    kernelMinimumPhase[0] = naturalPhase;
+
+    activeKernel = 0;
+    kernelStates[0].store(KernelState::Audio);
+    for (auto& convolver : linearPhaseConvolvers)
+        convolver.setKernel(&linearPhaseKernels[0]);
+
+    linearPhaseReady = true;
+    kernelDesigner.startThread();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::allocateLinearPhase()
+{
+    kernelDesigner.prepare();
+
+    // Convolvers are laid out for the longest kernel; shorter ones just leave the tail levels idle
+    linearPhaseLayout = PartitionedConvolver::Layout::create(1 << MAX_LINEAR_PHASE_ORDER);
+    for (auto& kernel : linearPhaseKernels)
+        kernel.prepare(linearPhaseLayout);
+    for (auto& convolver : linearPhaseConvolvers)
+        convolver.prepare(linearPhaseLayout);
+    for (auto& convolver : incomingConvolvers)
+        convolver.prepare(linearPhaseLayout);
+
+    linearPhaseAllocated.store(true, std::memory_order_release);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::startLinearPhase(bool audioStopped)
+{
+    if (audioStopped)
+        prepareLinearPhase(true);
+    else if (!kernelDesigner.isThreadRunning())
+        kernelDesigner.startThread();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::wakeKernelDesigner()
+{
+    if (kernelRequested.exchange(false, std::memory_order_acq_rel) && kernelDesigner.isThreadRunning())
+        kernelDesigner.notify();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::resetLinearPhase()
+{
+    // Still being laid out by the designer, or never used
+    if (!linearPhaseAllocated.load(std::memory_order_acquire))
+        return;
+
+    for (auto& convolver : linearPhaseConvolvers)
+        convolver.reset();
+
+    // Nothing is left in flight to fade from, so a pending switch can happen straight away
+    if (incomingKernel >= 0)
+    {
+        for (auto& convolver : incomingConvolvers)
+            convolver.reset();
+        finishLatencySwitch();
+    }
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::collectLinearPhaseRequest(LinearPhaseRequest& request) const
+{
+    // Bypassed, the kernel is a unit impulse: only the delay, so the latency holds
+    collectSharedSections(request.sections);
+    if (bypassed)
+        request.sections.numSections = 0;
+
+    request.length = linearPhaseLength;
+    request.minimumPhase = naturalPhase;
+    request.hasMatchCurve = hasMatchCurve && !bypassed;
+    request.matchCurve = matchCurve;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::requestLinearPhaseKernel()
+{
+    LinearPhaseRequest request;
+    collectLinearPhaseRequest(request);
+    if (request == lastLinearPhaseRequest)
+        return;
+
+    lastLinearPhaseRequest = request;
+    linearPhaseRequests.getWriteBuffer() = lastLinearPhaseRequest;
+    linearPhaseRequests.publish();
+    kernelRequested.store(true, std::memory_order_release);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::acceptLinearPhaseKernel(int numChannels)
+{
+    const bool switching = incomingKernel >= 0;
+
+    // Hand kernels that have rung out back to the designer
+    for (int i = 0; i < numRetiredKernels;)
+    {
+        const auto* kernel = &linearPhaseKernels[retiredKernels[i]];
+        bool inUse = false;
+        for (int ch = 0; ch < numChannels; ++ch)
+            inUse = inUse || linearPhaseConvolvers[ch].isUsingKernel(kernel)
+                          || (switching && incomingConvolvers[ch].isUsingKernel(kernel));
+
+        if (inUse)
+        {
+            ++i;
+            continue;
+        }
+
+        kernelStates[retiredKernels[i]].store(KernelState::Free, std::memory_order_release);
+        retiredKernels[i] = retiredKernels[--numRetiredKernels];
+    }
+
+    // Anything new waits while the output fades from one bank to the other
+    if (switching && switchPosition >= linearPhaseKernels[incomingKernel].getLength())
+        return;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        if (!linearPhaseConvolvers[ch].canCrossfade() || (switching && !incomingConvolvers[ch].canCrossfade()))
+            return;
+
+    const int index = readyKernel.exchange(-1, std::memory_order_acq_rel);
+    if (index < 0)
+        return;
+
+    // Designed for a kernel length or phase that has since changed
+    if (linearPhaseKernels[index].getLength() != linearPhaseLength || kernelMinimumPhase[index] != naturalPhase)
+    {
+        kernelStates[index].store(KernelState::Free, std::memory_order_release);
+        return;
+    }
+
+    kernelStates[index].store(KernelState::Audio, std::memory_order_relaxed);
+
+    // Kernels of different lengths or phases have different latencies, so can't be crossfaded
+    const auto sameLatency = [this, index] (int other)
+    {
+        return linearPhaseKernels[other].getLength() == linearPhaseKernels[index].getLength()
+            && kernelMinimumPhase[other] == kernelMinimumPhase[index];
+    };
+
+    if (switching)
+    {
+        if (sameLatency(incomingKernel))
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                incomingConvolvers[ch].crossfadeToKernel(&linearPhaseKernels[index]);
+            retireKernel(incomingKernel);
+            incomingKernel = index;
+            return;
+        }
+
+        // Changed again before the incoming kernel took over
+        retireKernel(incomingKernel);
+        incomingKernel = -1;
+    }
+
+    if (activeKernel >= 0 && !sameLatency(activeKernel))
+    {
+        beginLatencySwitch(index);
+        return;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        linearPhaseConvolvers[ch].crossfadeToKernel(&linearPhaseKernels[index]);
+
+    if (activeKernel >= 0)
+        retireKernel(activeKernel);
+    activeKernel = index;
+
+    // Or the first, fading in from silence after minimum phase
+    linearPhaseReady = true;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::retireKernel(int index)
+{
+    retiredKernels[numRetiredKernels++] = index;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::beginLatencySwitch(int index)
+{
+    for (auto& convolver : incomingConvolvers)
+    {
+        convolver.reset();
+        convolver.setKernel(&linearPhaseKernels[index]);
+    }
+
+    incomingKernel = index;
+    switchPosition = 0;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::finishLatencySwitch()
+{
+    // The outgoing bank sits idle until the next switch resets it
+    std::swap(linearPhaseConvolvers, incomingConvolvers);
+    retireKernel(activeKernel);
+    activeKernel = incomingKernel;
+    incomingKernel = -1;
+}
+
+//==============================================================================
+// MasteringEQ::KernelDesigner
+//==============================================================================
+template <typename SampleType>
+void MasteringEQ<SampleType>::KernelDesigner::prepare()
+{
+    constexpr int maxOrder = MAX_LINEAR_PHASE_ORDER + CEPSTRUM_OVERSAMPLING_ORDER;
+    for (int order = MIN_LINEAR_PHASE_ORDER; order <= maxOrder; ++order)
+    {
+        auto& fft = ffts[order - MIN_LINEAR_PHASE_ORDER];
+        if (fft == nullptr)
+            fft = std::make_unique<juce::dsp::FFT>(order);
+    }
+
+    designBuffer.resize((1 << maxOrder) * 2, 0.0f);
+    irBuffer.resize(1 << MAX_LINEAR_PHASE_ORDER, 0.0f);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::KernelDesigner::design(const LinearPhaseRequest& request, PartitionedConvolver::Kernel& kernel)
+{
+    // The cepstrum is periodic in the FFT size, so a natural phase design wraps its tail around
+    // unless the grid is a good deal longer than the kernel
+    const int fftSize = request.minimumPhase ? request.length << CEPSTRUM_OVERSAMPLING_ORDER : request.length;
+    auto& fft = *ffts[juce::roundToInt(std::log2(fftSize)) - MIN_LINEAR_PHASE_ORDER];
+    const auto& sections = request.sections;
+
+    // The match curve is read between response points on a log frequency scale, and held
+    // past either end
+    const double pointScale = (RESPONSE_POINTS - 1) / std::log(getResponseFrequency(RESPONSE_POINTS - 1) / getResponseFrequency(0));
+    const double firstPointBin = getResponseFrequency(0) * fftSize / owner.currentSampleRate;
+
+    // Sample the magnitude of the minimum phase chain with zero phase
+    for (int bin = 0; bin <= fftSize / 2; ++bin)
+    {
+        const double w = juce::MathConstants<double>::twoPi * bin / fftSize;
+        const double cosW = std::cos(w);
+        const double cos2W = std::cos(2.0 * w);
+
+        double magnitudeSquared = 1.0;
+        for (int i = 0; i < sections.numSections; ++i)
+            magnitudeSquared *= DSPUtils::calculateMagnitudeSquared(sections.coeffs[i], cosW, cos2W);
+
+        if (request.hasMatchCurve)
+        {
+            const double position = juce::jlimit(0.0, RESPONSE_POINTS - 1.0, pointScale * std::log(std::max(bin / firstPointBin, 1.0)));
+            const int point = std::min(static_cast<int>(position), RESPONSE_POINTS - 2);
+            const double db = request.matchCurve[point] + (position - point) * (request.matchCurve[point + 1] - request.matchCurve[point]);
+            magnitudeSquared *= std::pow(10.0, db / 10.0);
+        }
+
+        // Natural phase works on the log magnitude, floored at -100dB so the zero a pass filter puts
+        // at DC doesn't swamp the cepstrum
+        designBuffer[2 * bin] = request.minimumPhase ? static_cast<float>(0.5 * std::log(std::max(magnitudeSquared, 1.0e-10)))
+                                                     : static_cast<float>(std::sqrt(magnitudeSquared));
+        designBuffer[2 * bin + 1] = 0.0f;
+    }
+
+    fft.performRealOnlyInverseTransform(designBuffer.data());
+
+    if (request.minimumPhase)
+    {
+        designMinimumPhase(fft, request.length);
+        kernel.setImpulseResponse(irBuffer.data(), request.length);
+        return;
+    }
+
+    // Centre the zero phase response in the kernel and window it to a symmetric FIR
+    const int halfKernel = fftSize / 2;
+    for (int i = 0; i < fftSize; ++i)
+    {
+        const float window = 0.5f - 0.5f * std::cos(DSPUtils::TWOPI * i / fftSize);
+        irBuffer[i] = designBuffer[(i - halfKernel + fftSize) % fftSize] * window;
+    }
+
+    kernel.setImpulseResponse(irBuffer.data(), fftSize);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::KernelDesigner::designMinimumPhase(juce::dsp::FFT& fft, int kernelLength)
+{
+    const int fftSize = fft.getSize();
+
+    // designBuffer holds the real cepstrum of the magnitude. Folding it onto positive quefrency
+    // gives the cepstrum of the minimum phase response with that magnitude.
+    const int half = fftSize / 2;
+    for (int i = 1; i < half; ++i)
+        designBuffer[i] *= 2.0f;
+    std::fill(designBuffer.begin() + half + 1, designBuffer.begin() + fftSize, 0.0f);
+
+    // Back to a complex log spectrum, exponentiated bin by bin
+    fft.performRealOnlyForwardTransform(designBuffer.data(), true);
+    for (int bin = 0; bin <= half; ++bin)
+    {
+        const auto value = std::exp(std::complex<float>(designBuffer[2 * bin], designBuffer[2 * bin + 1]));
+        designBuffer[2 * bin] = value.real();
+        designBuffer[2 * bin + 1] = value.imag();
+    }
+
+    fft.performRealOnlyInverseTransform(designBuffer.data());
+
+    // The response starts at tap 0, so only its tail is windowed: the falling half of a Hann
+    // window twice the kernel length
+    for (int i = 0; i < kernelLength; ++i)
+    {
+        const float window = 0.5f + 0.5f * std::cos(DSPUtils::PI * i / kernelLength);
+        irBuffer[i] = designBuffer[i] * window;
+    }
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::KernelDesigner::run()
+{
+    // Linear phase was switched on with the audio running, so set up here rather than on the
+    // audio or message thread
+    if (!owner.linearPhaseAllocated.load(std::memory_order_acquire))
+        owner.allocateLinearPhase();
+
+    bool hasRequest = false;
+
+    while (!threadShouldExit())
+    {
+        hasRequest = owner.linearPhaseRequests.update() || hasRequest;
+
+        const int index = hasRequest ? claimFreeKernel() : -1;
+        if (index < 0)
+        {
+            // Sleep until the message thread sees a request. One that finds every kernel still in
+            // use looks again shortly, as the audio thread frees them without signalling.
+            wait(hasRequest ? 5 : -1);
+            continue;
+        }
+
+        const auto& request = owner.linearPhaseRequests.getReadBuffer();
+        design(request, owner.linearPhaseKernels[index]);
+        owner.kernelMinimumPhase[index] = request.minimumPhase;
+        hasRequest = false;
+
+        // Supersedes a kernel the audio thread hasn't picked up yet
+        const int previous = owner.readyKernel.exchange(index, std::memory_order_acq_rel);
+        if (previous >= 0)
+            owner.kernelStates[previous].store(KernelState::Free, std::memory_order_release);
+    }
+}
+
+template <typename SampleType>
+int MasteringEQ<SampleType>::KernelDesigner::claimFreeKernel()
+{
+    for (int i = 0; i < NUM_LINEAR_PHASE_KERNELS; ++i)
+    {
+        auto expected = KernelState::Free;
+        if (owner.kernelStates[i].compare_exchange_strong(expected, KernelState::Designer, std::memory_order_acquire))
+            return i;
+    }
+
+    return -1;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::collectStaticSections(ActiveSections& sections, bool includePlaced) const
+{
+    const auto& ch = channels[0];
+    sections.numSections = 0;
+
+    auto addSection = [&sections](const Coefficients& c, Placement placement)
+    {
+        sections.coeffs[sections.numSections] = c;
+        sections.placements[sections.numSections++] = placement;
+    };
+
+    // Same order as processChannelBlock
+    for (int i = 0; i < ch.highPass.getNumActiveStages(); ++i)
+        addSection(ch.highPass.getStageCoefficients(i), Placement::Stereo);
+
+    // Dynamic bands can't be baked into a fixed kernel, nor can one placed anywhere but stereo;
+    // they run after it. For auto gain, every band on a mono bus acts on all of it.
+    const auto addBand = [&] (int band, bool active, bool dynamic, const Coefficients& c)
+    {
+        if (!active || dynamic || !(includePlaced || placements[band] == Placement::Stereo))
+            return;
+        addSection(c, numBusChannels > 1 ? placements[band] : Placement::Stereo);
+    };
+
+    addBand(0, ch.lowShelf.isActive(), ch.lowShelf.isDynamic(), ch.lowShelf.getCoefficients());
+
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+        addBand(1 + i, ch.parametric[i].isActive(), ch.parametric[i].isDynamic(), ch.parametric[i].getCoefficients());
+
+    addBand(NUM_DYNAMIC_BANDS - 1, ch.highShelf.isActive(), ch.highShelf.isDynamic(), ch.highShelf.getCoefficients());
+
+    for (int i = 0; i < ch.lowPass.getNumActiveStages(); ++i)
+        addSection(ch.lowPass.getStageCoefficients(i), Placement::Stereo);
+}
+
+template <typename SampleType>
+bool MasteringEQ<SampleType>::ActiveSections::operator==(const ActiveSections& other) const
+{
+    if (numSections != other.numSections)
+        return false;
+
+    for (int i = 0; i < numSections; ++i)
+        if (coeffs[i] != other.coeffs[i] || placements[i] != other.placements[i])
+            return false;
+
+    return true;
+}
+
+template <typename SampleType>
+int MasteringEQ<SampleType>::gatherSections(int channel, SectionList& sections, juce::uint32& layoutMask)
+{
+    auto& ch = channels[channel];
+    int numSections = 0;
+    int slot = 0;
+    layoutMask = 0;
+
+    const auto add = [&] (BiquadFilter<SampleType>& filter, bool active)
+    {
+        if (active)
+        {
+            sections[numSections++] = &filter;
+            layoutMask |= 1u << slot;
+        }
+        ++slot;
+    };
+
+    // Signal flow: HPF -> Low Shelf -> Parametric bands -> High Shelf -> LPF. The mid and side
+    // views only have the bands placed on them.
+    const bool busChannel = channel < numBusChannels;
+    for (int i = 0; i < MultiStageFilter<SampleType>::MAX_SECTIONS; ++i)
+        add(ch.highPass.getStage(i), busChannel && i < ch.highPass.getNumActiveStages());
+
+    add(ch.lowShelf.getFilter(), ch.lowShelf.isActive() && isPlacedOn(0, channel));
+
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+        add(ch.parametric[i].getFilter(), ch.parametric[i].isActive() && isPlacedOn(1 + i, channel));
+
+    add(ch.highShelf.getFilter(), ch.highShelf.isActive() && isPlacedOn(NUM_DYNAMIC_BANDS - 1, channel));
+
+    for (int i = 0; i < MultiStageFilter<SampleType>::MAX_SECTIONS; ++i)
+        add(ch.lowPass.getStage(i), busChannel && i < ch.lowPass.getNumActiveStages());
+
+    return numSections;
+}
+
+template <typename SampleType>
+int MasteringEQ<SampleType>::gatherSVFSections(int channel, SVFSectionList& sections, juce::uint32& layoutMask)
+{
+    auto& ch = channels[channel];
+    int numSections = 0;
+    int slot = 0;
+    layoutMask = 0;
+
+    const auto add = [&] (SVFFilter<SampleType>& filter, bool placed)
+    {
+        if (placed && filter.isActive())
+        {
+            sections[numSections++] = &filter;
+            layoutMask |= 1u << slot;
+        }
+        ++slot;
+    };
+
+    // Same order as gatherSections. Sections stay in while they ramp out, so disabling a band
+    // fades it rather than cutting it.
+    const bool busChannel = channel < numBusChannels;
+    for (int i = 0; i < MultiStageFilter<SampleType>::MAX_SECTIONS; ++i)
+        add(ch.highPass.getSVFStage(i), busChannel);
+
+    add(ch.lowShelf.getSVF(), isPlacedOn(0, channel));
+
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+        add(ch.parametric[i].getSVF(), isPlacedOn(1 + i, channel));
+
+    add(ch.highShelf.getSVF(), isPlacedOn(NUM_DYNAMIC_BANDS - 1, channel));
+
+    for (int i = 0; i < MultiStageFilter<SampleType>::MAX_SECTIONS; ++i)
+        add(ch.lowPass.getSVFStage(i), busChannel);
+
+    return numSections;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::updateSectionPlans()
 {
-    currentSampleRate = sampleRate;
-    currentBlockSize = samplesPerBlock;
-
-    for (auto& ch : channels)
+    for (int channel = 0; channel < static_cast<int>(sectionPlans.size()); ++channel)
     {
-        ch.highPass.prepare(sampleRate);
-        ch.lowPass.prepare(sampleRate);
-        ch.lowShelf.prepare(sampleRate);
-        ch.highShelf.prepare(sampleRate);
-        for (auto& band : ch.parametric)
-            band.prepare(sampleRate);
+        auto& plan = sectionPlans[channel];
+        const auto previousMask = plan.layoutMask;
+        const auto previousCascade = plan.cascade;
+        plan.numSections = gatherSections(channel, plan.sections, plan.layoutMask);
+        plan.cascade.setNumSections(plan.numSections);
+
+        // Sections that stay in keep their state, wherever they now sit in the cascade. While a
+        // section was out, its input was the output of whatever ran before it, or the channel
+        // input if nothing did. A section coming back in starts from that history.
+        SampleType previous = plan.inputHistory[0];
+        SampleType beforePrevious = plan.inputHistory[1];
+        int section = 0;
+        for (int slot = 0; section < plan.numSections; ++slot)
+        {
+            const auto bit = 1u << slot;
+            if ((plan.layoutMask & bit) == 0)
+                continue;
+
+            plan.cascade.setCoefficients(section, plan.sections[section]->getCoefficients());
+            if ((previousMask & bit) != 0)
+                plan.cascade.copyState(section, previousCascade, juce::countNumberOfBitsSet(previousMask & (bit - 1)));
+            else
+                plan.cascade.setPassThroughState(section, previous, beforePrevious);
+
+            previous = plan.cascade.getPreviousOutput(section);
+            beforePrevious = plan.cascade.getOutputBeforePrevious(section);
+            ++section;
+        }
+
+        // Where each dynamic band's section sits, so its gain changes reach the cascade
+        auto& ch = channels[channel];
+        const auto findSection = [&plan] (const BiquadFilter<SampleType>& filter)
+        {
+            for (int i = 0; i < plan.numSections; ++i)
+                if (plan.sections[i] == &filter)
+                    return i;
+            return -1;
+        };
+
+        plan.dynamicSections[0] = findSection(ch.lowShelf.getFilter());
+        for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+            plan.dynamicSections[1 + i] = findSection(ch.parametric[i].getFilter());
+        plan.dynamicSections[NUM_DYNAMIC_BANDS - 1] = findSection(ch.highShelf.getFilter());
     }
 
-    if (linearPhaseMode)
-        prepareLinearPhase();
+    sectionPlanDirty = false;
+    updateDetectors();
+    publishResponse();
+    updateAutoGain();
 }
 
-void MasteringEQ::reset()
+template <typename SampleType>
+void MasteringEQ<SampleType>::rememberInput(int channel, const SampleType* data, int numSamples, int stride)
 {
-    for (auto& ch : channels)
+    auto& history = sectionPlans[channel].inputHistory;
+    for (int i = std::max(0, numSamples - 2); i < numSamples; ++i)
     {
-        ch.highPass.reset();
-        ch.lowPass.reset();
-        ch.lowShelf.reset();
-        ch.highShelf.reset();
-        for (auto& band : ch.parametric)
-            band.reset();
+        history[1] = history[0];
+        history[0] = data[i * stride];
     }
 }
 
-void MasteringEQ::process(juce::AudioBuffer<float>& buffer)
+template <typename SampleType>
+void MasteringEQ<SampleType>::processChannelBlock(SampleType* data, int numSamples, int channel)
 {
-    if (bypassed) return;
+    const bool useSVF = filterTopology == FilterTopology::StateVariable;
+    auto& plan = sectionPlans[channel];
+    if (!useSVF)
+        rememberInput(channel, data, numSamples, 1);
 
-    if (linearPhaseMode)
-        processLinearPhase(buffer);
-    else if (midSideMode)
-        processMidSide(buffer);
-    else
-        processMinimumPhase(buffer);
+    // With dynamic bands the block goes an interval at a time, each at its own gains
+    const int intervalLength = dynamicBandMask != 0 ? BandDynamics::CONTROL_INTERVAL : numSamples;
 
-    // Apply output gain
-    if (std::abs(outputGainLinear - 1.0f) > 0.0001f)
-        buffer.applyGain(outputGainLinear);
+    for (int start = 0, interval = 0; start < numSamples; start += intervalLength, ++interval)
+    {
+        const int length = std::min(intervalLength, numSamples - start);
+        if (dynamicBandMask != 0)
+            applyDynamicGains(channel, interval);
+
+        if (useSVF)
+        {
+            SVFSectionList sections;
+            juce::uint32 layoutMask;
+            const int numSections = gatherSVFSections(channel, sections, layoutMask);
+            SVFFilter<SampleType>::processCascade(sections.data(), numSections, data + start, length);
+        }
+        else
+        {
+            plan.cascade.process(data + start, length);
+        }
+    }
 }
 
-void MasteringEQ::processMinimumPhase(juce::AudioBuffer<float>& buffer)
+template <typename SampleType>
+void MasteringEQ<SampleType>::processLaneGroup(SampleType* const* data, int firstChannel, int numLanes, int numSamples)
 {
-    const int numChannels = buffer.getNumChannels();
-    const int numSamples = buffer.getNumSamples();
+    const bool useSVF = filterTopology == FilterTopology::StateVariable;
+    const bool useDynamics = dynamicBandMask != 0;
+    constexpr int laneCount = static_cast<int>(Frame::SIMDNumElements);
+
+    std::array<SVFSectionList, laneCount> svfSections;
+    std::array<SVFFilter<SampleType>* const*, laneCount> svfLanes;
+    std::array<BiquadCascade<SampleType>*, laneCount> cascades;
+    std::array<juce::uint32, laneCount> layouts;
+    int numSections = 0;
 
-    for (int ch = 0; ch < std::min(numChannels, 2); ++ch)
+    const auto gatherSVFLanes = [&]
     {
-        float* data = buffer.getWritePointer(ch);
-        for (int i = 0; i < numSamples; ++i)
+        for (int lane = 0; lane < numLanes; ++lane)
         {
-            data[i] = processSampleThroughEQ(data[i], ch);
+            numSections = gatherSVFSections(firstChannel + lane, svfSections[lane], layouts[lane]);
+            svfLanes[lane] = svfSections[lane].data();
         }
+    };
+
+    if (useSVF)
+    {
+        // SVF sections drop out when their ramps finish, so these are gathered every block
+        gatherSVFLanes();
     }
-}
+    else
+    {
+        bool flat = true;
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            auto& plan = sectionPlans[firstChannel + lane];
+            cascades[lane] = &plan.cascade;
+            layouts[lane] = plan.layoutMask;
+            flat = flat && plan.numSections == 0;
+        }
+        numSections = sectionPlans[firstChannel].numSections;
 
-void MasteringEQ::processMidSide(juce::AudioBuffer<float>& buffer)
-{
-    if (buffer.getNumChannels() < 2) return;
+        if (flat)
+        {
+            // A flat EQ: only keep the history a returning section starts from
+            for (int lane = 0; lane < numLanes; ++lane)
+                rememberInput(firstChannel + lane, data[lane], numSamples, 1);
+            return;
+        }
+    }
 
-    const int numSamples = buffer.getNumSamples();
-    float* left = buffer.getWritePointer(0);
-    float* right = buffer.getWritePointer(1);
+    bool sharedLayout = true;
+    for (int lane = 1; sharedLayout && lane < numLanes; ++lane)
+        sharedLayout = layouts[lane] == layouts[0];
+    for (int i = 0; useSVF && sharedLayout && i < numSections; ++i)
+        for (int lane = 1; sharedLayout && lane < numLanes; ++lane)
+            sharedLayout = svfSections[lane][i]->getRampRemaining() == svfSections[0][i]->getRampRemaining();
 
-    for (int i = 0; i < numSamples; ++i)
+    if (!sharedLayout)
+    {
+        // Chains differ, so the lanes can't share an instruction stream
+        for (int lane = 0; lane < numLanes; ++lane)
+            processChannelBlock(data[lane], numSamples, firstChannel + lane);
+        return;
+    }
+
+    // Unused lanes stay zero: their coefficients are zero too
+    constexpr int stride = laneCount;
+    auto* frames = reinterpret_cast<SampleType*>(laneFrames.data());
+    const int maxChunk = static_cast<int>(laneFrames.size());
+
+    for (int start = 0; start < numSamples; start += maxChunk)
     {
-        // Encode to M/S
-        float mid = (left[i] + right[i]) * 0.5f;
-        float side = (left[i] - right[i]) * 0.5f;
+        const int chunk = std::min(maxChunk, numSamples - start);
+
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            const SampleType* source = lane < numLanes ? data[lane] + start : nullptr;
+            for (int i = 0; i < chunk; ++i)
+                frames[i * stride + lane] = source != nullptr ? source[i] : 0.0f;
+        }
 
-        // Process mid through channel 0, side through channel 1
-        mid = processSampleThroughEQ(mid, 0);
-        side = processSampleThroughEQ(side, 1);
+        if (!useSVF)
+            for (int lane = 0; lane < numLanes; ++lane)
+                rememberInput(firstChannel + lane, frames + lane, chunk, stride);
+
+        // Every channel gets the same dynamic gains at the same time, so their sections stay in step
+        const int intervalLength = useDynamics ? BandDynamics::CONTROL_INTERVAL : chunk;
+        for (int offset = 0, interval = 0; offset < chunk; offset += intervalLength, ++interval)
+        {
+            const int length = std::min(intervalLength, chunk - offset);
+            auto* intervalFrames = laneFrames.data() + offset;
+
+            if (useDynamics)
+            {
+                for (int lane = 0; lane < numLanes; ++lane)
+                    applyDynamicGains(firstChannel + lane, interval);
+                if (useSVF)
+                    gatherSVFLanes();
+            }
+
+            if (useSVF)
+                SVFFilter<SampleType>::processCascadeLanes(svfLanes.data(), numLanes, numSections, intervalFrames, length);
+            else
+                BiquadCascade<SampleType>::processLanes(cascades.data(), numLanes, intervalFrames, length);
+        }
 
-        // Decode back to L/R
-        left[i] = mid + side;
-        right[i] = mid - side;
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            SampleType* destination = data[lane] + start;
+            for (int i = 0; i < chunk; ++i)
+                destination[i] = frames[i * stride + lane];
+        }
     }
 }
 
-void MasteringEQ::processLinearPhase(juce::AudioBuffer<float>& buffer)
+template <typename SampleType>
+void MasteringEQ<SampleType>::processUnsharedSections(SampleType* data, int numSamples, int channel)
 {
-    // Simplified linear phase implementation using overlap-add
-    // For a full implementation, you would use FFT-based convolution
-    // This is a placeholder that uses minimum phase for now
-    processMinimumPhase(buffer);
-}
+    const bool useSVF = filterTopology == FilterTopology::StateVariable;
+    auto& ch = channels[channel];
+    SectionList sections;
+    SVFSectionList svfSections;
+    int numSections = 0;
 
-void MasteringEQ::prepareLinearPhase()
-{
-    const int fftSize = fft.getSize();
-    fftBuffer.resize(fftSize * 2, 0.0f);
-    irBuffer.resize(fftSize, 0.0f);
-    overlapBuffer.resize(fftSize, 0.0f);
-    linearPhaseReady = true;
-}
+    // In the SVF topology a section stays in while it ramps out, as in gatherSVFSections()
+    const auto add = [&] (int band, auto& filter)
+    {
+        const bool dynamic = (dynamicBandMask & (1u << band)) != 0;
+        if (!isPlacedOn(band, channel) || !(dynamic || placements[band] != Placement::Stereo))
+            return;
 
-void MasteringEQ::updateLinearPhaseIR()
-{
-    // Generate impulse response from current EQ settings
-    // This would be implemented for proper linear phase processing
+        if (useSVF && filter.getSVF().isActive())
+            svfSections[numSections++] = &filter.getSVF();
+        else if (!useSVF && filter.isActive())
+            sections[numSections++] = &filter.getFilter();
+    };
+
+    const auto gather = [&]
+    {
+        numSections = 0;
+        add(0, ch.lowShelf);
+        for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+            add(1 + i, ch.parametric[i]);
+        add(NUM_DYNAMIC_BANDS - 1, ch.highShelf);
+    };
+
+    const auto process = [&] (SampleType* block, int length)
+    {
+        if (useSVF)
+            SVFFilter<SampleType>::processCascade(svfSections.data(), numSections, block, length);
+        else
+            BiquadFilter<SampleType>::processCascade(sections.data(), numSections, block, length);
+    };
+
+    gather();
+    if (numSections == 0)
+        return;
+
+    if (dynamicBandMask == 0)
+    {
+        process(data, numSamples);
+        return;
+    }
+
+    for (int start = 0, interval = 0; start < numSamples; start += BandDynamics::CONTROL_INTERVAL, ++interval)
+    {
+        applyDynamicGains(channel, interval);
+        if (useSVF)
+            gather();
+        process(data + start, std::min(BandDynamics::CONTROL_INTERVAL, numSamples - start));
+    }
 }
 
-float MasteringEQ::processSampleThroughEQ(float input, int channel)
+template <typename SampleType>
+void MasteringEQ<SampleType>::updateDetectors()
 {
-    auto& ch = channels[channel];
-
-    float output = input;
+    const auto& ch = channels[0];
+    const auto sampleRate = static_cast<SampleType>(currentSampleRate);
+    dynamicBandMask = 0;
 
-    // Signal flow: HPF -> Low Shelf -> Parametric bands -> High Shelf -> LPF
-    output = ch.highPass.processSample(output);
-    output = ch.lowShelf.processSample(output);
+    // Shelves listen to everything past their corner, the parametric bands to their own band
+    const auto setBand = [&] (int band, bool dynamic, const Coefficients& coeffs)
+    {
+        if (dynamic)
+            dynamicBandMask |= 1u << band;
+        levelDetector.setBand(band, dynamic ? coeffs : Coefficients { 0, 0, 0, 0, 0 });
+    };
 
-    for (auto& band : ch.parametric)
-        output = band.processSample(output);
+    const bool lowShelfDynamic = ch.lowShelf.isActive() && ch.lowShelf.isDynamic();
+    setBand(0, lowShelfDynamic, DSPUtils::calculateLowPass<SampleType>(sampleRate, ch.lowShelf.getFrequency(), 0.7071f));
 
-    output = ch.highShelf.processSample(output);
-    output = ch.lowPass.processSample(output);
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+    {
+        const auto& band = ch.parametric[i];
+        const bool dynamic = band.isActive() && band.isDynamic();
+        setBand(1 + i, dynamic, DSPUtils::calculateBandPass<SampleType>(sampleRate, band.getFrequency(), band.getQ()));
+    }
 
-    return output;
+    const bool highShelfDynamic = ch.highShelf.isActive() && ch.highShelf.isDynamic();
+    setBand(NUM_DYNAMIC_BANDS - 1, highShelfDynamic,
+            DSPUtils::calculateHighPass<SampleType>(sampleRate, ch.highShelf.getFrequency(), 0.7071f));
 }
 
-void MasteringEQ::encodeToMidSide(float& left, float& right)
+template <typename SampleType>
+void MasteringEQ<SampleType>::measureDynamics(const SampleType* const* data, int numChannels, int stride, int numSamples)
 {
-    float mid = (left + right) * 0.5f;
-    float side = (left - right) * 0.5f;
-    left = mid;
-    right = side;
+    constexpr int intervalLength = BandDynamics::CONTROL_INTERVAL;
+    const int numIntervals = (numSamples + intervalLength - 1) / intervalLength;
+    levelDetector.process(data, numChannels, stride, numSamples, intervalLength, detectorLevels.data());
+
+    const auto& ch = channels[0];
+    DynamicGains ranges;
+    ranges[0] = ch.lowShelf.getGain();
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+        ranges[1 + i] = ch.parametric[i].getGain();
+    ranges[NUM_DYNAMIC_BANDS - 1] = ch.highShelf.getGain();
+
+    for (int interval = 0; interval < numIntervals; ++interval)
+        for (int band = 0; band < NUM_DYNAMIC_BANDS; ++band)
+            if ((dynamicBandMask & (1u << band)) != 0)
+                dynamicGains[interval][band] = bandDynamics[band].process(
+                    Detector::getLevel(detectorLevels[interval], band), ranges[band]);
 }
 
-void MasteringEQ::decodeFromMidSide(float& mid, float& side)
+template <typename SampleType>
+void MasteringEQ<SampleType>::applyDynamicGains(int channel, int interval)
 {
-    float left = mid + side;
-    float right = mid - side;
-    mid = left;
-    side = right;
+    auto& ch = channels[channel];
+    const auto& gains = dynamicGains[interval];
+
+    if ((dynamicBandMask & 1u) != 0)
+        ch.lowShelf.setDynamicGain(gains[0]);
+    for (int i = 0; i < NUM_PARAMETRIC_BANDS; ++i)
+        if ((dynamicBandMask & (2u << i)) != 0)
+            ch.parametric[i].setDynamicGain(gains[1 + i]);
+    if ((dynamicBandMask & (1u << (NUM_DYNAMIC_BANDS - 1))) != 0)
+        ch.highShelf.setDynamicGain(gains[NUM_DYNAMIC_BANDS - 1]);
+
+    auto& plan = sectionPlans[channel];
+    for (int band = 0; band < NUM_DYNAMIC_BANDS; ++band)
+    {
+        const int section = plan.dynamicSections[band];
+        if ((dynamicBandMask & (1u << band)) != 0 && section >= 0)
+            plan.cascade.setCoefficients(section, plan.sections[section]->getCoefficients());
+    }
 }
 
 // HPF controls
-void MasteringEQ::setHighPassFrequency(float freq)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighPassFrequency(float freq)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.highPass.setParameters(MultiStageFilter::Type::HighPass, freq, 2);
+        ch.highPass.setParameters(MultiStageFilter<SampleType>::Type::HighPass, freq, ch.highPass.getOrder());
 }
 
-void MasteringEQ::setHighPassSlope(int slopeDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighPassSlope(int slopeDb)
 {
-    int order = slopeDb / 6;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.highPass.setParameters(MultiStageFilter::Type::HighPass,
-            ch.highPass.isEnabled() ? 30.0f : 20.0f, order);
+        ch.highPass.setParameters(MultiStageFilter<SampleType>::Type::HighPass, ch.highPass.getFrequency(), slopeDb / 6);
 }
 
-void MasteringEQ::setHighPassEnabled(bool enabled)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighPassEnabled(bool enabled)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
         ch.highPass.setEnabled(enabled);
 }
 
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighPass(float freq, int slopeDb)
+{
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+        ch.highPass.setParameters(MultiStageFilter<SampleType>::Type::HighPass, freq, slopeDb / 6);
+}
+
 // LPF controls
-void MasteringEQ::setLowPassFrequency(float freq)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowPassFrequency(float freq)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.lowPass.setParameters(MultiStageFilter::Type::LowPass, freq, 2);
+        ch.lowPass.setParameters(MultiStageFilter<SampleType>::Type::LowPass, freq, ch.lowPass.getOrder());
 }
 
-void MasteringEQ::setLowPassSlope(int slopeDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowPassSlope(int slopeDb)
 {
-    int order = slopeDb / 6;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.lowPass.setParameters(MultiStageFilter::Type::LowPass, 20000.0f, order);
+        ch.lowPass.setParameters(MultiStageFilter<SampleType>::Type::LowPass, ch.lowPass.getFrequency(), slopeDb / 6);
 }
 
-void MasteringEQ::setLowPassEnabled(bool enabled)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowPassEnabled(bool enabled)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
         ch.lowPass.setEnabled(enabled);
 }
 
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowPass(float freq, int slopeDb)
+{
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+        ch.lowPass.setParameters(MultiStageFilter<SampleType>::Type::LowPass, freq, slopeDb / 6);
+}
+
 // Shelf controls
-void MasteringEQ::setLowShelfFrequency(float freq)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelfFrequency(float freq)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.lowShelf.setParameters(ShelfBand::Type::Low, freq, ch.lowShelf.getGain());
+        ch.lowShelf.setParameters(ShelfBand<SampleType>::Type::Low, freq, ch.lowShelf.getGain());
 }
 
-void MasteringEQ::setLowShelfGain(float gainDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelfGain(float gainDb)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.lowShelf.setParameters(ShelfBand::Type::Low, ch.lowShelf.getFrequency(), gainDb);
+        ch.lowShelf.setParameters(ShelfBand<SampleType>::Type::Low, ch.lowShelf.getFrequency(), gainDb);
 }
 
-void MasteringEQ::setLowShelfEnabled(bool enabled)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelfEnabled(bool enabled)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
         ch.lowShelf.setEnabled(enabled);
 }
 
-void MasteringEQ::setHighShelfFrequency(float freq)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelf(float freq, float gainDb)
+{
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+        ch.lowShelf.setParameters(ShelfBand<SampleType>::Type::Low, freq, gainDb);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelfFrequency(float freq)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.highShelf.setParameters(ShelfBand::Type::High, freq, ch.highShelf.getGain());
+        ch.highShelf.setParameters(ShelfBand<SampleType>::Type::High, freq, ch.highShelf.getGain());
 }
 
-void MasteringEQ::setHighShelfGain(float gainDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelfGain(float gainDb)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
-        ch.highShelf.setParameters(ShelfBand::Type::High, ch.highShelf.getFrequency(), gainDb);
+        ch.highShelf.setParameters(ShelfBand<SampleType>::Type::High, ch.highShelf.getFrequency(), gainDb);
 }
 
-void MasteringEQ::setHighShelfEnabled(bool enabled)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelfEnabled(bool enabled)
 {
+    sectionPlanDirty = true;
     for (auto& ch : channels)
         ch.highShelf.setEnabled(enabled);
 }
 
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelf(float freq, float gainDb)
+{
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+        ch.highShelf.setParameters(ShelfBand<SampleType>::Type::High, freq, gainDb);
+}
+
 // Parametric band controls
-void MasteringEQ::setBandFrequency(int band, float freq)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandFrequency(int band, float freq)
 {
     if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
     {
         auto& b = ch.parametric[band];
@@ -407,9 +2337,11 @@ void MasteringEQ::setBandFrequency(int band, float freq)
     }
 }
 
-void MasteringEQ::setBandGain(int band, float gainDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandGain(int band, float gainDb)
 {
     if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
     {
         auto& b = ch.parametric[band];
@@ -417,9 +2349,11 @@ void MasteringEQ::setBandGain(int band, float gainDb)
     }
 }
 
-void MasteringEQ::setBandQ(int band, float q)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandQ(int band, float q)
 {
     if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
     {
         auto& b = ch.parametric[band];
@@ -427,51 +2361,480 @@ void MasteringEQ::setBandQ(int band, float q)
     }
 }
 
-void MasteringEQ::setBandEnabled(int band, bool enabled)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandEnabled(int band, bool enabled)
 {
     if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
     for (auto& ch : channels)
         ch.parametric[band].setEnabled(enabled);
 }
 
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBand(int band, float freq, float gainDb, float q)
+{
+    if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+        ch.parametric[band].setParameters(freq, gainDb, q);
+}
+
+// Dynamic band controls
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelfDynamics(bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs)
+{
+    sectionPlanDirty = true;
+    bandDynamics[0].setParameters(enabled, thresholdDb, ratio, attackMs, releaseMs);
+    for (auto& ch : channels)
+        ch.lowShelf.setDynamic(enabled);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelfDynamics(bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs)
+{
+    sectionPlanDirty = true;
+    bandDynamics[NUM_DYNAMIC_BANDS - 1].setParameters(enabled, thresholdDb, ratio, attackMs, releaseMs);
+    for (auto& ch : channels)
+        ch.highShelf.setDynamic(enabled);
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandDynamics(int band, bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs)
+{
+    if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = true;
+    bandDynamics[1 + band].setParameters(enabled, thresholdDb, ratio, attackMs, releaseMs);
+    for (auto& ch : channels)
+        ch.parametric[band].setDynamic(enabled);
+}
+
+// Placement
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLowShelfPlacement(Placement placement)
+{
+    sectionPlanDirty = sectionPlanDirty || placement != placements[0];
+    placements[0] = placement;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setHighShelfPlacement(Placement placement)
+{
+    sectionPlanDirty = sectionPlanDirty || placement != placements[NUM_DYNAMIC_BANDS - 1];
+    placements[NUM_DYNAMIC_BANDS - 1] = placement;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBandPlacement(int band, Placement placement)
+{
+    if (band < 0 || band >= NUM_PARAMETRIC_BANDS) return;
+    sectionPlanDirty = sectionPlanDirty || placement != placements[1 + band];
+    placements[1 + band] = placement;
+}
+
 // Global controls
-void MasteringEQ::setLinearPhase(bool useLinearPhase)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLinearPhase(bool useLinearPhase)
 {
+    if (useLinearPhase == linearPhaseMode)
+        return;
+
     linearPhaseMode = useLinearPhase;
-    if (linearPhaseMode && !linearPhaseReady)
-        prepareLinearPhase();
+    resetLinearPhase();
+
+    // The match curve only applies to the linear phase path
+    if (hasMatchCurve)
+    {
+        sectionPlanDirty = true;
+        autoGainSections.numSections = -1;
+    }
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setLinearPhaseLength(int numTaps)
+{
+    const int order = std::clamp(juce::roundToInt(std::log2(std::max(numTaps, 1))),
+                                 MIN_LINEAR_PHASE_ORDER, MAX_LINEAR_PHASE_ORDER);
+    if ((1 << order) == linearPhaseLength)
+        return;
+
+    linearPhaseLength = 1 << order;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setNaturalPhase(bool useNaturalPhase)
+{
+    if (useNaturalPhase == naturalPhase)
+        return;
+
+    naturalPhase = useNaturalPhase;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setFilterTopology(FilterTopology newTopology)
+{
+    if (newTopology == filterTopology)
+        return;
+
+    // The two structures don't share state, so both start from silence
+    filterTopology = newTopology;
+    sectionPlanDirty = true;
+    for (auto& ch : channels)
+    {
+        for (int i = 0; i < MultiStageFilter<SampleType>::MAX_SECTIONS; ++i)
+        {
+            ch.highPass.getSVFStage(i).snapToTarget();
+            ch.lowPass.getSVFStage(i).snapToTarget();
+        }
+        ch.lowShelf.getSVF().snapToTarget();
+        ch.highShelf.getSVF().snapToTarget();
+        for (auto& band : ch.parametric)
+            band.getSVF().snapToTarget();
+
+        ch.highPass.reset();
+        ch.lowPass.reset();
+        ch.lowShelf.reset();
+        ch.highShelf.reset();
+        for (auto& band : ch.parametric)
+            band.reset();
+    }
+
+    for (auto& plan : sectionPlans)
+        plan.cascade.reset();
 }
 
-void MasteringEQ::setMidSideMode(bool useMidSide)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setCoefficientDesign(CoefficientDesign newDesign)
 {
-    midSideMode = useMidSide;
+    if (newDesign == coefficientDesign)
+        return;
+
+    // A redesign like any other, the filters keep their state
+    coefficientDesign = newDesign;
+    sectionPlanDirty = true;
+    const bool matched = newDesign == CoefficientDesign::Matched;
+    for (auto& ch : channels)
+    {
+        ch.lowShelf.setMatchedDesign(matched);
+        ch.highShelf.setMatchedDesign(matched);
+        for (auto& band : ch.parametric)
+            band.setMatchedDesign(matched);
+    }
 }
 
-void MasteringEQ::setBypass(bool shouldBypass)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setBypass(bool shouldBypass)
 {
     bypassed = shouldBypass;
 }
 
-void MasteringEQ::setOutputGain(float gainDb)
+template <typename SampleType>
+void MasteringEQ<SampleType>::setOutputGain(float gainDb)
 {
     outputGainLinear = DSPUtils::decibelsToLinear(gainDb);
 }
 
-std::array<float, 512> MasteringEQ::getMagnitudeResponse(float sampleRate) const
+template <typename SampleType>
+void MasteringEQ<SampleType>::setAutoGain(bool shouldAutoGain)
+{
+    if (shouldAutoGain == autoGain)
+        return;
+
+    autoGain = shouldAutoGain;
+    autoGainSections.numSections = -1;
+    updateAutoGain();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::setMatchCurve(const MatchCurve& curveDb)
+{
+    if (curveDb == matchCurve)
+        return;
+
+    matchCurve = curveDb;
+    hasMatchCurve = std::any_of(matchCurve.begin(), matchCurve.end(), [] (float db) { return db != 0.0f; });
+    sectionPlanDirty = true;
+    autoGainSections.numSections = -1;
+}
+
+template <typename SampleType>
+int MasteringEQ<SampleType>::getLatencySamples() const
+{
+    if (!(linearPhaseMode && linearPhaseReady))
+        return 0;
+
+    // Moves to the incoming kernel's as the output starts fading over to it
+    const bool switched = incomingKernel >= 0 && switchPosition >= linearPhaseKernels[incomingKernel].getLength();
+    const int index = switched ? incomingKernel : activeKernel;
+    return kernelMinimumPhase[index] ? 0 : linearPhaseKernels[index].getLength() / 2;
+}
+
+//==============================================================================
+// Auto gain
+//==============================================================================
+template <typename SampleType>
+void MasteringEQ<SampleType>::prepareAutoGain()
+{
+    const auto kShelf = DSPUtils::calculateKWeightingShelf(currentSampleRate);
+    const auto kHighPass = DSPUtils::calculateKWeightingHighPass(currentSampleRate);
+
+    double totalWeight = 0.0;
+    std::array<double, AUTO_GAIN_POINTS> weights;
+    for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+    {
+        const double halfW = std::min(juce::MathConstants<double>::pi * getResponseFrequency(2 * i) / currentSampleRate,
+                                      juce::MathConstants<double>::halfPi);
+        const double s = std::sin(halfW);
+        autoGainPhi[i] = static_cast<float>(s * s);
+
+        const double cosW = std::cos(2.0 * halfW);
+        const double cos2W = std::cos(4.0 * halfW);
+        weights[i] = DSPUtils::calculateMagnitudeSquared(kShelf, cosW, cos2W)
+                   * DSPUtils::calculateMagnitudeSquared(kHighPass, cosW, cos2W);
+        totalWeight += weights[i];
+    }
+
+    for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+        autoGainWeights[i] = static_cast<float>(weights[i] / totalWeight);
+
+    autoGainSections.numSections = -1;
+    updateAutoGain();
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::updateAutoGain()
+{
+    if (!autoGain)
+    {
+        autoGainLinear = 1.0f;
+        return;
+    }
+
+    // Plans are also rebuilt for changes that leave the static curve alone, like a topology switch
+    ActiveSections sections;
+    collectStaticSections(sections, true);
+    if (sections == autoGainSections)
+        return;
+
+    autoGainSections = sections;
+
+    // The same evaluation as the editor's response, at half the points. Each placement's bands
+    // are multiplied up on their own, then only their share of the bus is taken: a mid band
+    // acts on most of a master's power, one channel on half of it, side on much less.
+    static constexpr std::array<float, NUM_PLACEMENTS> placementShares { 1.0f, 0.5f, 0.5f, 1.0f, 0.25f };
+    std::array<bool, NUM_PLACEMENTS> placementUsed {};
+
+    for (auto& power : autoGainPowers)
+        power.fill(1.0f);
+
+    for (int s = 0; s < sections.numSections; ++s)
+    {
+        const int placement = static_cast<int>(sections.placements[s]);
+        placementUsed[placement] = true;
+
+        auto& power = autoGainPowers[placement];
+        const auto p = DSPUtils::calculateMagnitudePolynomial(sections.coeffs[s]);
+        for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+        {
+            const float phi = autoGainPhi[i];
+            power[i] *= (p.n0 + phi * (p.n1 + phi * p.n2)) / (p.d0 + phi * (p.d1 + phi * p.d2));
+        }
+    }
+
+    auto& autoGainPower = autoGainPowers[static_cast<int>(Placement::Stereo)];
+    for (int placement = 1; placement < NUM_PLACEMENTS; ++placement)
+    {
+        if (!placementUsed[placement])
+            continue;
+
+        const float share = placementShares[placement];
+        const auto& placedPower = autoGainPowers[placement];
+        for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+            autoGainPower[i] *= std::max(1.0f + share * (placedPower[i] - 1.0f), 1.0e-6f);
+    }
+
+    if (linearPhaseMode && hasMatchCurve)
+        for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+            autoGainPower[i] *= std::pow(10.0f, matchCurve[2 * i] / 10.0f);
+
+    float loudnessGain = 0.0f;
+    for (int i = 0; i < AUTO_GAIN_POINTS; ++i)
+        loudnessGain += autoGainWeights[i] * autoGainPower[i];
+
+    // Held to a sane range, so pass filters closed right down can't become a big boost
+    constexpr float maxCompensationDb = 18.0f;
+    const float compensationDb = -10.0f * std::log10(std::max(loudnessGain, 1.0e-12f));
+    autoGainLinear = DSPUtils::decibelsToLinear(std::clamp(compensationDb, -maxCompensationDb, maxCompensationDb));
+}
+
+//==============================================================================
+// Magnitude response
+//==============================================================================
+float MasteringEQBase::getResponseFrequency(int point)
+{
+    // Logarithmic frequency scale from 20Hz to 20kHz
+    return 20.0f * std::pow(1000.0f, static_cast<float>(point) / static_cast<float>(RESPONSE_POINTS - 1));
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::publishResponse()
+{
+    auto& snapshot = responseSnapshots.getWriteBuffer();
+    const auto& ch = channels[0];
+    int group = 0;
+
+    const auto addPassFilter = [&] (const MultiStageFilter<SampleType>& filter)
+    {
+        snapshot.numSections[group] = filter.getNumActiveStages();
+        for (int i = 0; i < snapshot.numSections[group]; ++i)
+            snapshot.coeffs[group][i] = filter.getStageCoefficients(i);
+        ++group;
+    };
+
+    const auto addBand = [&] (bool active, const Coefficients& coeffs)
+    {
+        // Group 1 is the first dynamic band
+        snapshot.numSections[group] = active ? 1 : 0;
+        snapshot.coeffs[group][0] = coeffs;
+        snapshot.placements[group] = numBusChannels > 1 ? placements[group - 1] : Placement::Stereo;
+        ++group;
+    };
+
+    snapshot.placements.fill(Placement::Stereo);
+    addPassFilter(ch.highPass);
+    addBand(ch.lowShelf.isActive(), ch.lowShelf.getCoefficients());
+    for (const auto& band : ch.parametric)
+        addBand(band.isActive(), band.getCoefficients());
+    addBand(ch.highShelf.isActive(), ch.highShelf.getCoefficients());
+    addPassFilter(ch.lowPass);
+
+    snapshot.sampleRate = currentSampleRate;
+    snapshot.hasMatchCurve = linearPhaseMode && hasMatchCurve;
+    if (snapshot.hasMatchCurve)
+        snapshot.matchCurve = matchCurve;
+
+    responseSnapshots.publish();
+}
+
+template <typename SampleType>
+bool MasteringEQ<SampleType>::ResponseSnapshot::groupEquals(const ResponseSnapshot& other, int group) const
+{
+    if (numSections[group] != other.numSections[group])
+        return false;
+
+    for (int i = 0; i < numSections[group]; ++i)
+        if (coeffs[group][i] != other.coeffs[group][i])
+            return false;
+
+    return true;
+}
+
+template <typename SampleType>
+const MasteringEQBase::MagnitudeResponse& MasteringEQ<SampleType>::getMagnitudeResponse()
+{
+    if (!responseSnapshots.update())
+        return magnitudeResponse;
+
+    const auto& snapshot = responseSnapshots.getReadBuffer();
+    const bool rateChanged = snapshot.sampleRate != evaluatedSnapshot.sampleRate;
+
+    // The only trig, and only when the sample rate changes
+    if (rateChanged)
+    {
+        for (int i = 0; i < RESPONSE_POINTS; ++i)
+        {
+            const double halfW = juce::MathConstants<double>::pi * getResponseFrequency(i) / snapshot.sampleRate;
+            const double s = std::sin(std::min(halfW, juce::MathConstants<double>::halfPi));
+            responsePhi[i] = static_cast<float>(s * s);
+        }
+    }
+
+    bool changed = false;
+    for (int group = 0; group < NUM_RESPONSE_GROUPS; ++group)
+    {
+        if (rateChanged || !snapshot.groupEquals(evaluatedSnapshot, group))
+        {
+            evaluateResponseGroup(group, snapshot);
+            changed = true;
+        }
+    }
+
+    changed = changed || snapshot.placements != evaluatedSnapshot.placements
+                      || snapshot.hasMatchCurve != evaluatedSnapshot.hasMatchCurve
+                      || (snapshot.hasMatchCurve && snapshot.matchCurve != evaluatedSnapshot.matchCurve);
+
+    if (changed)
+    {
+        auto& stereo = magnitudeResponse.curves[static_cast<int>(Placement::Stereo)];
+        stereo.fill(0.0f);
+        for (int group = 0; group < NUM_RESPONSE_GROUPS; ++group)
+            if (snapshot.placements[group] == Placement::Stereo)
+                juce::FloatVectorOperations::add(stereo.data(), groupResponses[group].data(), RESPONSE_POINTS);
+        if (snapshot.hasMatchCurve)
+            juce::FloatVectorOperations::add(stereo.data(), snapshot.matchCurve.data(), RESPONSE_POINTS);
+
+        // The placed curves start from the stereo one
+        for (int placement = 1; placement < NUM_PLACEMENTS; ++placement)
+        {
+            auto& curve = magnitudeResponse.curves[placement];
+            curve = stereo;
+            magnitudeResponse.inUse[placement] = false;
+
+            for (int group = 0; group < NUM_RESPONSE_GROUPS; ++group)
+            {
+                if (static_cast<int>(snapshot.placements[group]) != placement || snapshot.numSections[group] == 0)
+                    continue;
+
+                juce::FloatVectorOperations::add(curve.data(), groupResponses[group].data(), RESPONSE_POINTS);
+                magnitudeResponse.inUse[placement] = true;
+            }
+        }
+    }
+
+    evaluatedSnapshot = snapshot;
+    return magnitudeResponse;
+}
+
+template <typename SampleType>
+void MasteringEQ<SampleType>::evaluateResponseGroup(int group, const ResponseSnapshot& snapshot)
 {
-    std::array<float, 512> response;
-    response.fill(0.0f);
+    auto& curve = groupResponses[group];
+    const int numSections = snapshot.numSections[group];
 
-    // Calculate magnitude response at 512 frequency points
-    for (int i = 0; i < 512; ++i)
+    if (numSections == 0)
     {
-        // Logarithmic frequency scale from 20Hz to 20kHz
-        float freq = 20.0f * std::pow(1000.0f, static_cast<float>(i) / 511.0f);
+        curve.fill(0.0f);
+        return;
+    }
 
-        // This is a simplified response - proper implementation would
-        // calculate actual filter response at each frequency
-        response[i] = 0.0f; // dB
+    // Straight-line loops over the points with no dependency between them, so they vectorise
+    responsePower.fill(1.0f);
+    for (int s = 0; s < numSections; ++s)
+    {
+        const auto p = DSPUtils::calculateMagnitudePolynomial(snapshot.coeffs[group][s]);
+        for (int i = 0; i < RESPONSE_POINTS; ++i)
+        {
+            const float phi = responsePhi[i];
+            responsePower[i] *= (p.n0 + phi * (p.n1 + phi * p.n2)) / (p.d0 + phi * (p.d1 + phi * p.d2));
+        }
     }
 
-    return response;
+    for (int i = 0; i < RESPONSE_POINTS; ++i)
+        curve[i] = 10.0f * std::log10(std::max(responsePower[i], 1.0e-12f));
 }
+
+template class BiquadFilter<float>;
+template class BiquadFilter<double>;
+template class SVFFilter<float>;
+template class SVFFilter<double>;
+template class MultiStageFilter<float>;
+template class MultiStageFilter<double>;
+template class BiquadCascade<float>;
+template class BiquadCascade<double>;
+template class BandLevelDetector<float>;
+template class BandLevelDetector<double>;
+template class ParametricBand<float>;
+template class ParametricBand<double>;
+template class ShelfBand<float>;
+template class ShelfBand<double>;
+template class MasteringEQ<float>;
+template class MasteringEQ<double>;
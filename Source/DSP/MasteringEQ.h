@@ -2,37 +2,118 @@
 
 #include <JuceHeader.h>
 #include "DSPUtils.h"
+#include "PartitionedConvolver.h"
 #include <array>
+#include <atomic>
+#include <vector>
+
+// Number of parametric bands, 1 to 16. Define it in the project's preprocessor definitions to
+// build a different band count; parameters and editor controls follow it.
+#ifndef MASTERBUS_NUM_PARAMETRIC_BANDS
+ #define MASTERBUS_NUM_PARAMETRIC_BANDS 4
+#endif
+
+// The filters and processors below are templates on the sample type, instantiated for float
+// and double in MasteringEQ.cpp. Coefficients and filter state are held at that precision;
+// frequencies, gains and other parameters stay float.
 
 // Single biquad filter section
+template <typename SampleType>
 class BiquadFilter
 {
 public:
-    void setCoefficients(const DSPUtils::BiquadCoeffs& coeffs);
+    using Coefficients = DSPUtils::BiquadCoefficients<SampleType>;
+
+    void setCoefficients(const Coefficients& coeffs);
+    void reset();
+    const Coefficients& getCoefficients() const { return coeffs; }
+
+    // Runs a cascade over a block. Up to four sections share each pass so their
+    // recursions overlap instead of each one waiting on the previous sample.
+    static void processCascade(BiquadFilter* const* sections, int numSections, SampleType* data, int numSamples);
+
+    // One sample of several channels, a channel per SIMD lane
+    using Frame = juce::dsp::SIMDRegister<SampleType>;
+
+private:
+    template <int NumSections>
+    static void processSections(BiquadFilter* const* sections, SampleType* data, int numSamples);
+
+    Coefficients coeffs;
+    SampleType x1 = 0, x2 = 0;
+    SampleType y1 = 0, y2 = 0;
+};
+
+// Trapezoidal (TPT) state variable filter section. Unlike the direct form biquad it stays
+// stable when its coefficients move every sample, so a new target is reached through a
+// linear ramp instead of a jump at the block boundary.
+template <typename SampleType>
+class SVFFilter
+{
+public:
+    static constexpr double RAMP_SECONDS = 0.02;
+    using Coefficients = DSPUtils::SVFCoefficients<SampleType>;
+
+    void prepare(double sampleRate);
+    void setTarget(const Coefficients& newTarget);
+    void setTarget(const Coefficients& newTarget, int numRampSamples);
+    void snapToTarget();
     void reset();
-    float processSample(float input);
+    void process(SampleType* data, int numSamples);
+
+    // In the signal path while it shapes the sound or is still ramping to or from doing so
+    bool isActive() const { return !(current.isIdentity() && target.isIdentity()); }
+    int getRampRemaining() const { return rampRemaining; }
+
+    static void processCascade(SVFFilter* const* sections, int numSections, SampleType* data, int numSamples);
+
+    // One cascade per SIMD lane, lanes[lane] listing its sections. Sections in the same
+    // position must be ramping in step.
+    using Frame = typename BiquadFilter<SampleType>::Frame;
+    static void processCascadeLanes(SVFFilter* const* const* lanes, int numLanes, int numSections,
+                                    Frame* frames, int numSamples);
 
 private:
-    DSPUtils::BiquadCoeffs coeffs;
-    float x1 = 0.0f, x2 = 0.0f;
-    float y1 = 0.0f, y2 = 0.0f;
+    void updateGains();
+    static void processRampLanes(SVFFilter* const* filters, int numLanes, Frame* frames, int numSamples);
+    template <int NumSections>
+    static void processSectionsLanes(SVFFilter* const* const* lanes, int numLanes, int first,
+                                     Frame* frames, int numSamples);
+
+    Coefficients current, target, step;
+    SampleType a1 = 1, a2 = 0, a3 = 0;   // Gains derived from current.g and current.k
+    SampleType ic1eq = 0, ic2eq = 0;
+    int rampLength = 0;
+    int rampRemaining = 0;
 };
 
-// Multi-stage filter for higher order filters (6/12/18/24 dB)
+// Butterworth high/low pass for 6/12/18/24 dB slopes. Odd orders start with a first order
+// section, followed by up to two second order ones.
+template <typename SampleType>
 class MultiStageFilter
 {
 public:
     enum class Type { HighPass, LowPass };
+    static constexpr int MAX_SECTIONS = 2;
 
     void prepare(double sampleRate);
     void setParameters(Type type, float freq, int order);
     void reset();
-    float processSample(float input);
     bool isEnabled() const { return enabled; }
-    void setEnabled(bool shouldEnable) { enabled = shouldEnable; }
+    void setEnabled(bool shouldEnable);
+
+    float getFrequency() const { return frequency; }
+    int getOrder() const { return filterOrder; }
+
+    // Number of biquad stages currently in the signal path (0 when disabled)
+    int getNumActiveStages() const { return enabled ? (filterOrder + 1) / 2 : 0; }
+    const DSPUtils::BiquadCoefficients<SampleType>& getStageCoefficients(int stage) const { return stages[stage].getCoefficients(); }
+    BiquadFilter<SampleType>& getStage(int stage) { return stages[stage]; }
+    SVFFilter<SampleType>& getSVFStage(int stage) { return svfStages[stage]; }
 
 private:
     void updateCoefficients();
+    void updateSVFTargets();
 
     double currentSampleRate = 44100.0;
     Type filterType = Type::HighPass;
@@ -40,37 +121,173 @@ private:
     int filterOrder = 2; // 1=6dB, 2=12dB, 3=18dB, 4=24dB
     bool enabled = false;
 
-    std::array<BiquadFilter, 4> stages;
+    std::array<BiquadFilter<SampleType>, MAX_SECTIONS> stages;
+    std::array<SVFFilter<SampleType>, MAX_SECTIONS> svfStages;
+    std::array<DSPUtils::SVFCoefficients<SampleType>, MAX_SECTIONS> svfCoeffs;
+};
+
+// A whole chain of biquads stored as structure of arrays: one array per coefficient and state
+// term, indexed by position in the chain. A pass reads its sections from consecutive memory
+// instead of following a pointer per filter, so the cost depends only on how many run.
+template <typename SampleType>
+class BiquadCascade
+{
+public:
+    static constexpr int MAX_SECTIONS = MultiStageFilter<SampleType>::MAX_SECTIONS * 2 + MASTERBUS_NUM_PARAMETRIC_BANDS + 2;
+
+    int getNumSections() const { return numSections; }
+    void setNumSections(int newNumSections) { numSections = newNumSections; }
+    void setCoefficients(int section, const DSPUtils::BiquadCoefficients<SampleType>& coeffs);
+    void reset();
+
+    // Carries a section's state over from another layout of the chain
+    void copyState(int section, const BiquadCascade& source, int sourceSection);
+
+    // The state a pass-through would be in after the given two inputs, so a section that was
+    // skipped while flat picks up where the signal is
+    void setPassThroughState(int section, SampleType previous, SampleType beforePrevious);
+    SampleType getPreviousOutput(int section) const { return y1[section]; }
+    SampleType getOutputBeforePrevious(int section) const { return y2[section]; }
+
+    // Up to four sections per pass, as for BiquadFilter::processCascade
+    void process(SampleType* data, int numSamples);
+
+    // Cascades with the same structure, one per SIMD lane
+    using Frame = typename BiquadFilter<SampleType>::Frame;
+    static void processLanes(BiquadCascade* const* cascades, int numLanes, Frame* frames, int numSamples);
+
+private:
+    template <int NumSections>
+    void processSections(int first, SampleType* data, int numSamples);
+    template <int NumSections>
+    static void processSectionsLanes(BiquadCascade* const* cascades, int numLanes, int first,
+                                     Frame* frames, int numSamples);
+
+    std::array<SampleType, MAX_SECTIONS> b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    std::array<SampleType, MAX_SECTIONS> x1 {}, x2 {}, y1 {}, y2 {};
+    int numSections = 0;
+};
+
+// Level-dependent gain for a dynamic EQ band, worked out once per control interval. The band's
+// gain becomes a range: it stays flat below the threshold and moves towards the range by what a
+// compressor with the same settings would reduce by.
+class BandDynamics
+{
+public:
+    static constexpr int CONTROL_INTERVAL = 16;   // Samples between gain updates
+
+    void prepare(double sampleRate);
+    void setParameters(bool shouldBeEnabled, float thresholdDb, float ratio, float attackMs, float releaseMs);
+    void reset() { envelope = 0.0f; }
+
+    // Gain in dB for the next interval, from the detector's peak over the last one
+    float process(float peak, float rangeDb);
+
+private:
+    void updateCoefficients();
+
+    double controlRate = 44100.0 / CONTROL_INTERVAL;
+    bool enabled = false;
+    float threshold = -20.0f;
+    float ratio = 2.0f;
+    float attackMs = 5.0f;
+    float releaseMs = 100.0f;
+
+    float attackCoeff = 1.0f;
+    float releaseCoeff = 1.0f;
+    float thresholdLinear = 0.1f;
+    float envelope = 0.0f;
+};
+
+// Band limited level detectors for the dynamic bands, linked across all channels. Every band's
+// detector filter has its own SIMD lane, so one pass over the block measures all of them, and
+// channels run two to a loop so their recursions overlap.
+template <typename SampleType>
+class BandLevelDetector
+{
+public:
+    using Register = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int NUM_BANDS = MASTERBUS_NUM_PARAMETRIC_BANDS + 2;
+    static constexpr int MAX_CHANNELS = 16;
+    static constexpr int NUM_REGISTERS = static_cast<int>((NUM_BANDS + Register::SIMDNumElements - 1) / Register::SIMDNumElements);
+
+    // Peak detector output of each band over one interval
+    using Levels = std::array<Register, NUM_REGISTERS>;
+
+    void setBand(int band, const DSPUtils::BiquadCoefficients<SampleType>& coeffs);
+    void reset();
+
+    // Writes the peak over each intervalLength samples to levels[interval], taking the louder
+    // channel. Reads every stride-th sample.
+    void process(const SampleType* const* data, int numChannels, int stride, int numSamples, int intervalLength, Levels* levels);
+
+    static float getLevel(const Levels& levels, int band);
+
+private:
+    // Channels after the first pair fold their peaks into the levels already written
+    template <int NumChannels>
+    void processChannels(const SampleType* const* data, int firstChannel, int stride, int numSamples,
+                         int intervalLength, Levels* levels, bool combine);
+
+    Levels b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    std::array<Levels, MAX_CHANNELS> y1 {}, y2 {};
+    std::array<SampleType, MAX_CHANNELS> x1 {}, x2 {};
 };
 
 // Parametric EQ band
+template <typename SampleType>
 class ParametricBand
 {
 public:
     void prepare(double sampleRate);
     void setParameters(float freq, float gain, float q);
     void reset();
-    float processSample(float input);
     bool isEnabled() const { return enabled; }
-    void setEnabled(bool shouldEnable) { enabled = shouldEnable; }
+    void setEnabled(bool shouldEnable);
 
     float getFrequency() const { return frequency; }
     float getGain() const { return gainDb; }
     float getQ() const { return qFactor; }
 
+    bool isActive() const { return enabled && std::abs(gainDb) >= 0.01f; }
+    BiquadFilter<SampleType>& getFilter() { return filter; }
+    SVFFilter<SampleType>& getSVF() { return svf; }
+
+    // The band's design at its full gain. A dynamic band's filters can be anywhere between
+    // this and flat.
+    const DSPUtils::BiquadCoefficients<SampleType>& getCoefficients() const { return coeffs; }
+
+    // A dynamic band starts flat and runs at whatever gain it's given each control interval
+    void setDynamic(bool shouldBeDynamic);
+    bool isDynamic() const { return dynamic; }
+    void setDynamicGain(float newGainDb);
+
+    // Matched magnitude rather than bilinear designs, for both topologies
+    void setMatchedDesign(bool shouldMatch);
+
 private:
     void updateCoefficients();
+    void updateFilters(float appliedGainDb, int numRampSamples);
+    void updateSVFTarget();
+    DSPUtils::BiquadCoefficients<SampleType> design(float bandGainDb) const;
 
     double currentSampleRate = 44100.0;
     float frequency = 1000.0f;
     float gainDb = 0.0f;
     float qFactor = 1.0f;
     bool enabled = true;
-
-    BiquadFilter filter;
+    bool dynamic = false;
+    float dynamicGainDb = 0.0f;
+    bool matchedDesign = false;
+
+    DSPUtils::BiquadCoefficients<SampleType> coeffs;
+    BiquadFilter<SampleType> filter;
+    SVFFilter<SampleType> svf;
+    DSPUtils::SVFCoefficients<SampleType> svfCoeffs;
 };
 
 // Shelf EQ band
+template <typename SampleType>
 class ShelfBand
 {
 public:
@@ -79,109 +296,435 @@ public:
     void prepare(double sampleRate);
     void setParameters(Type type, float freq, float gain);
     void reset();
-    float processSample(float input);
     bool isEnabled() const { return enabled; }
-    void setEnabled(bool shouldEnable) { enabled = shouldEnable; }
+    void setEnabled(bool shouldEnable);
 
     float getFrequency() const { return frequency; }
     float getGain() const { return gainDb; }
 
+    bool isActive() const { return enabled && std::abs(gainDb) >= 0.01f; }
+    BiquadFilter<SampleType>& getFilter() { return filter; }
+    SVFFilter<SampleType>& getSVF() { return svf; }
+
+    // Full gain design and dynamic gain as for ParametricBand
+    const DSPUtils::BiquadCoefficients<SampleType>& getCoefficients() const { return coeffs; }
+    void setDynamic(bool shouldBeDynamic);
+    bool isDynamic() const { return dynamic; }
+    void setDynamicGain(float newGainDb);
+    void setMatchedDesign(bool shouldMatch);
+
 private:
     void updateCoefficients();
+    void updateFilters(float appliedGainDb, int numRampSamples);
+    void updateSVFTarget();
+    DSPUtils::BiquadCoefficients<SampleType> design(float bandGainDb) const;
 
     double currentSampleRate = 44100.0;
     Type shelfType = Type::Low;
     float frequency = 100.0f;
     float gainDb = 0.0f;
     bool enabled = true;
+    bool dynamic = false;
+    float dynamicGainDb = 0.0f;
+    bool matchedDesign = false;
+
+    DSPUtils::BiquadCoefficients<SampleType> coeffs;
+    BiquadFilter<SampleType> filter;
+    SVFFilter<SampleType> svf;
+    DSPUtils::SVFCoefficients<SampleType> svfCoeffs;
+};
+
+// The parts of the mastering EQ that don't depend on the sample type
+class MasteringEQBase
+{
+public:
+    static constexpr int NUM_PARAMETRIC_BANDS = MASTERBUS_NUM_PARAMETRIC_BANDS;
+    static constexpr int MAX_CHANNELS = 16;   // Up to 9.1.6
+    static_assert(NUM_PARAMETRIC_BANDS >= 1 && NUM_PARAMETRIC_BANDS <= 16, "1 to 16 parametric bands");
+
+    // Where each band starts out: 80Hz, 300Hz, 1kHz and 4kHz for the standard four, otherwise
+    // spread evenly on a log scale from 40Hz to 12kHz
+    static float getDefaultBandFrequency(int band);
+
+    // Filter structure for the minimum phase path. The biquads are cheapest; the state
+    // variable sections ramp their coefficients per sample so automation doesn't zipper.
+    enum class FilterTopology { Biquad, StateVariable };
+
+    // How the bells and shelves are designed. Bilinear is the cookbook design, cramped towards
+    // Nyquist; Matched follows the analog magnitude all the way up without oversampling.
+    enum class CoefficientDesign { Bilinear, Matched };
+
+    // What a shelf or parametric band works on. Stereo runs it on every channel. Left and right
+    // run it on one channel of the front pair; mid and side on one half of its mid/side matrix,
+    // after the left and right bands. On a mono bus every band is stereo.
+    enum class Placement { Stereo, Left, Right, Mid, Side };
+    static constexpr int NUM_PLACEMENTS = 5;
+
+    // For UI spectrum display: RESPONSE_POINTS log-spaced frequencies from 20Hz to 20kHz
+    static constexpr int RESPONSE_POINTS = 512;
+    static float getResponseFrequency(int point);
+
+    // The response in dB at the response frequencies, indexed by Placement. The stereo curve is
+    // what every channel gets. Each of the others is the stereo curve with the bands placed there
+    // added, which is what that channel or half of the mid/side matrix gets; it's only in use
+    // while an active band is placed there.
+    struct MagnitudeResponse
+    {
+        std::array<std::array<float, RESPONSE_POINTS>, NUM_PLACEMENTS> curves {};
+        std::array<bool, NUM_PLACEMENTS> inUse { true, false, false, false, false };
+    };
 
-    BiquadFilter filter;
+    // A correction in dB at the response frequencies, such as a spectral match
+    using MatchCurve = std::array<float, RESPONSE_POINTS>;
 };
 
 // Complete mastering EQ processor
-class MasteringEQ
+template <typename SampleType>
+class MasteringEQ : public MasteringEQBase
 {
 public:
-    static constexpr int NUM_PARAMETRIC_BANDS = 4;
-
     MasteringEQ();
+    ~MasteringEQ();
 
-    void prepare(double sampleRate, int samplesPerBlock);
-    void process(juce::AudioBuffer<float>& buffer);
+    // Every channel gets the same settings, apart from bands placed on one channel or on mid or
+    // side. Those apply to the first two channels, the front pair in JUCE's channel orderings.
+    void prepare(double sampleRate, int samplesPerBlock, int numChannels);
+    void process(juce::AudioBuffer<SampleType>& buffer);
     void reset();
 
     // HPF: 10Hz-300Hz, 6/12/18/24dB slopes
     void setHighPassFrequency(float freq);
     void setHighPassSlope(int slopeDb); // 6, 12, 18, or 24
     void setHighPassEnabled(bool enabled);
+    void setHighPass(float freq, int slopeDb);  // One redesign for both
 
     // LPF: 5kHz-22kHz, 6/12/18/24dB slopes
     void setLowPassFrequency(float freq);
     void setLowPassSlope(int slopeDb);
     void setLowPassEnabled(bool enabled);
+    void setLowPass(float freq, int slopeDb);
 
     // Low shelf: 20Hz-500Hz
     void setLowShelfFrequency(float freq);
     void setLowShelfGain(float gainDb);
     void setLowShelfEnabled(bool enabled);
+    void setLowShelf(float freq, float gainDb);
 
     // High shelf: 2kHz-20kHz
     void setHighShelfFrequency(float freq);
     void setHighShelfGain(float gainDb);
     void setHighShelfEnabled(bool enabled);
+    void setHighShelf(float freq, float gainDb);
 
     // Parametric bands
     void setBandFrequency(int band, float freq);
     void setBandGain(int band, float gainDb);
     void setBandQ(int band, float q);
     void setBandEnabled(int band, bool enabled);
+    void setBand(int band, float freq, float gainDb, float q);
+
+    // Dynamic bands: the band's gain becomes the most it will cut or boost, applied only while
+    // its band limited level is over the threshold. Threshold -60dB to 0dB, ratio 1:1 to 10:1,
+    // attack 0.1ms to 100ms, release 10ms to 2000ms.
+    void setLowShelfDynamics(bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs);
+    void setHighShelfDynamics(bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs);
+    void setBandDynamics(int band, bool enabled, float thresholdDb, float ratio, float attackMs, float releaseMs);
+
+    // In linear phase mode only the stereo bands go into the kernel; bands placed anywhere else
+    // follow it as minimum phase sections, like the dynamic bands.
+    void setLowShelfPlacement(Placement placement);
+    void setHighShelfPlacement(Placement placement);
+    void setBandPlacement(int band, Placement placement);
 
     // Global controls
     void setLinearPhase(bool useLinearPhase);
-    void setMidSideMode(bool useMidSide);
+
+    // Linear phase is only set up once it's used, as the kernels, convolvers and designer thread
+    // cost tens of megabytes and a thread per instance. Call from the message thread after
+    // prepare() and whenever linear phase is switched on. With the audio stopped the first
+    // kernel is designed here, so the latency is right from the first block; while it's running
+    // the designer sets up in the background and the EQ stays minimum phase until it's done.
+    void startLinearPhase(bool audioStopped);
+
+    // Message thread, polled. The audio thread only leaves a flag when it asks for a kernel; this
+    // wakes the designer if it has, so the designer sleeps whenever there's nothing to design.
+    void wakeKernelDesigner();
+
+    void setLinearPhaseLength(int numTaps);          // 4096 to 65536, rounded to a power of two
+
+    // Natural phase: the linear phase kernel is designed minimum phase instead, from the same
+    // magnitude response. No pre-ringing and no latency, at the same cost as linear phase.
+    // Changing the length or phase while running keeps the current kernel until the new one has
+    // filled its convolvers, then crossfades to it; the latency moves at the start of the fade.
+    void setNaturalPhase(bool useNaturalPhase);
+    void setFilterTopology(FilterTopology newTopology);
+    void setCoefficientDesign(CoefficientDesign newDesign);
     void setBypass(bool shouldBypass);
     void setOutputGain(float gainDb);
 
+    // Auto gain: the output is trimmed by the loudness change the EQ curve makes, worked out
+    // from the response rather than measured from the audio. Dynamic bands are left out, as
+    // they only act some of the time. Placed bands count by the share of the front pair's
+    // loudness they act on: mid in full, left and right by half, side by a quarter.
+    void setAutoGain(bool shouldAutoGain);
+
+    // Added to the linear phase kernel on top of the bands; the minimum phase path ignores it.
+    // All zeros clears it.
+    void setMatchCurve(const MatchCurve& curveDb);
+
     bool isLinearPhase() const { return linearPhaseMode; }
-    bool isMidSideMode() const { return midSideMode; }
+    int getLinearPhaseLength() const { return linearPhaseLength; }
+    bool isNaturalPhase() const { return naturalPhase; }
+    FilterTopology getFilterTopology() const { return filterTopology; }
+    CoefficientDesign getCoefficientDesign() const { return coefficientDesign; }
     bool isBypassed() const { return bypassed; }
+    bool isAutoGain() const { return autoGain; }
 
-    // For UI spectrum display
-    std::array<float, 512> getMagnitudeResponse(float sampleRate) const;
+    // Latency introduced by the kernel in use (linear phase only, not natural phase), which
+    // follows a change of length or phase once the new kernel takes over. Bypass
+    // doesn't change it: in linear phase mode the convolvers keep running on a kernel that's
+    // only the delay, crossfaded to like any other.
+    int getLatencySamples() const;
+
+    // The EQ's response at the response frequencies, one curve per placement. Call from one
+    // thread only (the editor's). It picks up the coefficients the audio thread last published
+    // and re-evaluates only the sections that changed since the previous call. Dynamic bands are
+    // drawn at their full gain. A match curve is included in every curve while it's in use.
+    const MagnitudeResponse& getMagnitudeResponse();
 
 private:
-    void processMinimumPhase(juce::AudioBuffer<float>& buffer);
-    void processLinearPhase(juce::AudioBuffer<float>& buffer);
-    void processMidSide(juce::AudioBuffer<float>& buffer);
-    void encodeToMidSide(float& left, float& right);
-    void decodeFromMidSide(float& mid, float& side);
-    float processSampleThroughEQ(float input, int channel);
+    using Coefficients = DSPUtils::BiquadCoefficients<SampleType>;
+    using Frame = typename BiquadFilter<SampleType>::Frame;
+    using Detector = BandLevelDetector<SampleType>;
+
+    void processChunk(juce::AudioBuffer<SampleType>& buffer);
+    void processMinimumPhase(juce::AudioBuffer<SampleType>& buffer);
+    void processLinearPhase(juce::AudioBuffer<SampleType>& buffer);
+    void processChannelBlock(SampleType* data, int numSamples, int channel);
+
+    // Channels firstChannel onwards, one per SIMD lane, while their chains match
+    void processLaneGroup(SampleType* const* data, int firstChannel, int numLanes, int numSamples);
+    // The mid and side views of the front pair run as two more channels after the bus's own,
+    // between one pass of the matrix in and one out
+    void processMidSide(SampleType* left, SampleType* right, int numSamples);
+    bool hasMidSideBands() const;
+    bool isPlacedOn(int band, int channel) const;
+
+    // Sections a shared linear phase kernel can't hold, run after it: dynamic bands and bands
+    // placed on one channel, mid or side
+    void processUnsharedSections(SampleType* data, int numSamples, int channel);
+
+    // Coefficients of the static sections, in processing order, with where each one is placed.
+    // The shared ones are every section all the channels have in common; auto gain also takes
+    // the static bands placed on one channel, mid or side.
+    static constexpr int MAX_SECTIONS = BiquadCascade<SampleType>::MAX_SECTIONS;
+    struct ActiveSections
+    {
+        std::array<Coefficients, MAX_SECTIONS> coeffs;
+        std::array<Placement, MAX_SECTIONS> placements {};
+        int numSections = 0;
+
+        bool operator==(const ActiveSections& other) const;
+        bool operator!=(const ActiveSections& other) const { return !(*this == other); }
+    };
+    void collectSharedSections(ActiveSections& sections) const { collectStaticSections(sections, false); }
+    void collectStaticSections(ActiveSections& sections, bool includePlaced) const;
+
+    // The loudness change is the K-weighted power gain of the static curve over pink noise:
+    // equal weight per log-spaced point, times the BS.1770 pre-filter's power there
+    static constexpr int AUTO_GAIN_POINTS = RESPONSE_POINTS / 2;
+    using AutoGainCurve = std::array<float, AUTO_GAIN_POINTS>;
+    void prepareAutoGain();
+    void updateAutoGain();
+
+    // Filters in the signal path, in processing order. The mask records which slots of the
+    // chain they came from, so two channels with equal masks can share SIMD lanes.
+    using SectionList = std::array<BiquadFilter<SampleType>*, MAX_SECTIONS>;
+    int gatherSections(int channel, SectionList& sections, juce::uint32& layoutMask);
+
+    using SVFSectionList = std::array<SVFFilter<SampleType>*, MAX_SECTIONS>;
+    int gatherSVFSections(int channel, SVFSectionList& sections, juce::uint32& layoutMask);
+
+    // Dynamic bands in processing order: low shelf, parametric bands, high shelf. Placements
+    // are indexed the same way. Detection is
+    // linked across the channels, so they all get the same gains and can keep sharing SIMD lanes.
+    static constexpr int NUM_DYNAMIC_BANDS = NUM_PARAMETRIC_BANDS + 2;
+    static_assert(NUM_DYNAMIC_BANDS <= Detector::NUM_BANDS, "Not enough detector lanes");
+    static_assert(MAX_CHANNELS <= Detector::MAX_CHANNELS, "Not enough detector channels");
+    using DynamicGains = std::array<float, NUM_DYNAMIC_BANDS>;
+
+    void updateDetectors();
+    void measureDynamics(const SampleType* const* data, int numChannels, int stride, int numSamples);
+    void applyDynamicGains(int channel, int interval);
+
+    // Biquad sections in the signal path, rebuilt only after a setter has run. The cascade
+    // holds their coefficients and state; the filters only hold the designs.
+    struct SectionPlan
+    {
+        SectionList sections {};
+        int numSections = 0;
+        juce::uint32 layoutMask = 0;
+        BiquadCascade<SampleType> cascade;
+        std::array<int, NUM_DYNAMIC_BANDS> dynamicSections {};   // Cascade index per dynamic band, or -1
+        std::array<SampleType, 2> inputHistory {};   // Last two samples into the first slot
+    };
+    void updateSectionPlans();
+    void rememberInput(int channel, const SampleType* data, int numSamples, int stride);
+
+    // Magnitude response for the editor, one group per band (the pass filters count as one each)
+    static constexpr int NUM_RESPONSE_GROUPS = NUM_PARAMETRIC_BANDS + 4;
+    using ResponseCurve = std::array<float, RESPONSE_POINTS>;
+
+    struct ResponseSnapshot
+    {
+        using GroupCoeffs = std::array<Coefficients, MultiStageFilter<SampleType>::MAX_SECTIONS>;
+        std::array<GroupCoeffs, NUM_RESPONSE_GROUPS> coeffs {};
+        std::array<int, NUM_RESPONSE_GROUPS> numSections {};
+        std::array<Placement, NUM_RESPONSE_GROUPS> placements {};   // Stereo on a mono bus
+        double sampleRate = 0.0;
+        bool hasMatchCurve = false;
+        MatchCurve matchCurve {};
+
+        bool groupEquals(const ResponseSnapshot& other, int group) const;
+    };
+
+    void publishResponse();
+    void evaluateResponseGroup(int group, const ResponseSnapshot& snapshot);
+
+    DSPUtils::TripleBuffer<ResponseSnapshot> responseSnapshots;
+
+    // Editor thread side
+    ResponseSnapshot evaluatedSnapshot;
+    std::array<ResponseCurve, NUM_RESPONSE_GROUPS> groupResponses {};
+    ResponseCurve responsePhi {};          // sin^2(w / 2) at each point
+    ResponseCurve responsePower {};        // Scratch for one group's |H|^2
+    MagnitudeResponse magnitudeResponse;
 
     double currentSampleRate = 44100.0;
     int currentBlockSize = 512;
     bool linearPhaseMode = false;
-    bool midSideMode = false;
+    bool hasMatchCurve = false;
+    MatchCurve matchCurve {};
+    FilterTopology filterTopology = FilterTopology::Biquad;
+    CoefficientDesign coefficientDesign = CoefficientDesign::Bilinear;
     bool bypassed = false;
     float outputGainLinear = 1.0f;
+    float appliedOutputGain = 1.0f;        // Reached at the end of the last block
+
+    bool autoGain = false;
+    float autoGainLinear = 1.0f;
+    AutoGainCurve autoGainPhi {};          // sin^2(w / 2) at each point
+    AutoGainCurve autoGainWeights {};      // Sum to 1
+    std::array<AutoGainCurve, NUM_PLACEMENTS> autoGainPowers {};   // |H|^2 of each placement's static bands
+    ActiveSections autoGainSections;       // The curve the compensation was worked out for
 
-    // Per-channel filters (L/R or M/S)
+    // Per-channel filters (L/R or M/S for the front pair)
     struct ChannelEQ
     {
-        MultiStageFilter highPass;
-        MultiStageFilter lowPass;
-        ShelfBand lowShelf;
-        ShelfBand highShelf;
-        std::array<ParametricBand, NUM_PARAMETRIC_BANDS> parametric;
+        MultiStageFilter<SampleType> highPass;
+        MultiStageFilter<SampleType> lowPass;
+        ShelfBand<SampleType> lowShelf;
+        ShelfBand<SampleType> highShelf;
+        std::array<ParametricBand<SampleType>, NUM_PARAMETRIC_BANDS> parametric;
     };
 
-    std::array<ChannelEQ, 2> channels;
+    // The bus's channels, then the mid and side views
+    std::vector<ChannelEQ> channels;
+    std::vector<SectionPlan> sectionPlans;
+    int numBusChannels = 2;
+    std::array<Placement, NUM_DYNAMIC_BANDS> placements {};
+    bool sectionPlanDirty = true;
+
+    std::array<BandDynamics, NUM_DYNAMIC_BANDS> bandDynamics;
+    Detector levelDetector;
+    juce::uint32 dynamicBandMask = 0;                      // Active dynamic bands, rebuilt with the plans
+    std::vector<typename Detector::Levels> detectorLevels; // Per control interval of a block
+    std::vector<DynamicGains> dynamicGains;
+    std::vector<Frame> laneFrames;                         // Interleaved scratch for a lane group
+
+    // Linear phase processing (symmetric FIR through a partitioned convolver)
+    static constexpr int MIN_LINEAR_PHASE_ORDER = 12;   // 4096 taps
+    static constexpr int MAX_LINEAR_PHASE_ORDER = 16;   // 65536 taps
+    static constexpr int NUM_LINEAR_PHASE_KERNELS = 12; // Active + ringing out + ready + being designed
+    static constexpr int CEPSTRUM_OVERSAMPLING_ORDER = 2; // Natural phase is designed on a 4x finer grid
+    static constexpr int LATENCY_SWITCH_FADE = 1024;      // Output crossfade to a kernel of another latency
+
+    struct LinearPhaseRequest
+    {
+        ActiveSections sections;
+        int length = 0;
+        bool minimumPhase = false;
+        bool hasMatchCurve = false;
+        MatchCurve matchCurve {};
+
+        bool operator==(const LinearPhaseRequest& other) const
+        {
+            return sections == other.sections && length == other.length && minimumPhase == other.minimumPhase
+                && hasMatchCurve == other.hasMatchCurve && matchCurve == other.matchCurve;
+        }
+    };
 
-    // Linear phase processing
-    juce::dsp::FFT fft { 12 }; // 4096 samples
-    std::vector<float> fftBuffer;
-    std::vector<float> irBuffer;
-    std::vector<float> overlapBuffer;
+    // Designs kernels off the audio thread and hands them over through readyKernel
+    class KernelDesigner : public juce::Thread
+    {
+    public:
+        explicit KernelDesigner(MasteringEQ& eq) : juce::Thread("EQ Kernel Designer"), owner(eq) {}
+        ~KernelDesigner() override { stopThread(1000); }
+
+        void prepare();
+        void design(const LinearPhaseRequest& request, PartitionedConvolver::Kernel& kernel);
+        void run() override;
+
+    private:
+        int claimFreeKernel();
+        void designMinimumPhase(juce::dsp::FFT& fft, int kernelLength);
+
+        MasteringEQ& owner;
+        std::array<std::unique_ptr<juce::dsp::FFT>, MAX_LINEAR_PHASE_ORDER + CEPSTRUM_OVERSAMPLING_ORDER - MIN_LINEAR_PHASE_ORDER + 1> ffts;
+        std::vector<float> designBuffer;               // 2 * design size FFT work buffer
+        std::vector<float> irBuffer;                   // Windowed FIR
+    };
+
+    // Kernel ownership, handed between the designer and the audio thread
+    enum class KernelState { Free, Designer, Audio };
+
+    PartitionedConvolver::Layout linearPhaseLayout;
+    std::array<PartitionedConvolver::Kernel, NUM_LINEAR_PHASE_KERNELS> linearPhaseKernels;
+    std::array<std::atomic<KernelState>, NUM_LINEAR_PHASE_KERNELS> kernelStates;
+    std::atomic<bool> linearPhaseAllocated { false };
+    std::atomic<bool> kernelRequested { false };       // Set by the audio thread, taken by wakeKernelDesigner()
+    std::array<bool, NUM_LINEAR_PHASE_KERNELS> kernelMinimumPhase {};   // Written with the kernel
+    std::atomic<int> readyKernel { -1 };
+    DSPUtils::TripleBuffer<LinearPhaseRequest> linearPhaseRequests;
+
+    // Audio thread side
+    std::vector<PartitionedConvolver> linearPhaseConvolvers;
+    std::vector<float> linearPhaseScratch;   // A channel's float copy, for double or during a latency switch
+    LinearPhaseRequest lastLinearPhaseRequest;
+    int activeKernel = -1;
+    std::array<int, NUM_LINEAR_PHASE_KERNELS> retiredKernels {};
+    int numRetiredKernels = 0;
+    int linearPhaseLength = 1 << 14;
+    bool naturalPhase = false;
     bool linearPhaseReady = false;
-    void prepareLinearPhase();
-    void updateLinearPhaseIR();
+
+    // A kernel of another length or phase is primed on a second bank of convolvers, fed the same
+    // input until it has filled, then faded over to at the output
+    std::vector<PartitionedConvolver> incomingConvolvers;
+    std::vector<float> incomingScratch;
+    int incomingKernel = -1;
+    int switchPosition = 0;   // Samples the incoming bank has run
+
+    void prepareLinearPhase(bool designFirstKernel);
+    void allocateLinearPhase();
+    void resetLinearPhase();
+    void collectLinearPhaseRequest(LinearPhaseRequest& request) const;
+    void requestLinearPhaseKernel();
+    void acceptLinearPhaseKernel(int numChannels);
+    void retireKernel(int index);
+    void beginLatencySwitch(int index);
+    void finishLatencySwitch();
+    void convolveLinearPhase(SampleType* data, int numSamples, int channel);
+
+    KernelDesigner kernelDesigner { *this };
 };
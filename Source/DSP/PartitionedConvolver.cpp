@@ -0,0 +1,493 @@
+#include "PartitionedConvolver.h"
+
+namespace
+{
+    int getOrderForSize(int powerOfTwoSize)
+    {
+        int order = 0;
+        while ((1 << order) < powerOfTwoSize)
+            ++order;
+        return order;
+    }
+}
+
+//==============================================================================
+// Layout
+//==============================================================================
+PartitionedConvolver::Layout PartitionedConvolver::Layout::create(int maxKernelSize)
+{
+    Layout layout;
+    layout.maxKernelSize = maxKernelSize;
+
+    int partitionSize = HEAD_SIZE;
+    int offset = HEAD_SIZE;
+
+    while (offset < maxKernelSize && layout.numLevels < MAX_LEVELS)
+    {
+        const int nextSize = partitionSize * PARTITION_GROWTH;
+        const bool lastLevel = nextSize > MAX_PARTITION_SIZE || layout.numLevels == MAX_LEVELS - 1;
+        const int remaining = (maxKernelSize - offset + partitionSize - 1) / partitionSize;
+
+        // The next level starts two of its partitions in, which leaves it a whole
+        // partition's worth of blocks to spread its FFT work over
+        const int count = lastLevel ? remaining
+                                    : std::min(remaining, (2 * nextSize - offset) / partitionSize);
+
+        layout.levels[layout.numLevels++] = { partitionSize, offset, count };
+        offset += count * partitionSize;
+        partitionSize = nextSize;
+    }
+
+    return layout;
+}
+
+//==============================================================================
+// Kernel
+//==============================================================================
+void PartitionedConvolver::Kernel::prepare(const Layout& newLayout)
+{
+    layout = newLayout;
+    head.assign(HEAD_SIZE, 0.0f);
+
+    int maxPartitionSize = HEAD_SIZE;
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        const auto& level = layout.levels[i];
+        const size_t numBins = static_cast<size_t>(level.numPartitions * (level.partitionSize + 1));
+
+        spectra[i].re.assign(numBins, 0.0f);
+        spectra[i].im.assign(numBins, 0.0f);
+        spectra[i].numPartitions = 0;
+        ffts[i] = std::make_unique<juce::dsp::FFT>(getOrderForSize(2 * level.partitionSize));
+        maxPartitionSize = std::max(maxPartitionSize, level.partitionSize);
+    }
+
+    fftBuffer.assign(static_cast<size_t>(4 * maxPartitionSize), 0.0f);
+    length = 0;
+}
+
+void PartitionedConvolver::Kernel::setImpulseResponse(const float* impulseResponse, int irLength)
+{
+    length = std::min(irLength, layout.maxKernelSize);
+
+    std::fill(head.begin(), head.end(), 0.0f);
+    std::copy(impulseResponse, impulseResponse + std::min(length, HEAD_SIZE), head.begin());
+
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        const auto& level = layout.levels[i];
+        const int partitionSize = level.partitionSize;
+        const int numBins = partitionSize + 1;
+        auto& levelSpectra = spectra[i];
+
+        const int covered = (length - level.offset + partitionSize - 1) / partitionSize;
+        levelSpectra.numPartitions = std::clamp(covered, 0, level.numPartitions);
+
+        for (int p = 0; p < levelSpectra.numPartitions; ++p)
+        {
+            const int start = level.offset + p * partitionSize;
+            const int count = std::min(partitionSize, length - start);
+
+            std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+            std::copy(impulseResponse + start, impulseResponse + start + count, fftBuffer.begin());
+            ffts[i]->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+            float* re = levelSpectra.re.data() + p * numBins;
+            float* im = levelSpectra.im.data() + p * numBins;
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                re[bin] = fftBuffer[2 * bin];
+                im[bin] = fftBuffer[2 * bin + 1];
+            }
+        }
+    }
+}
+
+//==============================================================================
+// PartitionedConvolver
+//==============================================================================
+void PartitionedConvolver::prepare(const Layout& newLayout)
+{
+    layout = newLayout;
+
+    inputBlock.assign(HEAD_SIZE, 0.0f);
+    history.assign(2 * HEAD_SIZE - 1, 0.0f);
+    fadeHistory.assign(2 * HEAD_SIZE - 1, 0.0f);
+    stepOutput.assign(HEAD_SIZE, 0.0f);
+
+    fadeRamp.resize(HEAD_SIZE);
+    for (int i = 0; i < HEAD_SIZE; ++i)
+        fadeRamp[i] = static_cast<float>(i + 1) / HEAD_SIZE;
+
+    maxStepsPerPartition = 1;
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        const auto& plan = layout.levels[i];
+        auto& level = levels[i];
+
+        level.index = i;
+        level.partitionSize = plan.partitionSize;
+        level.numPartitions = plan.numPartitions;
+        level.numBins = plan.partitionSize + 1;
+        level.stepsPerPartition = plan.partitionSize / HEAD_SIZE;
+        level.fft = std::make_unique<juce::dsp::FFT>(getOrderForSize(2 * plan.partitionSize));
+
+        const size_t fdlSize = static_cast<size_t>(level.numPartitions * level.numBins);
+        level.input.assign(static_cast<size_t>(2 * plan.partitionSize), 0.0f);
+        level.work.assign(static_cast<size_t>(4 * plan.partitionSize), 0.0f);
+        level.fadeWork.assign(static_cast<size_t>(4 * plan.partitionSize), 0.0f);
+        level.fdlRe.assign(fdlSize, 0.0f);
+        level.fdlIm.assign(fdlSize, 0.0f);
+        level.fdlFadeRe.assign(fdlSize, 0.0f);
+        level.fdlFadeIm.assign(fdlSize, 0.0f);
+        level.fdlKernels.assign(static_cast<size_t>(level.numPartitions), nullptr);
+        level.fdlFadeKernels.assign(static_cast<size_t>(level.numPartitions), nullptr);
+        level.accRe.assign(static_cast<size_t>(level.numBins), 0.0f);
+        level.accIm.assign(static_cast<size_t>(level.numBins), 0.0f);
+        for (auto& out : level.output)
+            out.assign(static_cast<size_t>(plan.partitionSize), 0.0f);
+
+        maxStepsPerPartition = std::max(maxStepsPerPartition, level.stepsPerPartition);
+    }
+
+    reset();
+}
+
+void PartitionedConvolver::reset()
+{
+    for (auto* v : { &inputBlock, &history, &fadeHistory, &stepOutput })
+        std::fill(v->begin(), v->end(), 0.0f);
+
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        auto& level = levels[i];
+        for (auto* v : { &level.input, &level.work, &level.fadeWork, &level.fdlRe, &level.fdlIm,
+                         &level.fdlFadeRe, &level.fdlFadeIm, &level.accRe, &level.accIm,
+                         &level.output[0], &level.output[1] })
+            std::fill(v->begin(), v->end(), 0.0f);
+
+        std::fill(level.fdlKernels.begin(), level.fdlKernels.end(), nullptr);
+        std::fill(level.fdlFadeKernels.begin(), level.fdlFadeKernels.end(), nullptr);
+        level.workKernel = nullptr;
+        level.workFadeKernel = nullptr;
+        level.workFadeOffset = -1;
+        level.usedPartitions = 0;
+        level.fdlHead = 0;
+    }
+
+    position = 0;
+    stepCount = 0;
+    fadeStep = -2 * static_cast<juce::int64>(maxStepsPerPartition);
+    fadeKernel = nullptr;
+}
+
+void PartitionedConvolver::setKernel(const Kernel* newKernel)
+{
+    kernel = newKernel;
+    nextKernel = nullptr;
+    fadeKernel = nullptr;
+}
+
+void PartitionedConvolver::crossfadeToKernel(const Kernel* newKernel)
+{
+    jassert(canCrossfade());
+    nextKernel = newKernel;
+}
+
+bool PartitionedConvolver::canCrossfade() const
+{
+    // Keeps every input window down to at most one crossfade, and so at most two kernels
+    return nextKernel == nullptr && stepCount - fadeStep >= 2 * maxStepsPerPartition;
+}
+
+bool PartitionedConvolver::isUsingKernel(const Kernel* kernelToCheck) const
+{
+    if (kernelToCheck == nullptr)
+        return false;
+
+    if (kernelToCheck == kernel || kernelToCheck == nextKernel)
+        return true;
+
+    // Windows that still have to close over the crossfade block
+    if (kernelToCheck == fadeKernel && stepCount - fadeStep < 2 * maxStepsPerPartition)
+        return true;
+
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        const auto& level = levels[i];
+        if (level.workKernel == kernelToCheck || level.workFadeKernel == kernelToCheck)
+            return true;
+
+        for (int p = 0; p < level.numPartitions; ++p)
+            if (level.fdlKernels[p] == kernelToCheck || level.fdlFadeKernels[p] == kernelToCheck)
+                return true;
+    }
+
+    return false;
+}
+
+void PartitionedConvolver::beginCrossfade()
+{
+    fadeKernel = kernel;
+    kernel = nextKernel;
+    nextKernel = nullptr;
+    fadeStep = stepCount;
+
+    // Samples already in the head belong to the outgoing kernel
+    std::copy(history.begin(), history.begin() + HEAD_SIZE - 1, fadeHistory.begin());
+    std::fill(history.begin(), history.begin() + HEAD_SIZE - 1, 0.0f);
+}
+
+void PartitionedConvolver::process(float* data, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        if (position == 0 && nextKernel != nullptr)
+            beginCrossfade();
+
+        const int numToProcess = std::min(numSamples, HEAD_SIZE - position);
+        const bool fading = stepCount == fadeStep;
+        const bool headFading = fadeKernel != nullptr && stepCount - fadeStep < 2;
+        float* current = history.data() + (HEAD_SIZE - 1) + position;
+        float* fadeCurrent = fadeHistory.data() + (HEAD_SIZE - 1) + position;
+
+        juce::FloatVectorOperations::copy(inputBlock.data() + position, data, numToProcess);
+
+        if (fading)
+        {
+            juce::FloatVectorOperations::multiply(current, data, fadeRamp.data() + position, numToProcess);
+            juce::FloatVectorOperations::subtract(fadeCurrent, data, current, numToProcess);
+        }
+        else
+        {
+            juce::FloatVectorOperations::copy(current, data, numToProcess);
+            juce::FloatVectorOperations::clear(fadeCurrent, numToProcess);
+        }
+
+        juce::FloatVectorOperations::copy(data, stepOutput.data() + position, numToProcess);
+
+        // Direct-form head keeps the convolution free of block latency
+        if (kernel != nullptr)
+            for (int tap = 0; tap < HEAD_SIZE; ++tap)
+                juce::FloatVectorOperations::addWithMultiply(data, current - tap, kernel->head[tap], numToProcess);
+
+        if (headFading)
+            for (int tap = 0; tap < HEAD_SIZE; ++tap)
+                juce::FloatVectorOperations::addWithMultiply(data, fadeCurrent - tap, fadeKernel->head[tap], numToProcess);
+
+        position += numToProcess;
+        data += numToProcess;
+        numSamples -= numToProcess;
+
+        if (position == HEAD_SIZE)
+        {
+            processStep();
+            position = 0;
+        }
+    }
+}
+
+void PartitionedConvolver::processStep()
+{
+    for (int i = 0; i < layout.numLevels; ++i)
+    {
+        auto& level = levels[i];
+        const int partitionSize = level.partitionSize;
+        const int steps = level.stepsPerPartition;
+        const int phase = static_cast<int>(stepCount % steps);
+
+        std::copy(inputBlock.begin(), inputBlock.end(), level.input.begin() + partitionSize + phase * HEAD_SIZE);
+
+        if (i == 0)
+        {
+            // Base level turns around every block and feeds the next one
+            completeWindow(level);
+            pushInputSpectrum(level);
+
+            if (level.usedPartitions > 0)
+            {
+                std::fill(level.accRe.begin(), level.accRe.end(), 0.0f);
+                std::fill(level.accIm.begin(), level.accIm.end(), 0.0f);
+                multiplyAccumulate(level, 0, level.usedPartitions * level.numBins);
+                inverseTransform(level, level.output[0].data());
+            }
+            else
+            {
+                std::fill(level.output[0].begin(), level.output[0].end(), 0.0f);
+            }
+
+            continue;
+        }
+
+        // Forward and inverse FFTs land on different blocks for every level,
+        // and the spectral multiply-accumulate is shared out over the blocks in between
+        const int forwardPhase = i - 1;
+        const int inversePhase = steps - i;
+
+        if (phase == forwardPhase)
+        {
+            pushInputSpectrum(level);
+            std::fill(level.accRe.begin(), level.accRe.end(), 0.0f);
+            std::fill(level.accIm.begin(), level.accIm.end(), 0.0f);
+        }
+
+        if (phase >= forwardPhase && phase <= inversePhase)
+        {
+            const int numChunks = inversePhase - forwardPhase + 1;
+            const int chunk = phase - forwardPhase;
+            const int totalUnits = level.usedPartitions * level.numBins;
+            multiplyAccumulate(level, totalUnits * chunk / numChunks, totalUnits * (chunk + 1) / numChunks);
+        }
+
+        if (phase == inversePhase)
+        {
+            auto& out = level.output[(stepCount / steps + 1) & 1];
+            if (level.usedPartitions > 0)
+                inverseTransform(level, out.data());
+            else
+                std::fill(out.begin(), out.end(), 0.0f);
+        }
+
+        if (phase == steps - 1)
+            completeWindow(level);
+    }
+
+    std::copy(history.begin() + HEAD_SIZE, history.end(), history.begin());
+    std::copy(fadeHistory.begin() + HEAD_SIZE, fadeHistory.end(), fadeHistory.begin());
+    ++stepCount;
+
+    // Gather every level's contribution for the coming block
+    std::copy(levels[0].output[0].begin(), levels[0].output[0].end(), stepOutput.begin());
+    for (int i = 1; i < layout.numLevels; ++i)
+    {
+        const auto& level = levels[i];
+        const auto& out = level.output[(stepCount / level.stepsPerPartition) & 1];
+        const int offset = static_cast<int>(stepCount % level.stepsPerPartition) * HEAD_SIZE;
+        juce::FloatVectorOperations::add(stepOutput.data(), out.data() + offset, HEAD_SIZE);
+    }
+}
+
+void PartitionedConvolver::completeWindow(Level& level)
+{
+    const int partitionSize = level.partitionSize;
+    std::copy(level.input.begin(), level.input.end(), level.work.begin());
+    std::copy(level.input.begin() + partitionSize, level.input.end(), level.input.begin());
+
+    // Tag the window with the kernels it will meet
+    const juce::int64 windowStart = stepCount - 2 * level.stepsPerPartition + 1;
+    const bool spansCrossfade = fadeStep >= windowStart;
+
+    level.workKernel = kernel;
+    level.workFadeKernel = spansCrossfade ? fadeKernel : nullptr;
+    level.workFadeOffset = spansCrossfade ? static_cast<int>(fadeStep - windowStart) * HEAD_SIZE : -1;
+}
+
+void PartitionedConvolver::pushInputSpectrum(Level& level)
+{
+    const int numBins = level.numBins;
+    const int windowSize = 2 * level.partitionSize;
+    const auto covers = [&level] (const Kernel* k) { return k != nullptr && k->spectra[level.index].numPartitions > 0; };
+    const Kernel* mainKernel = covers(level.workKernel) ? level.workKernel : nullptr;
+    const Kernel* outgoingKernel = covers(level.workFadeKernel) ? level.workFadeKernel : nullptr;
+
+    level.fdlHead = (level.fdlHead + 1) % level.numPartitions;
+    level.fdlKernels[level.fdlHead] = mainKernel;
+    level.fdlFadeKernels[level.fdlHead] = outgoingKernel;
+    level.usedPartitions = kernel != nullptr ? kernel->spectra[level.index].numPartitions : 0;
+
+    if (level.workFadeOffset >= 0)
+    {
+        // Split the window: before the crossfade block goes to the outgoing kernel, after it
+        // to the incoming one, and the block itself is ramped between the two
+        float* in = level.work.data();
+        float* out = level.fadeWork.data();
+        const int start = level.workFadeOffset;
+
+        juce::FloatVectorOperations::copy(out, in, start + HEAD_SIZE);
+        juce::FloatVectorOperations::clear(out + start + HEAD_SIZE, windowSize - start - HEAD_SIZE);
+        juce::FloatVectorOperations::clear(in, start);
+        juce::FloatVectorOperations::multiply(in + start, fadeRamp.data(), HEAD_SIZE);
+        juce::FloatVectorOperations::subtract(out + start, in + start, HEAD_SIZE);
+
+        if (outgoingKernel != nullptr)
+        {
+            level.fft->performRealOnlyForwardTransform(out, true);
+            float* re = level.fdlFadeRe.data() + level.fdlHead * numBins;
+            float* im = level.fdlFadeIm.data() + level.fdlHead * numBins;
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                re[bin] = out[2 * bin];
+                im[bin] = out[2 * bin + 1];
+            }
+        }
+    }
+
+    if (mainKernel == nullptr)
+        return;
+
+    level.fft->performRealOnlyForwardTransform(level.work.data(), true);
+
+    float* re = level.fdlRe.data() + level.fdlHead * numBins;
+    float* im = level.fdlIm.data() + level.fdlHead * numBins;
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        re[bin] = level.work[2 * bin];
+        im[bin] = level.work[2 * bin + 1];
+    }
+}
+
+void PartitionedConvolver::multiplyAccumulate(Level& level, int firstUnit, int lastUnit)
+{
+    const int numBins = level.numBins;
+
+    const auto accumulate = [&level] (const float* xRe, const float* xIm, const float* hRe, const float* hIm,
+                                      int bin, int count)
+    {
+        float* accRe = level.accRe.data() + bin;
+        float* accIm = level.accIm.data() + bin;
+        juce::FloatVectorOperations::addWithMultiply(accRe, xRe, hRe, count);
+        juce::FloatVectorOperations::subtractWithMultiply(accRe, xIm, hIm, count);
+        juce::FloatVectorOperations::addWithMultiply(accIm, xRe, hIm, count);
+        juce::FloatVectorOperations::addWithMultiply(accIm, xIm, hRe, count);
+    };
+
+    for (int unit = firstUnit; unit < lastUnit;)
+    {
+        const int partition = unit / numBins;
+        const int bin = unit % numBins;
+        const int count = std::min(numBins - bin, lastUnit - unit);
+        const int slot = (level.fdlHead - partition + level.numPartitions) % level.numPartitions;
+        const size_t slotOffset = static_cast<size_t>(slot * numBins + bin);
+        const size_t kernelOffset = static_cast<size_t>(partition * numBins + bin);
+
+        if (const auto* k = level.fdlKernels[slot]; k != nullptr && partition < k->spectra[level.index].numPartitions)
+        {
+            const auto& spectra = k->spectra[level.index];
+            accumulate(level.fdlRe.data() + slotOffset, level.fdlIm.data() + slotOffset,
+                       spectra.re.data() + kernelOffset, spectra.im.data() + kernelOffset, bin, count);
+        }
+
+        if (const auto* k = level.fdlFadeKernels[slot]; k != nullptr && partition < k->spectra[level.index].numPartitions)
+        {
+            const auto& spectra = k->spectra[level.index];
+            accumulate(level.fdlFadeRe.data() + slotOffset, level.fdlFadeIm.data() + slotOffset,
+                       spectra.re.data() + kernelOffset, spectra.im.data() + kernelOffset, bin, count);
+        }
+
+        unit += count;
+    }
+}
+
+void PartitionedConvolver::inverseTransform(Level& level, float* destination)
+{
+    for (int bin = 0; bin < level.numBins; ++bin)
+    {
+        level.work[2 * bin] = level.accRe[bin];
+        level.work[2 * bin + 1] = level.accIm[bin];
+    }
+
+    level.fft->performRealOnlyInverseTransform(level.work.data());
+
+    // Overlap-save: only the second half of the circular result is alias-free
+    std::copy(level.work.begin() + level.partitionSize, level.work.begin() + 2 * level.partitionSize, destination);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include <vector>
+
+// Zero-latency, non-uniformly partitioned FFT convolution.
+// The first HEAD_SIZE taps run as a direct-form FIR. The rest of the kernel is split into
+// frequency-domain partitions that grow by PARTITION_GROWTH per level, and the work of the
+// larger levels is spread over the blocks that pass before their output is due, so the
+// CPU per block stays roughly flat as the kernel gets longer.
+class PartitionedConvolver
+{
+public:
+    static constexpr int HEAD_SIZE = 64;              // Direct FIR taps, also the base block size
+    static constexpr int PARTITION_GROWTH = 4;
+    static constexpr int MAX_PARTITION_SIZE = 4096;
+    static constexpr int MAX_LEVELS = 4;
+
+    // Partition plan shared by a convolver and the kernels it runs
+    struct Layout
+    {
+        struct Level
+        {
+            int partitionSize = 0;
+            int offset = 0;          // First kernel tap covered by this level
+            int numPartitions = 0;
+        };
+
+        std::array<Level, MAX_LEVELS> levels;
+        int numLevels = 0;
+        int maxKernelSize = 0;
+
+        static Layout create(int maxKernelSize);
+    };
+
+    // Frequency-domain kernel for one impulse response
+    class Kernel
+    {
+    public:
+        void prepare(const Layout& layout);
+        void setImpulseResponse(const float* impulseResponse, int length);
+        int getLength() const { return length; }
+
+    private:
+        friend class PartitionedConvolver;
+
+        struct LevelSpectra
+        {
+            std::vector<float> re, im;   // numPartitions * (partitionSize + 1) bins
+            int numPartitions = 0;       // Partitions actually covered by the impulse response
+        };
+
+        Layout layout;
+        std::vector<float> head;
+        std::array<LevelSpectra, MAX_LEVELS> spectra;
+        std::array<std::unique_ptr<juce::dsp::FFT>, MAX_LEVELS> ffts;
+        std::vector<float> fftBuffer;
+        int length = 0;
+    };
+
+    void prepare(const Layout& layout);
+    void reset();
+
+    // Swaps the kernel immediately, normally straight after reset()
+    void setKernel(const Kernel* newKernel);
+
+    // Crossfades to a new kernel over the next base block. The input is split between the
+    // old and new kernel rather than the output, so the old kernel's tail rings out on its
+    // own and nothing already in flight has to be recomputed.
+    void crossfadeToKernel(const Kernel* newKernel);
+    bool canCrossfade() const;
+
+    // True while the kernel can still contribute to the output
+    bool isUsingKernel(const Kernel* kernelToCheck) const;
+
+    // In-place convolution with no added latency
+    void process(float* data, int numSamples);
+
+private:
+    struct Level
+    {
+        int index = 0;
+        int partitionSize = 0;
+        int numPartitions = 0;
+        int numBins = 0;
+        int stepsPerPartition = 1;     // Base blocks per partition
+        int usedPartitions = 0;        // Partitions covered by the kernel for the current cycle
+        std::unique_ptr<juce::dsp::FFT> fft;
+
+        std::vector<float> input;      // Previous and current partition of input
+        std::vector<float> work;       // FFT work buffer
+        std::vector<float> fadeWork;   // Outgoing kernel's share of a window spanning a crossfade
+        const Kernel* workKernel = nullptr;
+        const Kernel* workFadeKernel = nullptr;
+        int workFadeOffset = -1;       // Crossfade block position in the pending window, -1 if none
+
+        // Frequency-domain delay line of input spectra, each tagged with the kernel it meets
+        std::vector<float> fdlRe, fdlIm;
+        std::vector<float> fdlFadeRe, fdlFadeIm;
+        std::vector<const Kernel*> fdlKernels, fdlFadeKernels;
+        int fdlHead = 0;
+
+        std::vector<float> accRe, accIm;
+        std::array<std::vector<float>, 2> output;
+    };
+
+    void beginCrossfade();
+    void processStep();
+    void completeWindow(Level& level);
+    void pushInputSpectrum(Level& level);
+    void multiplyAccumulate(Level& level, int firstUnit, int lastUnit);
+    void inverseTransform(Level& level, float* destination);
+
+    const Kernel* kernel = nullptr;
+    const Kernel* nextKernel = nullptr;
+    const Kernel* fadeKernel = nullptr;   // Kernel being faded out
+    Layout layout;
+    std::array<Level, MAX_LEVELS> levels;
+    int maxStepsPerPartition = 1;
+
+    std::vector<float> inputBlock;     // Unweighted input for the current block
+    std::vector<float> history;        // HEAD_SIZE - 1 previous samples + current block
+    std::vector<float> fadeHistory;    // Same, weighted for the outgoing kernel
+    std::vector<float> fadeRamp;
+    std::vector<float> stepOutput;     // Partitioned contribution for the current block
+    int position = 0;
+    juce::int64 stepCount = 0;
+    juce::int64 fadeStep = 0;          // Block the last crossfade happened in
+};
@@ -0,0 +1,452 @@
+#include "SpectralMatch.h"
+
+namespace
+{
+    // Spectra are averaged over a third of an octave around each response point
+    constexpr double SMOOTHING_OCTAVES = 1.0 / 3.0;
+
+    // Points more than this far below the loudest in either spectrum carry no useful ratio
+    constexpr float MATCH_RANGE_DB = 60.0f;
+
+    constexpr float MAX_CORRECTION_DB = 12.0f;
+    constexpr float MAX_SHELF_GAIN_DB = 12.0f;
+    constexpr float MAX_BAND_GAIN_DB = 18.0f;
+    constexpr float MIN_BAND_Q = 0.3f;
+    constexpr float MAX_BAND_Q = 4.0f;
+    constexpr float PROBE_GAIN_DB = 6.0f;
+    constexpr int NUM_REFINE_PASSES = 4;
+
+    float roundToStep(float value, float step)
+    {
+        return step * std::round(value / step);
+    }
+}
+
+SpectralMatch::SpectralMatch()
+    : juce::Thread("Spectral Match")
+{
+    for (auto& capture : captures)
+    {
+        capture.fifoBuffer.resize(FIFO_SIZE, 0.0f);
+        capture.frame.resize(FFT_SIZE, 0.0f);
+        capture.powerSum.resize(NUM_BINS, 0.0);
+    }
+
+    // Periodic Hann, so frames at half overlap add up flat
+    window.resize(FFT_SIZE);
+    for (int i = 0; i < FFT_SIZE; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(DSPUtils::TWOPI * i / FFT_SIZE);
+
+    fftBuffer.resize(FFT_SIZE * 2, 0.0f);
+}
+
+SpectralMatch::~SpectralMatch()
+{
+    stopThread(1000);
+}
+
+void SpectralMatch::prepare(double newSampleRate)
+{
+    stopThread(1000);
+
+    if (newSampleRate != sampleRate)
+    {
+        for (auto& capture : captures)
+        {
+            capture.fifo.reset();
+            capture.frameFill = 0;
+            std::fill(capture.powerSum.begin(), capture.powerSum.end(), 0.0);
+            capture.numFrames.store(0);
+        }
+    }
+
+    sampleRate = newSampleRate;
+
+    const auto kShelf = DSPUtils::calculateKWeightingShelf(sampleRate);
+    const auto kHighPass = DSPUtils::calculateKWeightingHighPass(sampleRate);
+    double totalWeight = 0.0;
+    std::array<double, POINTS> weights;
+
+    for (int i = 0; i < POINTS; ++i)
+    {
+        const double w = std::min(juce::MathConstants<double>::twoPi * MasteringEQBase::getResponseFrequency(i) / sampleRate,
+                                  juce::MathConstants<double>::pi);
+        cosW[i] = std::cos(w);
+        cos2W[i] = std::cos(2.0 * w);
+
+        weights[i] = DSPUtils::calculateMagnitudeSquared(kShelf, cosW[i], cos2W[i])
+                   * DSPUtils::calculateMagnitudeSquared(kHighPass, cosW[i], cos2W[i]);
+        totalWeight += weights[i];
+    }
+
+    for (int i = 0; i < POINTS; ++i)
+        loudnessWeights[i] = static_cast<float>(weights[i] / totalWeight);
+
+    // The thread only runs once there's something to analyse
+    if (capturingSource.load() >= 0)
+        wakeAnalysis();
+}
+
+//==============================================================================
+// Capture
+//==============================================================================
+void SpectralMatch::pushSamples(const juce::AudioBuffer<float>& buffer)
+{
+    const int source = capturingSource.load(std::memory_order_relaxed);
+    const int numChannels = buffer.getNumChannels();
+    if (source < 0 || numChannels == 0)
+        return;
+
+    // Whatever doesn't fit is dropped; the average doesn't need every frame
+    auto& capture = captures[source];
+    int start1, size1, start2, size2;
+    capture.fifo.prepareToWrite(buffer.getNumSamples(), start1, size1, start2, size2);
+
+    const float channelGain = 1.0f / static_cast<float>(numChannels);
+    const auto mixInto = [&] (int fifoStart, int bufferStart, int numSamples)
+    {
+        float* dest = capture.fifoBuffer.data() + fifoStart;
+        juce::FloatVectorOperations::copyWithMultiply(dest, buffer.getReadPointer(0, bufferStart), channelGain, numSamples);
+        for (int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::addWithMultiply(dest, buffer.getReadPointer(ch, bufferStart), channelGain, numSamples);
+    };
+
+    if (size1 > 0)
+        mixInto(start1, 0, size1);
+    if (size2 > 0)
+        mixInto(start2, size1, size2);
+
+    capture.fifo.finishedWrite(size1 + size2);
+}
+
+void SpectralMatch::startCapture(Source source)
+{
+    captures[static_cast<int>(source)].clearRequested.store(true);
+    capturingSource.store(static_cast<int>(source));
+    wakeAnalysis();
+}
+
+void SpectralMatch::stopCapture()
+{
+    capturingSource.store(-1);
+}
+
+void SpectralMatch::clear()
+{
+    stopCapture();
+    for (auto& capture : captures)
+        capture.clearRequested.store(true);
+}
+
+float SpectralMatch::getCapturedSeconds(Source source) const
+{
+    const auto& capture = captures[static_cast<int>(source)];
+    if (capture.clearRequested.load())
+        return 0.0f;
+
+    return static_cast<float>(capture.numFrames.load() * HOP_SIZE / sampleRate);
+}
+
+bool SpectralMatch::canFit() const
+{
+    return getCapturedSeconds(Source::Reference) >= MIN_CAPTURE_SECONDS
+        && getCapturedSeconds(Source::Program) >= MIN_CAPTURE_SECONDS;
+}
+
+void SpectralMatch::requestFit(Target target, float amount, bool matchedDesign)
+{
+    auto& request = fitRequests.getWriteBuffer();
+    request.target = target;
+    request.amount = juce::jlimit(0.0f, 1.0f, amount);
+    request.matchedDesign = matchedDesign;
+    fitRequests.publish();
+    wakeAnalysis();
+}
+
+void SpectralMatch::wakeAnalysis()
+{
+    if (!isThreadRunning())
+        startThread();
+    notify();
+}
+
+bool SpectralMatch::pullFit(Fit& result)
+{
+    if (!fits.update())
+        return false;
+
+    result = fits.getReadBuffer();
+    return true;
+}
+
+//==============================================================================
+// Analysis thread
+//==============================================================================
+void SpectralMatch::run()
+{
+    while (!threadShouldExit())
+    {
+        const bool capturing = capturingSource.load() >= 0;
+        bool busy = false;
+        for (auto& capture : captures)
+            busy = analyse(capture) || busy;
+
+        if (fitRequests.update())
+        {
+            fit(fitRequests.getReadBuffer(), fits.getWriteBuffer());
+            fits.publish();
+        }
+
+        // Polled while a capture runs, so the audio thread never has to signal anything. Once
+        // it's stopped and drained, sleep until the message thread starts another or asks for a fit.
+        if (!busy)
+            wait(capturing ? 10 : -1);
+    }
+}
+
+bool SpectralMatch::analyse(Capture& capture)
+{
+    if (capture.clearRequested.load())
+    {
+        capture.fifo.finishedRead(capture.fifo.getNumReady());
+        capture.frameFill = 0;
+        std::fill(capture.powerSum.begin(), capture.powerSum.end(), 0.0);
+        capture.numFrames.store(0);
+        capture.clearRequested.store(false);
+    }
+
+    const int needed = FFT_SIZE - capture.frameFill;
+    if (capture.fifo.getNumReady() < needed)
+        return false;
+
+    int start1, size1, start2, size2;
+    capture.fifo.prepareToRead(needed, start1, size1, start2, size2);
+    std::copy_n(capture.fifoBuffer.data() + start1, size1, capture.frame.data() + capture.frameFill);
+    std::copy_n(capture.fifoBuffer.data() + start2, size2, capture.frame.data() + capture.frameFill + size1);
+    capture.fifo.finishedRead(size1 + size2);
+
+    juce::FloatVectorOperations::multiply(fftBuffer.data(), capture.frame.data(), window.data(), FFT_SIZE);
+    fft.performFrequencyOnlyForwardTransform(fftBuffer.data());
+
+    for (int bin = 0; bin < NUM_BINS; ++bin)
+        capture.powerSum[bin] += static_cast<double>(fftBuffer[bin]) * fftBuffer[bin];
+
+    // Keep the second half as the start of the next frame
+    std::copy(capture.frame.begin() + HOP_SIZE, capture.frame.end(), capture.frame.begin());
+    capture.frameFill = FFT_SIZE - HOP_SIZE;
+    capture.numFrames.fetch_add(1);
+    return true;
+}
+
+void SpectralMatch::smoothToCurve(const Capture& capture, Curve& curveDb) const
+{
+    // Running sum over the bins, so each point's average is a subtraction
+    std::vector<double> cumulative(NUM_BINS + 1, 0.0);
+    for (int bin = 0; bin < NUM_BINS; ++bin)
+        cumulative[bin + 1] = cumulative[bin] + capture.powerSum[bin];
+
+    const double binsPerHz = FFT_SIZE / sampleRate;
+    const double halfWidth = std::pow(2.0, SMOOTHING_OCTAVES / 2.0);
+
+    for (int i = 0; i < POINTS; ++i)
+    {
+        const double frequency = MasteringEQBase::getResponseFrequency(i);
+        const int low = juce::jlimit(0, NUM_BINS - 1, juce::roundToInt(frequency / halfWidth * binsPerHz));
+        const int high = juce::jlimit(low, NUM_BINS - 1, juce::roundToInt(frequency * halfWidth * binsPerHz));
+
+        const double power = (cumulative[high + 1] - cumulative[low]) / (high - low + 1);
+        curveDb[i] = static_cast<float>(10.0 * std::log10(power + 1.0e-30));
+    }
+}
+
+//==============================================================================
+// Fitting
+//==============================================================================
+void SpectralMatch::fit(const FitRequest& request, Fit& result)
+{
+    result = Fit();
+    result.target = request.target;
+
+    Curve reference, program;
+    smoothToCurve(captures[static_cast<int>(Source::Reference)], reference);
+    smoothToCurve(captures[static_cast<int>(Source::Program)], program);
+
+    // Where either spectrum has nothing to compare (or the point is past Nyquist), hold the
+    // nearest point that has
+    const float referenceFloor = *std::max_element(reference.begin(), reference.end()) - MATCH_RANGE_DB;
+    const float programFloor = *std::max_element(program.begin(), program.end()) - MATCH_RANGE_DB;
+    const double nyquist = sampleRate / 2.0;
+
+    auto& correction = result.correction;
+    std::array<bool, POINTS> valid {};
+    int firstValid = -1;
+
+    for (int i = 0; i < POINTS; ++i)
+    {
+        valid[i] = reference[i] > referenceFloor && program[i] > programFloor
+                && MasteringEQBase::getResponseFrequency(i) < nyquist;
+        correction[i] = reference[i] - program[i];
+        if (valid[i] && firstValid < 0)
+            firstValid = i;
+    }
+
+    if (firstValid < 0)
+        return;
+
+    for (int i = 0; i < POINTS; ++i)
+        if (!valid[i])
+            correction[i] = i < firstValid ? correction[firstValid] : correction[i - 1];
+
+    // Level matched the way the EQ's auto gain works it out, so the curve changes the tone
+    // rather than the loudness
+    for (auto& value : correction)
+        value *= request.amount;
+
+    float loudnessGain = 0.0f;
+    for (int i = 0; i < POINTS; ++i)
+        loudnessGain += loudnessWeights[i] * std::pow(10.0f, correction[i] / 10.0f);
+
+    const float offsetDb = 10.0f * std::log10(std::max(loudnessGain, 1.0e-12f));
+    for (auto& value : correction)
+        value = juce::jlimit(-MAX_CORRECTION_DB, MAX_CORRECTION_DB, value - offsetDb);
+
+    fitBands(request, result);
+}
+
+void SpectralMatch::fitBands(const FitRequest& request, Fit& result)
+{
+    struct Filter
+    {
+        Shape shape;
+        BandSettings* settings;
+        float minFrequency, maxFrequency, maxGainDb;
+        Curve response {};
+    };
+
+    const float topFrequency = static_cast<float>(std::min(20000.0, 0.45 * sampleRate));
+    std::array<Filter, MasteringEQBase::NUM_PARAMETRIC_BANDS + 2> filters;
+    filters[0] = { Shape::LowShelf, &result.lowShelf, 20.0f, 500.0f, MAX_SHELF_GAIN_DB };
+    filters[1] = { Shape::HighShelf, &result.highShelf, 2000.0f, topFrequency, MAX_SHELF_GAIN_DB };
+    for (int band = 0; band < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++band)
+        filters[2 + band] = { Shape::Bell, &result.bands[band], 20.0f, topFrequency, MAX_BAND_GAIN_DB };
+
+    Curve residual = result.correction;
+    Curve trial;
+
+    const auto squaredError = [&] (const Curve& response)
+    {
+        double error = 0.0;
+        for (int i = 0; i < POINTS; ++i)
+            error += (residual[i] - response[i]) * (residual[i] - response[i]);
+        return error;
+    };
+
+    // Puts the filter at each frequency and Q in turn, with the gain that best fits the residual
+    // there, and keeps the best. A shape's dB curve scales close to linearly with its gain, so a
+    // probe at a fixed gain gives that gain by projection.
+    const auto fitFilter = [&] (Filter& filter, const std::vector<float>& frequencies, const std::vector<float>& qs)
+    {
+        juce::FloatVectorOperations::add(residual.data(), filter.response.data(), POINTS);
+        double bestError = squaredError(filter.response);
+
+        for (float frequency : frequencies)
+        {
+            for (float q : qs)
+            {
+                BandSettings settings { juce::jlimit(filter.minFrequency, filter.maxFrequency, frequency), PROBE_GAIN_DB,
+                                        juce::jlimit(MIN_BAND_Q, MAX_BAND_Q, q) };
+                evaluate(filter.shape, settings, request.matchedDesign, trial);
+
+                double projection = 0.0, energy = 0.0;
+                for (int i = 0; i < POINTS; ++i)
+                {
+                    projection += residual[i] * trial[i];
+                    energy += trial[i] * trial[i];
+                }
+
+                const float gainDb = energy > 0.0 ? static_cast<float>(PROBE_GAIN_DB * projection / energy) : 0.0f;
+                settings.gainDb = roundToStep(juce::jlimit(-filter.maxGainDb, filter.maxGainDb, gainDb), 0.1f);
+                evaluate(filter.shape, settings, request.matchedDesign, trial);
+
+                const double error = squaredError(trial);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    *filter.settings = settings;
+                    filter.response = trial;
+                }
+            }
+        }
+
+        juce::FloatVectorOperations::subtract(residual.data(), filter.response.data(), POINTS);
+    };
+
+    const auto logSpaced = [] (float low, float high, int count)
+    {
+        std::vector<float> frequencies(count);
+        for (int i = 0; i < count; ++i)
+            frequencies[i] = low * std::pow(high / low, static_cast<float>(i) / (count - 1));
+        return frequencies;
+    };
+
+    const auto around = [] (float centre, int steps, float octavesPerStep)
+    {
+        std::vector<float> values;
+        for (int i = -steps; i <= steps; ++i)
+            values.push_back(centre * std::pow(2.0f, i * octavesPerStep));
+        return values;
+    };
+
+    // Shelves take the broad tilt first, then each bell goes where the most is left over
+    for (int f = 0; f < 2; ++f)
+    {
+        *filters[f].settings = { std::sqrt(filters[f].minFrequency * filters[f].maxFrequency), 0.0f, 1.0f };
+        fitFilter(filters[f], logSpaced(filters[f].minFrequency, filters[f].maxFrequency, 16), { 1.0f });
+    }
+
+    for (int f = 2; f < static_cast<int>(filters.size()); ++f)
+    {
+        int peak = 0;
+        for (int i = 0; i < POINTS; ++i)
+            if (MasteringEQBase::getResponseFrequency(i) <= topFrequency && std::abs(residual[i]) > std::abs(residual[peak]))
+                peak = i;
+
+        *filters[f].settings = { MasteringEQBase::getResponseFrequency(peak), 0.0f, 1.0f };
+        fitFilter(filters[f], around(MasteringEQBase::getResponseFrequency(peak), 2, 1.0f / 12.0f),
+                  { 0.5f, 0.7f, 1.0f, 1.4f, 2.0f, 3.0f });
+    }
+
+    // Then each filter is nudged in turn with the others in place
+    for (int pass = 0; pass < NUM_REFINE_PASSES; ++pass)
+    {
+        for (auto& filter : filters)
+        {
+            const auto& settings = *filter.settings;
+            const auto qs = filter.shape == Shape::Bell ? around(settings.q, 1, 0.25f) : std::vector<float> { 1.0f };
+            fitFilter(filter, around(settings.frequency, 2, 1.0f / 12.0f), qs);
+        }
+    }
+
+    result.fitted.fill(0.0f);
+    for (const auto& filter : filters)
+        juce::FloatVectorOperations::add(result.fitted.data(), filter.response.data(), POINTS);
+}
+
+void SpectralMatch::evaluate(Shape shape, const BandSettings& settings, bool matchedDesign, Curve& curveDb) const
+{
+    const double frequency = settings.frequency, gainDb = settings.gainDb, q = settings.q;
+
+    DSPUtils::BiquadCoefficients<double> coeffs;
+    if (shape == Shape::LowShelf)
+        coeffs = matchedDesign ? DSPUtils::calculateMatchedLowShelf(sampleRate, frequency, gainDb)
+                               : DSPUtils::calculateLowShelf(sampleRate, frequency, gainDb);
+    else if (shape == Shape::HighShelf)
+        coeffs = matchedDesign ? DSPUtils::calculateMatchedHighShelf(sampleRate, frequency, gainDb)
+                               : DSPUtils::calculateHighShelf(sampleRate, frequency, gainDb);
+    else
+        coeffs = matchedDesign ? DSPUtils::calculateMatchedPeakingEQ(sampleRate, frequency, q, gainDb)
+                               : DSPUtils::calculatePeakingEQ(sampleRate, frequency, q, gainDb);
+
+    for (int i = 0; i < POINTS; ++i)
+        curveDb[i] = static_cast<float>(10.0 * std::log10(std::max(DSPUtils::calculateMagnitudeSquared(coeffs, cosW[i], cos2W[i]), 1.0e-30)));
+}
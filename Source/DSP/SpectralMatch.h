@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPUtils.h"
+#include "MasteringEQ.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Spectral match EQ. Long-term average spectra of a reference and of the program are captured
+// from the audio thread, then a correction curve is fitted either to the shelves and parametric
+// bands or, for the linear phase EQ, taken as it is. Frames are analysed and fits worked out on
+// a thread of its own, so a capture of any length never holds up the audio or the editor. The
+// thread is started by the first capture or fit, and sleeps whenever neither is running.
+class SpectralMatch : private juce::Thread
+{
+public:
+    enum class Source { Reference, Program };
+    enum class Target { Bands, LinearPhase };
+
+    // dB at MasteringEQBase's response frequencies
+    using Curve = MasteringEQBase::MatchCurve;
+
+    struct BandSettings
+    {
+        float frequency = 1000.0f;
+        float gainDb = 0.0f;
+        float q = 1.0f;
+    };
+
+    struct Fit
+    {
+        Target target = Target::Bands;
+        Curve correction {};   // Level matched, scaled by the amount and clamped
+        Curve fitted {};       // What the band settings below come to
+        BandSettings lowShelf, highShelf;
+        std::array<BandSettings, MasteringEQBase::NUM_PARAMETRIC_BANDS> bands;
+    };
+
+    SpectralMatch();
+    ~SpectralMatch() override;
+
+    // Not while the audio thread is pushing samples. A capture made at another sample rate is dropped.
+    void prepare(double sampleRate);
+
+    // Audio thread: the channels are averaged into whichever capture is running
+    void pushSamples(const juce::AudioBuffer<float>& buffer);
+
+    // Message thread. Starting a capture clears what that source had before; one runs at a time.
+    void startCapture(Source source);
+    void stopCapture();
+    void clear();
+    bool isCapturing(Source source) const { return capturingSource.load() == static_cast<int>(source); }
+    float getCapturedSeconds(Source source) const;
+    bool canFit() const;
+
+    // Message thread. Amount 0-1 scales the correction; the bands are designed as the EQ will
+    // run them. The result turns up in pullFit() once the analysis thread gets to it.
+    void requestFit(Target target, float amount, bool matchedDesign);
+    bool pullFit(Fit& fit);
+
+private:
+    static constexpr int FFT_ORDER = 13;
+    static constexpr int FFT_SIZE = 1 << FFT_ORDER;    // 8192, 5.9Hz bins at 48kHz
+    static constexpr int HOP_SIZE = FFT_SIZE / 2;
+    static constexpr int NUM_BINS = FFT_SIZE / 2 + 1;
+    static constexpr int FIFO_SIZE = 1 << 16;
+    static constexpr int POINTS = MasteringEQBase::RESPONSE_POINTS;
+    static constexpr float MIN_CAPTURE_SECONDS = 2.0f;
+
+    struct Capture
+    {
+        juce::AbstractFifo fifo { FIFO_SIZE };
+        std::vector<float> fifoBuffer;
+        std::atomic<bool> clearRequested { false };
+
+        // Analysis thread side
+        std::vector<float> frame;          // FFT_SIZE samples, overlapping the last by HOP_SIZE
+        int frameFill = 0;
+        std::vector<double> powerSum;      // Per bin, over every frame so far
+        std::atomic<int> numFrames { 0 };
+    };
+
+    struct FitRequest
+    {
+        Target target = Target::Bands;
+        float amount = 1.0f;
+        bool matchedDesign = false;
+    };
+
+    enum class Shape { LowShelf, HighShelf, Bell };
+
+    void wakeAnalysis();
+    void run() override;
+    bool analyse(Capture& capture);
+    void smoothToCurve(const Capture& capture, Curve& curveDb) const;
+    void fit(const FitRequest& request, Fit& result);
+    void fitBands(const FitRequest& request, Fit& result);
+    void evaluate(Shape shape, const BandSettings& settings, bool matchedDesign, Curve& curveDb) const;
+
+    std::array<Capture, 2> captures;
+    std::atomic<int> capturingSource { -1 };
+    double sampleRate = 44100.0;
+
+    DSPUtils::TripleBuffer<FitRequest> fitRequests;
+    DSPUtils::TripleBuffer<Fit> fits;
+
+    // Analysis thread side
+    juce::dsp::FFT fft { FFT_ORDER };
+    std::vector<float> window;
+    std::vector<float> fftBuffer;
+    std::array<double, POINTS> cosW {}, cos2W {};  // At the response frequencies
+    Curve loudnessWeights {};                      // K-weighted pink noise, summing to 1
+};
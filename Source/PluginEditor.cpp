@@ -24,6 +24,45 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
         spectrumAnalyzer.setSlope(slopes[slopeSelector.getSelectedId() - 1]);
     };
 
+    // Spectral match: capture a reference and the mix, then fit to the bands or the FIR
+    const auto toggleCapture = [this] (SpectralMatch::Source source)
+    {
+        auto& spectralMatch = audioProcessor.getSpectralMatch();
+        if (spectralMatch.isCapturing(source))
+            spectralMatch.stopCapture();
+        else
+            spectralMatch.startCapture(source);
+    };
+    const auto requestFit = [this] (SpectralMatch::Target target)
+    {
+        auto& spectralMatch = audioProcessor.getSpectralMatch();
+        const bool matchedDesign = audioProcessor.getAPVTS().getRawParameterValue("eqDesign")->load() > 0.5f;
+        spectralMatch.stopCapture();
+        spectralMatch.requestFit(target, static_cast<float>(matchAmountSlider.getValue()) / 100.0f, matchedDesign);
+    };
+
+    addAndMakeVisible(matchReferenceButton);
+    addAndMakeVisible(matchProgramButton);
+    matchReferenceButton.onClick = [toggleCapture] { toggleCapture(SpectralMatch::Source::Reference); };
+    matchProgramButton.onClick = [toggleCapture] { toggleCapture(SpectralMatch::Source::Program); };
+
+    addAndMakeVisible(matchAmountSlider);
+    matchAmountSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    matchAmountSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    matchAmountSlider.setRange(0.0, 100.0, 1.0);
+    matchAmountSlider.setTextValueSuffix("%");
+    matchAmountSlider.setValue(100.0, juce::dontSendNotification);
+
+    addAndMakeVisible(matchBandsButton);
+    addAndMakeVisible(matchFirButton);
+    addAndMakeVisible(matchClearButton);
+    matchBandsButton.onClick = [requestFit] { requestFit(SpectralMatch::Target::Bands); };
+    matchFirButton.onClick = [requestFit] { requestFit(SpectralMatch::Target::LinearPhase); };
+    matchClearButton.onClick = [this] {
+        audioProcessor.getSpectralMatch().clear();
+        audioProcessor.clearMatchCurve();
+    };
+
     // Meter panel
     addAndMakeVisible(meterPanel);
 
@@ -85,11 +124,14 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     lpfLabel.setJustificationType(juce::Justification::centred);
 
     // Low Shelf
+    const juce::StringArray placementChoices { "Stereo", "Left", "Right", "Mid", "Side" };
     lsFreqSlider.setLookAndFeel(&eqLookAndFeel);
     lsGainSlider.setLookAndFeel(&eqLookAndFeel);
     setupRotarySlider(lsFreqSlider);
     setupRotarySlider(lsGainSlider);
     eqContent.addAndMakeVisible(lsButton);
+    lsPlacementBox.addItemList(placementChoices, 1);
+    eqContent.addAndMakeVisible(lsPlacementBox);
     eqContent.addAndMakeVisible(lsFreqLabel);
     eqContent.addAndMakeVisible(lsGainLabel);
     lsFreqLabel.setJustificationType(juce::Justification::centred);
@@ -101,14 +143,15 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     setupRotarySlider(hsFreqSlider);
     setupRotarySlider(hsGainSlider);
     eqContent.addAndMakeVisible(hsButton);
+    hsPlacementBox.addItemList(placementChoices, 1);
+    eqContent.addAndMakeVisible(hsPlacementBox);
     eqContent.addAndMakeVisible(hsFreqLabel);
     eqContent.addAndMakeVisible(hsGainLabel);
     hsFreqLabel.setJustificationType(juce::Justification::centred);
     hsGainLabel.setJustificationType(juce::Justification::centred);
 
     // Parametric bands
-    const char* bandNames[] = { "1", "2", "3", "4" };
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
     {
         bandControls[i].freqSlider.setLookAndFeel(&eqLookAndFeel);
         bandControls[i].gainSlider.setLookAndFeel(&eqLookAndFeel);
@@ -117,19 +160,31 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
         setupRotarySlider(bandControls[i].gainSlider);
         setupRotarySlider(bandControls[i].qSlider);
 
-        bandControls[i].enableButton.setButtonText(bandNames[i]);
-        eqContent.addAndMakeVisible(bandControls[i].enableButton);
-        eqContent.addAndMakeVisible(bandControls[i].freqLabel);
-        eqContent.addAndMakeVisible(bandControls[i].gainLabel);
-        eqContent.addAndMakeVisible(bandControls[i].qLabel);
+        bandControls[i].enableButton.setButtonText(juce::String(i + 1));
+        bandContent.addAndMakeVisible(bandControls[i].enableButton);
+        bandControls[i].placementBox.addItemList(placementChoices, 1);
+        bandContent.addAndMakeVisible(bandControls[i].placementBox);
+        bandContent.addAndMakeVisible(bandControls[i].freqLabel);
+        bandContent.addAndMakeVisible(bandControls[i].gainLabel);
+        bandContent.addAndMakeVisible(bandControls[i].qLabel);
         bandControls[i].freqLabel.setJustificationType(juce::Justification::centred);
         bandControls[i].gainLabel.setJustificationType(juce::Justification::centred);
         bandControls[i].qLabel.setJustificationType(juce::Justification::centred);
     }
+    bandViewport.setViewedComponent(&bandContent, false);
+    bandViewport.setScrollBarsShown(false, true);
+    eqContent.addAndMakeVisible(bandViewport);
 
     // EQ options
     eqContent.addAndMakeVisible(eqLinearPhaseButton);
-    eqContent.addAndMakeVisible(eqMidSideButton);
+    eqLinearPhaseLengthBox.addItemList({ "4k", "8k", "16k", "32k", "64k" }, 1);
+    eqContent.addAndMakeVisible(eqLinearPhaseLengthBox);
+    eqContent.addAndMakeVisible(eqNaturalPhaseButton);
+    eqTopologyBox.addItemList({ "Biquad", "SVF" }, 1);
+    eqContent.addAndMakeVisible(eqTopologyBox);
+    eqDesignBox.addItemList({ "Bilinear", "Matched" }, 1);
+    eqContent.addAndMakeVisible(eqDesignBox);
+    eqContent.addAndMakeVisible(eqAutoGainButton);
     eqContent.addAndMakeVisible(eqBypassButton);
 
     // Compressor sliders
@@ -142,6 +197,7 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     compMixSlider.setLookAndFeel(&compLookAndFeel);
     compScHpfSlider.setLookAndFeel(&compLookAndFeel);
     compStereoLinkSlider.setLookAndFeel(&compLookAndFeel);
+    compLookaheadSlider.setLookAndFeel(&compLookAndFeel);
 
     setupRotarySlider(compThresholdSlider);
     setupRotarySlider(compRatioSlider);
@@ -152,9 +208,11 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     setupRotarySlider(compMixSlider);
     setupRotarySlider(compScHpfSlider);
     setupRotarySlider(compStereoLinkSlider);
+    setupRotarySlider(compLookaheadSlider);
 
     for (auto* label : { &compThreshLabel, &compRatioLabel, &compAttackLabel, &compReleaseLabel,
-                         &compKneeLabel, &compMakeupLabel, &compMixLabel, &compScHpfLabel, &compLinkLabel })
+                         &compKneeLabel, &compMakeupLabel, &compMixLabel, &compScHpfLabel, &compLinkLabel,
+                         &compLookaheadLabel })
     {
         label->setJustificationType(juce::Justification::centred);
         compContent.addAndMakeVisible(label);
@@ -163,6 +221,12 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     compModeBox.addItemList({ "Clean", "Glue", "Punch", "Vintage" }, 1);
     compContent.addAndMakeVisible(compModeBox);
 
+    compBandsBox.addItemList({ "Wideband", "3 Bands", "4 Bands", "5 Bands" }, 1);
+    compContent.addAndMakeVisible(compBandsBox);
+
+    compOversamplingBox.addItemList({ "1x", "2x", "4x", "8x" }, 1);
+    compContent.addAndMakeVisible(compOversamplingBox);
+
     compContent.addAndMakeVisible(compAutoReleaseButton);
     compContent.addAndMakeVisible(compScListenButton);
     compContent.addAndMakeVisible(compMidSideButton);
@@ -195,14 +259,16 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     lsFreqAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "lsFreq", lsFreqSlider);
     lsGainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "lsGain", lsGainSlider);
     lsEnabledAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "lsEnabled", lsButton);
+    lsPlacementAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "lsPlacement", lsPlacementBox);
 
     // High Shelf
     hsFreqAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "hsFreq", hsFreqSlider);
     hsGainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "hsGain", hsGainSlider);
     hsEnabledAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "hsEnabled", hsButton);
+    hsPlacementAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "hsPlacement", hsPlacementBox);
 
     // Bands
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
     {
         juce::String prefix = "band" + juce::String(i + 1);
         bandAttachments[i].freq = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
@@ -213,11 +279,17 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
             apvts, prefix + "Q", bandControls[i].qSlider);
         bandAttachments[i].enabled = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
             apvts, prefix + "Enabled", bandControls[i].enableButton);
+        bandAttachments[i].placement = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+            apvts, prefix + "Placement", bandControls[i].placementBox);
     }
 
     // EQ Global
     eqLinearPhaseAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "eqLinearPhase", eqLinearPhaseButton);
-    eqMidSideAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "eqMidSide", eqMidSideButton);
+    eqLinearPhaseLengthAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "eqLinearPhaseLength", eqLinearPhaseLengthBox);
+    eqNaturalPhaseAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "eqNaturalPhase", eqNaturalPhaseButton);
+    eqTopologyAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "eqTopology", eqTopologyBox);
+    eqDesignAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "eqDesign", eqDesignBox);
+    eqAutoGainAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "eqAutoGain", eqAutoGainButton);
     eqBypassAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "eqBypass", eqBypassButton);
 
     // Compressor
@@ -230,7 +302,10 @@ MasterBusAudioProcessorEditor::MasterBusAudioProcessorEditor(MasterBusAudioProce
     compMixAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "compMix", compMixSlider);
     compScHpfAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "compScHpf", compScHpfSlider);
     compStereoLinkAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "compStereoLink", compStereoLinkSlider);
+    compLookaheadAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, "compLookahead", compLookaheadSlider);
     compModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "compMode", compModeBox);
+    compBandsAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "compBands", compBandsBox);
+    compOversamplingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, "compOversampling", compOversamplingBox);
     compAutoReleaseAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "compAutoRelease", compAutoReleaseButton);
     compScListenAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "compScListen", compScListenButton);
     compMidSideAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(apvts, "compMidSide", compMidSideButton);
@@ -274,6 +349,7 @@ MasterBusAudioProcessorEditor::~MasterBusAudioProcessorEditor()
     compMixSlider.setLookAndFeel(nullptr);
     compScHpfSlider.setLookAndFeel(nullptr);
     compStereoLinkSlider.setLookAndFeel(nullptr);
+    compLookaheadSlider.setLookAndFeel(nullptr);
     outputGainSlider.setLookAndFeel(nullptr);
 
     setLookAndFeel(nullptr);
@@ -328,6 +404,31 @@ void MasterBusAudioProcessorEditor::timerCallback()
     // Update spectrum analyzer
     spectrumAnalyzer.pushPreBuffer(audioProcessor.getPreEQBuffer());
     spectrumAnalyzer.pushPostBuffer(audioProcessor.getPostProcessBuffer());
+    spectrumAnalyzer.setEQResponse(audioProcessor.getEQResponse());
+
+    updateSpectralMatch();
+}
+
+void MasterBusAudioProcessorEditor::updateSpectralMatch()
+{
+    auto& spectralMatch = audioProcessor.getSpectralMatch();
+
+    const auto showCapture = [&spectralMatch] (juce::TextButton& button, SpectralMatch::Source source, const juce::String& name)
+    {
+        const int seconds = static_cast<int>(spectralMatch.getCapturedSeconds(source));
+        button.setToggleState(spectralMatch.isCapturing(source), juce::dontSendNotification);
+        button.setButtonText(seconds > 0 ? name + " " + juce::String(seconds) + "s" : name);
+    };
+    showCapture(matchReferenceButton, SpectralMatch::Source::Reference, "Ref");
+    showCapture(matchProgramButton, SpectralMatch::Source::Program, "Mix");
+
+    const bool canFit = spectralMatch.canFit();
+    matchBandsButton.setEnabled(canFit);
+    matchFirButton.setEnabled(canFit);
+
+    SpectralMatch::Fit fit;
+    if (spectralMatch.pullFit(fit))
+        audioProcessor.applySpectralMatch(fit);
 }
 
 void MasterBusAudioProcessorEditor::paint(juce::Graphics& g)
@@ -386,6 +487,13 @@ void MasterBusAudioProcessorEditor::resized()
     analyzerControlsArea.removeFromLeft(10);
     slopeSelector.setBounds(analyzerControlsArea.removeFromLeft(100).reduced(2));
 
+    matchClearButton.setBounds(analyzerControlsArea.removeFromRight(50).reduced(2));
+    matchFirButton.setBounds(analyzerControlsArea.removeFromRight(75).reduced(2));
+    matchBandsButton.setBounds(analyzerControlsArea.removeFromRight(75).reduced(2));
+    matchAmountSlider.setBounds(analyzerControlsArea.removeFromRight(120).reduced(2));
+    matchProgramButton.setBounds(analyzerControlsArea.removeFromRight(60).reduced(2));
+    matchReferenceButton.setBounds(analyzerControlsArea.removeFromRight(60).reduced(2));
+
     // Output controls in bottom bar
     int outputKnobSize = 45;
     auto outputArea = bottomBar.removeFromLeft(outputKnobSize + 10);
@@ -454,7 +562,9 @@ void MasterBusAudioProcessorEditor::layoutEQContent()
 
     // Low Shelf
     auto lsArea = row1.removeFromLeft(110);
-    lsButton.setBounds(lsArea.removeFromTop(18).withWidth(35));
+    auto lsHeader = lsArea.removeFromTop(18);
+    lsButton.setBounds(lsHeader.removeFromLeft(35));
+    lsPlacementBox.setBounds(lsHeader.removeFromRight(60).reduced(0, 1));
     auto lsKnobs = lsArea.removeFromTop(knobSize);
     lsFreqSlider.setBounds(lsKnobs.removeFromLeft(55));
     lsGainSlider.setBounds(lsKnobs.removeFromLeft(55));
@@ -466,7 +576,9 @@ void MasterBusAudioProcessorEditor::layoutEQContent()
 
     // High Shelf
     auto hsArea = row1.removeFromLeft(110);
-    hsButton.setBounds(hsArea.removeFromTop(18).withWidth(35));
+    auto hsHeader = hsArea.removeFromTop(18);
+    hsButton.setBounds(hsHeader.removeFromLeft(35));
+    hsPlacementBox.setBounds(hsHeader.removeFromRight(60).reduced(0, 1));
     auto hsKnobs = hsArea.removeFromTop(knobSize);
     hsFreqSlider.setBounds(hsKnobs.removeFromLeft(55));
     hsGainSlider.setBounds(hsKnobs.removeFromLeft(55));
@@ -476,14 +588,23 @@ void MasterBusAudioProcessorEditor::layoutEQContent()
 
     bounds.removeFromTop(5);
 
-    // Row 2: Parametric bands (2x2 layout)
-    auto row2 = bounds.removeFromTop(rowHeight * 2);
-    int bandWidth = row2.getWidth() / 4;
-
-    for (int i = 0; i < 4; ++i)
+    // Row 2: Parametric bands, four to the panel's width and scrolled sideways past that
+    constexpr int maxVisibleBands = 4;
+    constexpr int numBands = MasteringEQBase::NUM_PARAMETRIC_BANDS;
+    int bandHeight = 18 + 2 * (knobSize + labelHeight);
+    int scrollBarHeight = numBands > maxVisibleBands ? bandViewport.getScrollBarThickness() : 0;
+    auto row2 = bounds.removeFromTop(bandHeight + scrollBarHeight);
+    bandViewport.setBounds(row2);
+    int bandWidth = row2.getWidth() / juce::jmin(numBands, maxVisibleBands);
+    bandContent.setSize(bandWidth * numBands, bandHeight);
+    auto bandsArea = bandContent.getLocalBounds();
+
+    for (int i = 0; i < numBands; ++i)
     {
-        auto bandArea = row2.removeFromLeft(bandWidth);
-        bandControls[i].enableButton.setBounds(bandArea.removeFromTop(18).withWidth(25).withX(bandArea.getX() + bandWidth/2 - 12));
+        auto bandArea = bandsArea.removeFromLeft(bandWidth);
+        auto bandHeader = bandArea.removeFromTop(18);
+        bandControls[i].enableButton.setBounds(bandHeader.removeFromLeft(25));
+        bandControls[i].placementBox.setBounds(bandHeader.removeFromRight(60).reduced(2, 1));
 
         auto knobRow1 = bandArea.removeFromTop(knobSize);
         bandControls[i].freqSlider.setBounds(knobRow1);
@@ -504,7 +625,11 @@ void MasterBusAudioProcessorEditor::layoutEQContent()
     // EQ Options row
     auto optionsRow = bounds.removeFromTop(25);
     eqLinearPhaseButton.setBounds(optionsRow.removeFromLeft(90).reduced(2));
-    eqMidSideButton.setBounds(optionsRow.removeFromLeft(50).reduced(2));
+    eqLinearPhaseLengthBox.setBounds(optionsRow.removeFromLeft(60).reduced(2));
+    eqNaturalPhaseButton.setBounds(optionsRow.removeFromLeft(65).reduced(2));
+    eqTopologyBox.setBounds(optionsRow.removeFromLeft(70).reduced(2));
+    eqDesignBox.setBounds(optionsRow.removeFromLeft(80).reduced(2));
+    eqAutoGainButton.setBounds(optionsRow.removeFromLeft(80).reduced(2));
     eqBypassButton.setBounds(optionsRow.removeFromRight(60).reduced(2));
 
     // Add sliders to eqContent
@@ -514,11 +639,11 @@ void MasterBusAudioProcessorEditor::layoutEQContent()
     eqContent.addAndMakeVisible(lsGainSlider);
     eqContent.addAndMakeVisible(hsFreqSlider);
     eqContent.addAndMakeVisible(hsGainSlider);
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
     {
-        eqContent.addAndMakeVisible(bandControls[i].freqSlider);
-        eqContent.addAndMakeVisible(bandControls[i].gainSlider);
-        eqContent.addAndMakeVisible(bandControls[i].qSlider);
+        bandContent.addAndMakeVisible(bandControls[i].freqSlider);
+        bandContent.addAndMakeVisible(bandControls[i].gainSlider);
+        bandContent.addAndMakeVisible(bandControls[i].qSlider);
     }
 }
 
@@ -564,8 +689,9 @@ void MasterBusAudioProcessorEditor::layoutCompContent()
 
     bounds.removeFromTop(5);
 
-    // Row 3: Mix, SC HPF, Stereo Link
+    // Row 3: Mix, SC HPF, Stereo Link, Look-ahead
     auto row3 = bounds.removeFromTop(rowHeight);
+    compKnobWidth = row3.getWidth() / 4;
 
     auto mixArea = row3.removeFromLeft(compKnobWidth);
     compMixSlider.setBounds(mixArea.removeFromTop(knobSize));
@@ -575,10 +701,14 @@ void MasterBusAudioProcessorEditor::layoutCompContent()
     compScHpfSlider.setBounds(scHpfArea.removeFromTop(knobSize));
     compScHpfLabel.setBounds(scHpfArea.removeFromTop(labelHeight));
 
-    auto linkArea = row3;
+    auto linkArea = row3.removeFromLeft(compKnobWidth);
     compStereoLinkSlider.setBounds(linkArea.removeFromTop(knobSize));
     compLinkLabel.setBounds(linkArea.removeFromTop(labelHeight));
 
+    auto lookaheadArea = row3;
+    compLookaheadSlider.setBounds(lookaheadArea.removeFromTop(knobSize));
+    compLookaheadLabel.setBounds(lookaheadArea.removeFromTop(labelHeight));
+
     bounds.removeFromTop(5);
 
     // Row 4: Mode selector and options
@@ -593,6 +723,9 @@ void MasterBusAudioProcessorEditor::layoutCompContent()
     // Row 5: More options
     auto row5 = bounds.removeFromTop(25);
     compMidSideButton.setBounds(row5.removeFromLeft(50).reduced(2));
+    row5.removeFromLeft(5);
+    compBandsBox.setBounds(row5.removeFromLeft(90).reduced(2));
+    compOversamplingBox.setBounds(row5.removeFromLeft(55).reduced(2));
     compBypassButton.setBounds(row5.removeFromRight(60).reduced(2));
 
     // Add sliders to compContent
@@ -605,4 +738,5 @@ void MasterBusAudioProcessorEditor::layoutCompContent()
     compContent.addAndMakeVisible(compMixSlider);
     compContent.addAndMakeVisible(compScHpfSlider);
     compContent.addAndMakeVisible(compStereoLinkSlider);
+    compContent.addAndMakeVisible(compLookaheadSlider);
 }
@@ -88,6 +88,15 @@ private:
     juce::ToggleButton postButton { "Post" };
     juce::ComboBox slopeSelector;
 
+    // Spectral match, on the right of the analyzer controls
+    juce::TextButton matchReferenceButton { "Ref" };
+    juce::TextButton matchProgramButton { "Mix" };
+    juce::Slider matchAmountSlider;
+    juce::TextButton matchBandsButton { "Match EQ" };
+    juce::TextButton matchFirButton { "Match FIR" };
+    juce::TextButton matchClearButton { "Clear" };
+    void updateSpectralMatch();
+
     // Meter panel (side)
     MeterPanel meterPanel;
 
@@ -130,12 +139,14 @@ private:
     // Low Shelf
     juce::Slider lsFreqSlider, lsGainSlider;
     juce::ToggleButton lsButton { "LS" };
+    juce::ComboBox lsPlacementBox;
     juce::Label lsFreqLabel { {}, "Freq" };
     juce::Label lsGainLabel { {}, "Gain" };
 
     // High Shelf
     juce::Slider hsFreqSlider, hsGainSlider;
     juce::ToggleButton hsButton { "HS" };
+    juce::ComboBox hsPlacementBox;
     juce::Label hsFreqLabel { {}, "Freq" };
     juce::Label hsGainLabel { {}, "Gain" };
 
@@ -144,21 +155,29 @@ private:
     {
         juce::Slider freqSlider, gainSlider, qSlider;
         juce::ToggleButton enableButton;
+        juce::ComboBox placementBox;
         juce::Label freqLabel { {}, "Freq" };
         juce::Label gainLabel { {}, "Gain" };
         juce::Label qLabel { {}, "Q" };
     };
-    std::array<BandControls, 4> bandControls;
+    std::array<BandControls, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandControls;
+    juce::Viewport bandViewport;
+    juce::Component bandContent; // Band columns, wider than the panel past four bands
 
     // EQ options
     juce::ToggleButton eqLinearPhaseButton { "Linear Phase" };
-    juce::ToggleButton eqMidSideButton { "M/S" };
+    juce::ComboBox eqLinearPhaseLengthBox;
+    juce::ToggleButton eqNaturalPhaseButton { "Natural" };
+    juce::ComboBox eqTopologyBox;
+    juce::ComboBox eqDesignBox;
+    juce::ToggleButton eqAutoGainButton { "Auto Gain" };
     juce::ToggleButton eqBypassButton { "Bypass" };
 
     // Compressor Section controls
     juce::Slider compThresholdSlider, compRatioSlider, compAttackSlider;
     juce::Slider compReleaseSlider, compKneeSlider, compMakeupSlider;
     juce::Slider compMixSlider, compScHpfSlider, compStereoLinkSlider;
+    juce::Slider compLookaheadSlider;
 
     juce::Label compThreshLabel { {}, "Thresh" };
     juce::Label compRatioLabel { {}, "Ratio" };
@@ -169,8 +188,11 @@ private:
     juce::Label compMixLabel { {}, "Mix" };
     juce::Label compScHpfLabel { {}, "SC HPF" };
     juce::Label compLinkLabel { {}, "Link" };
+    juce::Label compLookaheadLabel { {}, "Look-ahead" };
 
     juce::ComboBox compModeBox;
+    juce::ComboBox compBandsBox;
+    juce::ComboBox compOversamplingBox;
     juce::ToggleButton compAutoReleaseButton { "Auto Rel" };
     juce::ToggleButton compScListenButton { "SC Listen" };
     juce::ToggleButton compMidSideButton { "M/S" };
@@ -198,11 +220,13 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lsFreqAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> lsGainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> lsEnabledAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> lsPlacementAttachment;
 
     // High Shelf
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> hsFreqAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> hsGainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> hsEnabledAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> hsPlacementAttachment;
 
     // Bands
     struct BandAttachments
@@ -211,12 +235,17 @@ private:
         std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> gain;
         std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> q;
         std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> enabled;
+        std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> placement;
     };
-    std::array<BandAttachments, 4> bandAttachments;
+    std::array<BandAttachments, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandAttachments;
 
     // EQ Global
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> eqLinearPhaseAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> eqMidSideAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> eqLinearPhaseLengthAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> eqNaturalPhaseAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> eqTopologyAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> eqDesignAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> eqAutoGainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> eqBypassAttachment;
 
     // Compressor
@@ -229,7 +258,10 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> compMixAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> compScHpfAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> compStereoLinkAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> compLookaheadAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> compModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> compBandsAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> compOversamplingAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> compAutoReleaseAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> compScListenAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> compMidSideAttachment;
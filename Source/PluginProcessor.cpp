@@ -29,7 +29,7 @@ MasterBusAudioProcessor::MasterBusAudioProcessor()
     hsEnabled = apvts.getRawParameterValue("hsEnabled");
 
     // Parametric bands
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
     {
         bandFreq[i] = apvts.getRawParameterValue("band" + juce::String(i + 1) + "Freq");
         bandGain[i] = apvts.getRawParameterValue("band" + juce::String(i + 1) + "Gain");
@@ -37,9 +37,35 @@ MasterBusAudioProcessor::MasterBusAudioProcessor()
         bandEnabled[i] = apvts.getRawParameterValue("band" + juce::String(i + 1) + "Enabled");
     }
 
+    // Band dynamics
+    auto getDynamicsParameters = [this](const juce::String& prefix)
+    {
+        DynamicsParameters p;
+        p.enabled = apvts.getRawParameterValue(prefix + "Dynamic");
+        p.threshold = apvts.getRawParameterValue(prefix + "Threshold");
+        p.ratio = apvts.getRawParameterValue(prefix + "Ratio");
+        p.attack = apvts.getRawParameterValue(prefix + "Attack");
+        p.release = apvts.getRawParameterValue(prefix + "Release");
+        return p;
+    };
+    lsDynamics = getDynamicsParameters("ls");
+    hsDynamics = getDynamicsParameters("hs");
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+        bandDynamics[i] = getDynamicsParameters("band" + juce::String(i + 1));
+
+    // Band placement
+    lsPlacement = apvts.getRawParameterValue("lsPlacement");
+    hsPlacement = apvts.getRawParameterValue("hsPlacement");
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+        bandPlacement[i] = apvts.getRawParameterValue("band" + juce::String(i + 1) + "Placement");
+
     // EQ Global
     eqLinearPhase = apvts.getRawParameterValue("eqLinearPhase");
-    eqMidSide = apvts.getRawParameterValue("eqMidSide");
+    eqLinearPhaseLength = apvts.getRawParameterValue("eqLinearPhaseLength");
+    eqNaturalPhase = apvts.getRawParameterValue("eqNaturalPhase");
+    eqTopology = apvts.getRawParameterValue("eqTopology");
+    eqDesign = apvts.getRawParameterValue("eqDesign");
+    eqAutoGain = apvts.getRawParameterValue("eqAutoGain");
     eqBypass = apvts.getRawParameterValue("eqBypass");
 
     // Compressor
@@ -51,19 +77,94 @@ MasterBusAudioProcessor::MasterBusAudioProcessor()
     compMakeup = apvts.getRawParameterValue("compMakeup");
     compMix = apvts.getRawParameterValue("compMix");
     compAutoRelease = apvts.getRawParameterValue("compAutoRelease");
+    compLookahead = apvts.getRawParameterValue("compLookahead");
     compMode = apvts.getRawParameterValue("compMode");
+    compOversampling = apvts.getRawParameterValue("compOversampling");
     compScHpf = apvts.getRawParameterValue("compScHpf");
     compScListen = apvts.getRawParameterValue("compScListen");
     compStereoLink = apvts.getRawParameterValue("compStereoLink");
     compMidSide = apvts.getRawParameterValue("compMidSide");
     compBypass = apvts.getRawParameterValue("compBypass");
 
+    // Compressor multiband mode
+    compBands = apvts.getRawParameterValue("compBands");
+    for (int i = 0; i < MasteringCompressorBase::MAX_CROSSOVERS; ++i)
+        compCrossover[i] = apvts.getRawParameterValue("compCrossover" + juce::String(i + 1));
+    for (int i = 0; i < MasteringCompressorBase::MAX_BANDS; ++i)
+    {
+        const auto prefix = "compBand" + juce::String(i + 1);
+        compBand[i].threshold = apvts.getRawParameterValue(prefix + "Threshold");
+        compBand[i].ratio = apvts.getRawParameterValue(prefix + "Ratio");
+        compBand[i].attack = apvts.getRawParameterValue(prefix + "Attack");
+        compBand[i].release = apvts.getRawParameterValue(prefix + "Release");
+    }
+
     // Global
     outputGain = apvts.getRawParameterValue("outputGain");
     globalBypass = apvts.getRawParameterValue("globalBypass");
+
+    // Map every parameter to the group of setters it feeds
+    for (auto* param : getParameters())
+    {
+        auto* p = dynamic_cast<juce::RangedAudioParameter*>(param);
+        if (p == nullptr) continue;
+
+        const auto id = p->getParameterID();
+        juce::uint32 group = 0;
+        if (id.startsWith("hpf"))       group = DirtyHighPass;
+        else if (id.startsWith("lpf"))  group = DirtyLowPass;
+        else if (id.startsWith("ls"))   group = DirtyLowShelf;
+        else if (id.startsWith("hs"))   group = DirtyHighShelf;
+        else if (id.startsWith("band")) group = DirtyBand1 << (id.substring(4).getIntValue() - 1);
+        else if (id.startsWith("eq"))   group = DirtyEQGlobal;
+        else if (id.startsWith("comp")) group = DirtyCompressor;
+        else if (id == "globalBypass")  group = DirtyEQGlobal | DirtyCompressor;
+
+        // Output gain is read directly every block
+        if (group == 0) continue;
+
+        parameterGroups[id] = group;
+        apvts.addParameterListener(id, this);
+    }
+
+    startTimerHz(30);
+}
+
+MasterBusAudioProcessor::~MasterBusAudioProcessor()
+{
+    stopTimer();
+    for (const auto& entry : parameterGroups)
+        apvts.removeParameterListener(entry.first, this);
 }
 
-MasterBusAudioProcessor::~MasterBusAudioProcessor() {}
+void MasterBusAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    auto it = parameterGroups.find(parameterID);
+    if (it == parameterGroups.end())
+        return;
+
+    dirtyParameters.fetch_or(it->second);
+
+    // Automation can arrive on the audio thread, so this only leaves a flag for the timer
+    if (parameterID == "eqLinearPhase" && newValue > 0.5f)
+        linearPhaseSwitchedOn.store(true, std::memory_order_release);
+}
+
+void MasterBusAudioProcessor::timerCallback()
+{
+    const bool switchedOn = linearPhaseSwitchedOn.exchange(false, std::memory_order_acq_rel);
+    const auto service = [switchedOn] (auto& eq)
+    {
+        if (switchedOn)
+            eq.startLinearPhase(false);
+        eq.wakeKernelDesigner();
+    };
+
+    if (isUsingDoublePrecision())
+        service(doubleChain.eq);
+    else
+        service(floatChain.eq);
+}
 
 juce::AudioProcessorValueTreeState::ParameterLayout MasterBusAudioProcessor::createParameterLayout()
 {
@@ -116,22 +217,22 @@ juce::AudioProcessorValueTreeState::ParameterLayout MasterBusAudioProcessor::cre
         juce::ParameterID("hsEnabled", 1), "High Shelf Enabled", true));
 
     // === Parametric Bands ===
-    struct BandDefaults { float freq; const char* name; };
-    BandDefaults bandDefaults[4] = {
-        { 80.0f, "Low" },
-        { 300.0f, "Low-Mid" },
-        { 1000.0f, "Mid" },
-        { 4000.0f, "High-Mid" }
+    // The standard four bands keep their names; other builds number them
+    auto getBandName = [](int band)
+    {
+        const char* standardNames[] = { "Low", "Low-Mid", "Mid", "High-Mid" };
+        return MasteringEQBase::NUM_PARAMETRIC_BANDS == 4 ? juce::String(standardNames[band])
+                                                      : "Band " + juce::String(band + 1);
     };
 
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
     {
         juce::String prefix = "band" + juce::String(i + 1);
-        juce::String bandName = bandDefaults[i].name;
+        juce::String bandName = getBandName(i);
 
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID(prefix + "Freq", 1), bandName + " Freq",
-            juce::NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.3f), bandDefaults[i].freq,
+            juce::NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.3f), MasteringEQBase::getDefaultBandFrequency(i),
             juce::AudioParameterFloatAttributes().withLabel("Hz")));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID(prefix + "Gain", 1), bandName + " Gain",
@@ -144,11 +245,64 @@ juce::AudioProcessorValueTreeState::ParameterLayout MasterBusAudioProcessor::cre
             juce::ParameterID(prefix + "Enabled", 1), bandName + " Enabled", true));
     }
 
+    // === EQ Band Dynamics ===
+    auto addDynamicsParameters = [&params](const juce::String& prefix, const juce::String& bandName)
+    {
+        params.push_back(std::make_unique<juce::AudioParameterBool>(
+            juce::ParameterID(prefix + "Dynamic", 1), bandName + " Dynamic", false));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Threshold", 1), bandName + " Threshold",
+            juce::NormalisableRange<float>(-60.0f, 0.0f, 0.1f), -20.0f,
+            juce::AudioParameterFloatAttributes().withLabel("dB")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Ratio", 1), bandName + " Ratio",
+            juce::NormalisableRange<float>(1.0f, 10.0f, 0.1f, 0.5f), 2.0f,
+            juce::AudioParameterFloatAttributes().withLabel(":1")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Attack", 1), bandName + " Attack",
+            juce::NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.4f), 5.0f,
+            juce::AudioParameterFloatAttributes().withLabel("ms")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Release", 1), bandName + " Release",
+            juce::NormalisableRange<float>(10.0f, 2000.0f, 1.0f, 0.4f), 100.0f,
+            juce::AudioParameterFloatAttributes().withLabel("ms")));
+    };
+
+    addDynamicsParameters("ls", "Low Shelf");
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+        addDynamicsParameters("band" + juce::String(i + 1), getBandName(i));
+    addDynamicsParameters("hs", "High Shelf");
+
+    // === EQ Band Placement ===
+    // Which channels each band works on; mid and side bands run after the others
+    auto addPlacementParameter = [&params](const juce::String& prefix, const juce::String& bandName)
+    {
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID(prefix + "Placement", 1), bandName + " Placement",
+            juce::StringArray{ "Stereo", "Left", "Right", "Mid", "Side" }, 0));
+    };
+
+    addPlacementParameter("ls", "Low Shelf");
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+        addPlacementParameter("band" + juce::String(i + 1), getBandName(i));
+    addPlacementParameter("hs", "High Shelf");
+
     // === EQ Global ===
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         juce::ParameterID("eqLinearPhase", 1), "EQ Linear Phase", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("eqLinearPhaseLength", 1), "EQ Linear Phase Length",
+        juce::StringArray{ "4k", "8k", "16k", "32k", "64k" }, 2));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID("eqNaturalPhase", 1), "EQ Natural Phase", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("eqTopology", 1), "EQ Filter Topology",
+        juce::StringArray{ "Biquad", "SVF" }, 0));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("eqDesign", 1), "EQ Coefficient Design",
+        juce::StringArray{ "Bilinear", "Matched" }, 0));
     params.push_back(std::make_unique<juce::AudioParameterBool>(
-        juce::ParameterID("eqMidSide", 1), "EQ Mid/Side", false));
+        juce::ParameterID("eqAutoGain", 1), "EQ Auto Gain", false));
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         juce::ParameterID("eqBypass", 1), "EQ Bypass", false));
 
@@ -183,9 +337,16 @@ juce::AudioProcessorValueTreeState::ParameterLayout MasterBusAudioProcessor::cre
         juce::AudioParameterFloatAttributes().withLabel("%")));
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         juce::ParameterID("compAutoRelease", 1), "Comp Auto Release", false));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("compLookahead", 1), "Comp Look-ahead",
+        juce::NormalisableRange<float>(0.0f, 10.0f, 0.1f), 0.0f,
+        juce::AudioParameterFloatAttributes().withLabel("ms")));
     params.push_back(std::make_unique<juce::AudioParameterChoice>(
         juce::ParameterID("compMode", 1), "Comp Mode",
         juce::StringArray{ "Clean", "Glue", "Punch", "Vintage" }, 0));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("compOversampling", 1), "Comp Oversampling",
+        juce::StringArray{ "1x", "2x", "4x", "8x" }, 0));
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         juce::ParameterID("compScHpf", 1), "Comp SC HPF",
         juce::NormalisableRange<float>(20.0f, 300.0f, 1.0f, 0.4f), 60.0f,
@@ -201,6 +362,43 @@ juce::AudioProcessorValueTreeState::ParameterLayout MasterBusAudioProcessor::cre
     params.push_back(std::make_unique<juce::AudioParameterBool>(
         juce::ParameterID("compBypass", 1), "Comp Bypass", false));
 
+    // === Compressor Multiband ===
+    // Knee, makeup, mix, link, mode, look-ahead and the sidechain filter are shared with wideband
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("compBands", 1), "Comp Bands",
+        juce::StringArray{ "Wideband", "3 Bands", "4 Bands", "5 Bands" }, 0));
+
+    for (int i = 0; i < MasteringCompressorBase::MAX_CROSSOVERS; ++i)
+    {
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID("compCrossover" + juce::String(i + 1), 1), "Comp Crossover " + juce::String(i + 1),
+            juce::NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.25f),
+            MasteringCompressorBase::getDefaultCrossoverFrequency(i),
+            juce::AudioParameterFloatAttributes().withLabel("Hz")));
+    }
+
+    for (int i = 0; i < MasteringCompressorBase::MAX_BANDS; ++i)
+    {
+        const auto prefix = "compBand" + juce::String(i + 1);
+        const auto bandName = "Comp Band " + juce::String(i + 1);
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Threshold", 1), bandName + " Threshold",
+            juce::NormalisableRange<float>(-40.0f, 0.0f, 0.1f), -20.0f,
+            juce::AudioParameterFloatAttributes().withLabel("dB")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Ratio", 1), bandName + " Ratio",
+            juce::NormalisableRange<float>(1.0f, 10.0f, 0.1f, 0.5f), 2.0f,
+            juce::AudioParameterFloatAttributes().withLabel(":1")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Attack", 1), bandName + " Attack",
+            juce::NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.4f), 10.0f,
+            juce::AudioParameterFloatAttributes().withLabel("ms")));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID(prefix + "Release", 1), bandName + " Release",
+            juce::NormalisableRange<float>(50.0f, 2000.0f, 1.0f, 0.4f), 200.0f,
+            juce::AudioParameterFloatAttributes().withLabel("ms")));
+    }
+
     // === Global ===
     params.push_back(std::make_unique<juce::AudioParameterFloat>(
         juce::ParameterID("outputGain", 1), "Output Gain",
@@ -217,6 +415,7 @@ bool MasterBusAudioProcessor::acceptsMidi() const { return false; }
 bool MasterBusAudioProcessor::producesMidi() const { return false; }
 bool MasterBusAudioProcessor::isMidiEffect() const { return false; }
 double MasterBusAudioProcessor::getTailLengthSeconds() const { return 0.0; }
+bool MasterBusAudioProcessor::supportsDoublePrecisionProcessing() const { return true; }
 int MasterBusAudioProcessor::getNumPrograms() { return 1; }
 int MasterBusAudioProcessor::getCurrentProgram() { return 0; }
 void MasterBusAudioProcessor::setCurrentProgram(int index) { juce::ignoreUnused(index); }
@@ -225,35 +424,90 @@ void MasterBusAudioProcessor::changeProgramName(int index, const juce::String& n
 
 void MasterBusAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    eq.prepare(sampleRate, samplesPerBlock);
-    compressor.prepare(sampleRate, samplesPerBlock);
+    const int numChannels = getTotalNumInputChannels();
     loudnessMeter.prepare(sampleRate, samplesPerBlock);
+    spectralMatch.prepare(sampleRate);
+
+    preEQBuffer.setSize(numChannels, samplesPerBlock);
+    postProcessBuffer.setSize(numChannels, samplesPerBlock);
+
+    // The host sets the precision before preparing, so only that chain needs to be ready
+    const auto prepareChain = [&] (auto& chain)
+    {
+        chain.eq.prepare(sampleRate, samplesPerBlock, numChannels);
+        chain.compressor.prepare(sampleRate, samplesPerBlock, numChannels);
 
-    preEQBuffer.setSize(2, samplesPerBlock);
-    postProcessBuffer.setSize(2, samplesPerBlock);
+        matchCurves.update();
+        chain.eq.setMatchCurve(matchCurves.getReadBuffer());
+
+        // Push every parameter before the first block
+        dirtyParameters.store(DirtyAll);
+        updateEQParameters(chain.eq, dirtyParameters.exchange(0));
+        updateCompressorParameters(chain.compressor);
+
+        // Linear phase is only set up once it's used
+        if (chain.eq.isLinearPhase())
+            chain.eq.startLinearPhase(true);
+
+        setLatencySamples(chain.eq.getLatencySamples() + chain.compressor.getLatencySamples());
+    };
+
+    if (isUsingDoublePrecision())
+        prepareChain(doubleChain);
+    else
+        prepareChain(floatChain);
 }
 
 void MasterBusAudioProcessor::releaseResources()
 {
-    eq.reset();
-    compressor.reset();
+    floatChain.eq.reset();
+    floatChain.compressor.reset();
+    doubleChain.eq.reset();
+    doubleChain.compressor.reset();
     loudnessMeter.reset();
 }
 
 bool MasterBusAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout from mono up to a 9.1.6 bed, as long as input and output match
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.isDisabled() || mainOutput.size() > std::min(MasteringEQBase::MAX_CHANNELS, MasteringCompressorBase::MAX_CHANNELS))
         return false;
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    if (mainOutput != layouts.getMainInputChannelSet())
         return false;
     return true;
 }
 
+const MasteringEQBase::MagnitudeResponse& MasterBusAudioProcessor::getEQResponse()
+{
+    return isUsingDoublePrecision() ? doubleChain.eq.getMagnitudeResponse()
+                                    : floatChain.eq.getMagnitudeResponse();
+}
+
+float MasterBusAudioProcessor::getGainReduction() const
+{
+    return isUsingDoublePrecision() ? doubleChain.compressor.getGainReduction()
+                                    : floatChain.compressor.getGainReduction();
+}
+
 void MasterBusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused(midiMessages);
+    process(buffer, floatChain);
+}
+
+void MasterBusAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused(midiMessages);
+    process(buffer, doubleChain);
+}
+
+template <typename SampleType>
+void MasterBusAudioProcessor::process(juce::AudioBuffer<SampleType>& buffer, ProcessingChain<SampleType>& chain)
+{
     juce::ScopedNoDenormals noDenormals;
+    auto& eq = chain.eq;
+    auto& compressor = chain.compressor;
 
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -261,55 +515,118 @@ void MasterBusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    // Global bypass
-    if (globalBypass->load() > 0.5f)
-    {
-        loudnessMeter.process(buffer);
-        return;
-    }
-
     // Measure input level
     float inLevel = 0.0f;
     for (int ch = 0; ch < totalNumInputChannels; ++ch)
-        inLevel = std::max(inLevel, buffer.getMagnitude(ch, 0, buffer.getNumSamples()));
-    inputLevel.store(DSPUtils::linearToDecibels(inLevel));
+        inLevel = std::max(inLevel, static_cast<float>(buffer.getMagnitude(ch, 0, buffer.getNumSamples())));
+    inputLevel.store(DSPUtils::fastLinearToDecibels(inLevel));
 
     // Store pre-EQ buffer for spectrum analyzer
     preEQBuffer.makeCopyOf(buffer);
+    spectralMatch.pushSamples(preEQBuffer);
 
-    // Update EQ parameters
-    eq.setHighPassFrequency(hpfFreq->load());
-    eq.setHighPassSlope((static_cast<int>(hpfSlope->load()) + 1) * 6);
-    eq.setHighPassEnabled(hpfEnabled->load() > 0.5f);
+    // Update only the parameter groups that changed since the last block
+    const auto dirty = dirtyParameters.exchange(0);
+    updateEQParameters(eq, dirty);
 
-    eq.setLowPassFrequency(lpfFreq->load());
-    eq.setLowPassSlope((static_cast<int>(lpfSlope->load()) + 1) * 6);
-    eq.setLowPassEnabled(lpfEnabled->load() > 0.5f);
+    if (matchCurves.update())
+        eq.setMatchCurve(matchCurves.getReadBuffer());
 
-    eq.setLowShelfFrequency(lsFreq->load());
-    eq.setLowShelfGain(lsGain->load());
-    eq.setLowShelfEnabled(lsEnabled->load() > 0.5f);
+    if (dirty & DirtyCompressor)
+        updateCompressorParameters(compressor);
 
-    eq.setHighShelfFrequency(hsFreq->load());
-    eq.setHighShelfGain(hsGain->load());
-    eq.setHighShelfEnabled(hsEnabled->load() > 0.5f);
+    // Process EQ
+    eq.process(buffer);
+
+    // Process compressor
+    compressor.process(buffer);
+
+    // Linear phase mode and the compressor's look-ahead delay the signal; keep the host's
+    // compensation in sync. Read after processing, as the EQ moves to a new kernel's latency
+    // partway through a block.
+    const int latency = eq.getLatencySamples() + compressor.getLatencySamples();
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+
+    // Apply output gain. Global bypass goes through the EQ's and compressor's own bypass, which
+    // keep the latency the same, so this is all it has left to skip.
+    if (globalBypass->load() <= 0.5f)
+        buffer.applyGain(DSPUtils::decibelsToLinear(outputGain->load()));
+
+    // Store post-process buffer for spectrum analyzer
+    postProcessBuffer.makeCopyOf(buffer);
+
+    // Update loudness metering
+    loudnessMeter.process(postProcessBuffer);
+
+    // Measure output level
+    float outLevel = 0.0f;
+    for (int ch = 0; ch < totalNumInputChannels; ++ch)
+        outLevel = std::max(outLevel, static_cast<float>(buffer.getMagnitude(ch, 0, buffer.getNumSamples())));
+    outputLevel.store(DSPUtils::fastLinearToDecibels(outLevel));
+}
 
-    for (int i = 0; i < 4; ++i)
+template <typename SampleType>
+void MasterBusAudioProcessor::updateEQParameters(MasteringEQ<SampleType>& eq, juce::uint32 dirty)
+{
+    if (dirty & DirtyHighPass)
     {
-        eq.setBandFrequency(i, bandFreq[i]->load());
-        eq.setBandGain(i, bandGain[i]->load());
-        eq.setBandQ(i, bandQ[i]->load());
-        eq.setBandEnabled(i, bandEnabled[i]->load() > 0.5f);
+        eq.setHighPass(hpfFreq->load(), (static_cast<int>(hpfSlope->load()) + 1) * 6);
+        eq.setHighPassEnabled(hpfEnabled->load() > 0.5f);
     }
 
-    eq.setLinearPhase(eqLinearPhase->load() > 0.5f);
-    eq.setMidSideMode(eqMidSide->load() > 0.5f);
-    eq.setBypass(eqBypass->load() > 0.5f);
+    if (dirty & DirtyLowPass)
+    {
+        eq.setLowPass(lpfFreq->load(), (static_cast<int>(lpfSlope->load()) + 1) * 6);
+        eq.setLowPassEnabled(lpfEnabled->load() > 0.5f);
+    }
 
-    // Process EQ
-    eq.process(buffer);
+    if (dirty & DirtyLowShelf)
+    {
+        eq.setLowShelf(lsFreq->load(), lsGain->load());
+        eq.setLowShelfEnabled(lsEnabled->load() > 0.5f);
+        eq.setLowShelfDynamics(lsDynamics.enabled->load() > 0.5f, lsDynamics.threshold->load(), lsDynamics.ratio->load(),
+                               lsDynamics.attack->load(), lsDynamics.release->load());
+        eq.setLowShelfPlacement(static_cast<MasteringEQBase::Placement>(static_cast<int>(lsPlacement->load())));
+    }
+
+    if (dirty & DirtyHighShelf)
+    {
+        eq.setHighShelf(hsFreq->load(), hsGain->load());
+        eq.setHighShelfEnabled(hsEnabled->load() > 0.5f);
+        eq.setHighShelfDynamics(hsDynamics.enabled->load() > 0.5f, hsDynamics.threshold->load(), hsDynamics.ratio->load(),
+                                hsDynamics.attack->load(), hsDynamics.release->load());
+        eq.setHighShelfPlacement(static_cast<MasteringEQBase::Placement>(static_cast<int>(hsPlacement->load())));
+    }
+
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+    {
+        if (dirty & (DirtyBand1 << i))
+        {
+            const auto& dynamics = bandDynamics[i];
+            eq.setBand(i, bandFreq[i]->load(), bandGain[i]->load(), bandQ[i]->load());
+            eq.setBandEnabled(i, bandEnabled[i]->load() > 0.5f);
+            eq.setBandDynamics(i, dynamics.enabled->load() > 0.5f, dynamics.threshold->load(), dynamics.ratio->load(),
+                               dynamics.attack->load(), dynamics.release->load());
+            eq.setBandPlacement(i, static_cast<MasteringEQBase::Placement>(static_cast<int>(bandPlacement[i]->load())));
+        }
+    }
+
+    if (dirty & DirtyEQGlobal)
+    {
+        eq.setLinearPhase(eqLinearPhase->load() > 0.5f);
+        eq.setLinearPhaseLength(4096 << static_cast<int>(eqLinearPhaseLength->load()));
+        eq.setNaturalPhase(eqNaturalPhase->load() > 0.5f);
+        eq.setFilterTopology(static_cast<MasteringEQBase::FilterTopology>(static_cast<int>(eqTopology->load())));
+        eq.setCoefficientDesign(static_cast<MasteringEQBase::CoefficientDesign>(static_cast<int>(eqDesign->load())));
+        eq.setAutoGain(eqAutoGain->load() > 0.5f);
+        eq.setBypass(eqBypass->load() > 0.5f || globalBypass->load() > 0.5f);
+    }
+}
 
-    // Update compressor parameters
+template <typename SampleType>
+void MasterBusAudioProcessor::updateCompressorParameters(MasteringCompressor<SampleType>& compressor)
+{
     compressor.setThreshold(compThreshold->load());
     compressor.setRatio(compRatio->load());
     compressor.setAttack(compAttack->load());
@@ -318,31 +635,22 @@ void MasterBusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
     compressor.setMakeupGain(compMakeup->load());
     compressor.setMix(compMix->load());
     compressor.setAutoRelease(compAutoRelease->load() > 0.5f);
-    compressor.setMode(static_cast<MasteringCompressor::Mode>(static_cast<int>(compMode->load())));
+    compressor.setLookahead(compLookahead->load());
+    compressor.setMode(static_cast<MasteringCompressorBase::Mode>(static_cast<int>(compMode->load())));
+    compressor.setOversampling(1 << static_cast<int>(compOversampling->load()));
     compressor.setSidechainHPF(compScHpf->load());
     compressor.setSidechainListen(compScListen->load() > 0.5f);
     compressor.setStereoLink(compStereoLink->load());
     compressor.setMidSideMode(compMidSide->load() > 0.5f);
-    compressor.setBypass(compBypass->load() > 0.5f);
-
-    // Process compressor
-    compressor.process(buffer);
-
-    // Apply output gain
-    float outGain = DSPUtils::decibelsToLinear(outputGain->load());
-    buffer.applyGain(outGain);
-
-    // Store post-process buffer for spectrum analyzer
-    postProcessBuffer.makeCopyOf(buffer);
-
-    // Update loudness metering
-    loudnessMeter.process(buffer);
-
-    // Measure output level
-    float outLevel = 0.0f;
-    for (int ch = 0; ch < totalNumInputChannels; ++ch)
-        outLevel = std::max(outLevel, buffer.getMagnitude(ch, 0, buffer.getNumSamples()));
-    outputLevel.store(DSPUtils::linearToDecibels(outLevel));
+    compressor.setBypass(compBypass->load() > 0.5f || globalBypass->load() > 0.5f);
+
+    const auto bandsIndex = static_cast<int>(compBands->load());
+    compressor.setNumBands(bandsIndex == 0 ? 1 : bandsIndex + 2);
+    for (int i = 0; i < MasteringCompressorBase::MAX_CROSSOVERS; ++i)
+        compressor.setCrossover(i, compCrossover[i]->load());
+    for (int i = 0; i < MasteringCompressorBase::MAX_BANDS; ++i)
+        compressor.setBand(i, compBand[i].threshold->load(), compBand[i].ratio->load(),
+                           compBand[i].attack->load(), compBand[i].release->load());
 }
 
 void MasterBusAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
@@ -356,7 +664,96 @@ void MasterBusAudioProcessor::setStateInformation(const void* data, int sizeInBy
 {
     std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
     if (xml != nullptr && xml->hasTagName(apvts.state.getType()))
+    {
         apvts.replaceState(juce::ValueTree::fromXml(*xml));
+        restoreMatchCurve();
+    }
+}
+
+//==============================================================================
+// Spectral match
+//==============================================================================
+namespace
+{
+    const juce::Identifier matchCurveProperty { "matchCurve" };
+}
+
+void MasterBusAudioProcessor::applySpectralMatch(const SpectralMatch::Fit& fit)
+{
+    const auto setParameter = [this] (const juce::String& id, float value)
+    {
+        auto* parameter = apvts.getParameter(id);
+        parameter->beginChangeGesture();
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        parameter->endChangeGesture();
+    };
+
+    // The correction is worked out against the program before the EQ, so it replaces the
+    // bands rather than adding to them. A linear phase match leaves them set up but switched off.
+    const bool toBands = fit.target == SpectralMatch::Target::Bands;
+    const auto setBand = [&] (const juce::String& prefix, const SpectralMatch::BandSettings& settings, bool hasQ)
+    {
+        if (toBands)
+        {
+            setParameter(prefix + "Freq", settings.frequency);
+            setParameter(prefix + "Gain", settings.gainDb);
+            if (hasQ)
+                setParameter(prefix + "Q", settings.q);
+            setParameter(prefix + "Dynamic", 0.0f);
+            setParameter(prefix + "Placement", 0.0f);
+        }
+        setParameter(prefix + "Enabled", toBands ? 1.0f : 0.0f);
+    };
+
+    setBand("ls", fit.lowShelf, false);
+    setBand("hs", fit.highShelf, false);
+    for (int i = 0; i < MasteringEQBase::NUM_PARAMETRIC_BANDS; ++i)
+        setBand("band" + juce::String(i + 1), fit.bands[i], true);
+
+    if (toBands)
+    {
+        clearMatchCurve();
+    }
+    else
+    {
+        setMatchCurve(fit.correction);
+        setParameter("eqLinearPhase", 1.0f);
+    }
+}
+
+void MasterBusAudioProcessor::clearMatchCurve()
+{
+    setMatchCurve({});
+}
+
+void MasterBusAudioProcessor::setMatchCurve(const MasteringEQBase::MatchCurve& curveDb)
+{
+    matchCurves.getWriteBuffer() = curveDb;
+    matchCurves.publish();
+
+    if (std::all_of(curveDb.begin(), curveDb.end(), [] (float db) { return db == 0.0f; }))
+    {
+        apvts.state.removeProperty(matchCurveProperty, nullptr);
+        return;
+    }
+
+    juce::StringArray values;
+    for (float db : curveDb)
+        values.add(juce::String(db, 2));
+    apvts.state.setProperty(matchCurveProperty, values.joinIntoString(","), nullptr);
+}
+
+void MasterBusAudioProcessor::restoreMatchCurve()
+{
+    juce::StringArray values;
+    values.addTokens(apvts.state.getProperty(matchCurveProperty).toString(), ",", {});
+
+    MasteringEQBase::MatchCurve curveDb {};
+    if (values.size() == MasteringEQBase::RESPONSE_POINTS)
+        for (int i = 0; i < MasteringEQBase::RESPONSE_POINTS; ++i)
+            curveDb[i] = values[i].getFloatValue();
+
+    setMatchCurve(curveDb);
 }
 
 void MasterBusAudioProcessor::storeSettings(int slot)
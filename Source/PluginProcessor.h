@@ -4,8 +4,11 @@
 #include "DSP/MasteringEQ.h"
 #include "DSP/MasteringCompressor.h"
 #include "DSP/LoudnessMeter.h"
+#include "DSP/SpectralMatch.h"
 
-class MasterBusAudioProcessor : public juce::AudioProcessor
+class MasterBusAudioProcessor : public juce::AudioProcessor,
+                                private juce::AudioProcessorValueTreeState::Listener,
+                                private juce::Timer
 {
 public:
     MasterBusAudioProcessor();
@@ -16,8 +19,10 @@ public:
 
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 
+    // Both precisions run the same chain, each through its own instance of the DSP
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-    using AudioProcessor::processBlock;
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -41,19 +46,28 @@ public:
     juce::AudioProcessorValueTreeState& getAPVTS() { return apvts; }
 
     // DSP access for editor
-    MasteringEQ& getEQ() { return eq; }
-    MasteringCompressor& getCompressor() { return compressor; }
     LoudnessMeter& getLoudnessMeter() { return loudnessMeter; }
 
     // Metering access
     float getInputLevel() const { return inputLevel.load(); }
     float getOutputLevel() const { return outputLevel.load(); }
-    float getGainReduction() const { return compressor.getGainReduction(); }
+    float getGainReduction() const;
 
     // For spectrum analyzer
     const juce::AudioBuffer<float>& getPreEQBuffer() const { return preEQBuffer; }
     const juce::AudioBuffer<float>& getPostProcessBuffer() const { return postProcessBuffer; }
 
+    // The EQ's response in dB at MasteringEQBase::getResponseFrequency(), one curve per band
+    // placement, from the chain the host is running. The editor draws it over the analyser.
+    // Message thread only.
+    const MasteringEQBase::MagnitudeResponse& getEQResponse();
+
+    // Spectral match EQ. The editor runs the captures and asks for fits; applying one sets the
+    // shelves and bands, or hands the curve to the linear phase EQ. Message thread only.
+    SpectralMatch& getSpectralMatch() { return spectralMatch; }
+    void applySpectralMatch(const SpectralMatch::Fit& fit);
+    void clearMatchCurve();
+
     // A/B/C/D comparison
     void storeSettings(int slot);
     void recallSettings(int slot);
@@ -63,10 +77,58 @@ private:
     juce::AudioProcessorValueTreeState apvts;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+    // Parameter change tracking. Each group of parameters that feeds one set of DSP setters
+    // gets a bit; the listener sets it and processBlock only pushes the dirty groups.
+    enum DirtyFlags : juce::uint32
+    {
+        DirtyHighPass   = 1 << 0,
+        DirtyLowPass    = 1 << 1,
+        DirtyLowShelf   = 1 << 2,
+        DirtyHighShelf  = 1 << 3,
+        DirtyEQGlobal   = 1 << 4,
+        DirtyCompressor = 1 << 5,
+        DirtyBand1      = 1 << 6,   // The other parametric bands follow on
+        DirtyAll        = (1u << (6 + MasteringEQBase::NUM_PARAMETRIC_BANDS)) - 1
+    };
+
+    // DSP for one sample type. Only the chain for the precision the host asked for is
+    // prepared and kept up to date with the parameters.
+    template <typename SampleType>
+    struct ProcessingChain
+    {
+        MasteringEQ<SampleType> eq;
+        MasteringCompressor<SampleType> compressor;
+    };
+
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, ProcessingChain<SampleType>& chain);
+
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    // Message thread. Sets up linear phase switched on with the audio running, and wakes the
+    // EQ's kernel designer when the audio thread has asked for a kernel. The audio thread only
+    // sets flags, so it never posts a message or signals a thread.
+    void timerCallback() override;
+
+    template <typename SampleType>
+    void updateEQParameters(MasteringEQ<SampleType>& eq, juce::uint32 dirty);
+    template <typename SampleType>
+    void updateCompressorParameters(MasteringCompressor<SampleType>& compressor);
+
+    // Kept in the state tree so it's saved with the session
+    void setMatchCurve(const MasteringEQBase::MatchCurve& curveDb);
+    void restoreMatchCurve();
+
+    std::map<juce::String, juce::uint32> parameterGroups;
+    std::atomic<juce::uint32> dirtyParameters { DirtyAll };
+    std::atomic<bool> linearPhaseSwitchedOn { false };   // Picked up by timerCallback()
+
     // DSP
-    MasteringEQ eq;
-    MasteringCompressor compressor;
+    ProcessingChain<float> floatChain;
+    ProcessingChain<double> doubleChain;
     LoudnessMeter loudnessMeter;
+    SpectralMatch spectralMatch;
+    DSPUtils::TripleBuffer<MasteringEQBase::MatchCurve> matchCurves;   // Message thread to audio thread
 
     // Parameter pointers
     // EQ HPF
@@ -90,14 +152,35 @@ private:
     std::atomic<float>* hsEnabled = nullptr;
 
     // EQ Parametric Bands
-    std::array<std::atomic<float>*, 4> bandFreq;
-    std::array<std::atomic<float>*, 4> bandGain;
-    std::array<std::atomic<float>*, 4> bandQ;
-    std::array<std::atomic<float>*, 4> bandEnabled;
+    std::array<std::atomic<float>*, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandFreq;
+    std::array<std::atomic<float>*, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandGain;
+    std::array<std::atomic<float>*, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandQ;
+    std::array<std::atomic<float>*, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandEnabled;
+
+    // EQ band dynamics (low shelf, parametric bands, high shelf)
+    struct DynamicsParameters
+    {
+        std::atomic<float>* enabled = nullptr;
+        std::atomic<float>* threshold = nullptr;
+        std::atomic<float>* ratio = nullptr;
+        std::atomic<float>* attack = nullptr;
+        std::atomic<float>* release = nullptr;
+    };
+    DynamicsParameters lsDynamics, hsDynamics;
+    std::array<DynamicsParameters, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandDynamics;
+
+    // EQ band placement (MasteringEQBase::Placement)
+    std::atomic<float>* lsPlacement = nullptr;
+    std::atomic<float>* hsPlacement = nullptr;
+    std::array<std::atomic<float>*, MasteringEQBase::NUM_PARAMETRIC_BANDS> bandPlacement;
 
     // EQ Global
     std::atomic<float>* eqLinearPhase = nullptr;
-    std::atomic<float>* eqMidSide = nullptr;
+    std::atomic<float>* eqLinearPhaseLength = nullptr;
+    std::atomic<float>* eqNaturalPhase = nullptr;
+    std::atomic<float>* eqTopology = nullptr;
+    std::atomic<float>* eqDesign = nullptr;
+    std::atomic<float>* eqAutoGain = nullptr;
     std::atomic<float>* eqBypass = nullptr;
 
     // Compressor
@@ -109,13 +192,27 @@ private:
     std::atomic<float>* compMakeup = nullptr;
     std::atomic<float>* compMix = nullptr;
     std::atomic<float>* compAutoRelease = nullptr;
+    std::atomic<float>* compLookahead = nullptr;
     std::atomic<float>* compMode = nullptr;
+    std::atomic<float>* compOversampling = nullptr;
     std::atomic<float>* compScHpf = nullptr;
     std::atomic<float>* compScListen = nullptr;
     std::atomic<float>* compStereoLink = nullptr;
     std::atomic<float>* compMidSide = nullptr;
     std::atomic<float>* compBypass = nullptr;
 
+    // Compressor multiband mode
+    struct CompressorBandParameters
+    {
+        std::atomic<float>* threshold = nullptr;
+        std::atomic<float>* ratio = nullptr;
+        std::atomic<float>* attack = nullptr;
+        std::atomic<float>* release = nullptr;
+    };
+    std::atomic<float>* compBands = nullptr;
+    std::array<std::atomic<float>*, MasteringCompressorBase::MAX_CROSSOVERS> compCrossover;
+    std::array<CompressorBandParameters, MasteringCompressorBase::MAX_BANDS> compBand;
+
     // Global
     std::atomic<float>* outputGain = nullptr;
     std::atomic<float>* globalBypass = nullptr;
@@ -124,7 +221,8 @@ private:
     std::atomic<float> inputLevel { 0.0f };
     std::atomic<float> outputLevel { 0.0f };
 
-    // Buffers for spectrum analyzer
+    // Buffers for spectrum analyzer. Always float; the loudness meter reads the post-process
+    // copy, so it sees the same samples at either precision.
     juce::AudioBuffer<float> preEQBuffer;
     juce::AudioBuffer<float> postProcessBuffer;
 
@@ -117,23 +117,17 @@ void SpectrumAnalyzer::processFFT(const std::vector<float>& buffer, std::array<f
     // Perform FFT
     fft.performFrequencyOnlyForwardTransform(fftData.data());
 
-    // Convert to dB and apply slope compensation
-    float referenceFreq = 1000.0f;
-
+    // Convert to dB in one pass over the bins
     for (int i = 0; i < NUM_BINS; ++i)
-    {
-        float magnitude = fftData[i];
-        float db = DSPUtils::linearToDecibels(magnitude / static_cast<float>(FFT_SIZE));
+        fftData[i] /= static_cast<float>(FFT_SIZE);
+    DSPUtils::fastLinearToDecibels(fftData.data(), mags.data(), NUM_BINS);
 
-        // Apply slope compensation
-        if (slopeDbPerOctave > 0.0f && i > 0)
-        {
-            float freq = getFrequencyForBin(i);
-            float octaves = std::log2(freq / referenceFreq);
-            db += octaves * slopeDbPerOctave;
-        }
-
-        mags[i] = db;
+    // Apply slope compensation
+    if (slopeDbPerOctave > 0.0f)
+    {
+        float referenceFreq = 1000.0f;
+        for (int i = 1; i < NUM_BINS; ++i)
+            mags[i] += DSPUtils::fastLog2(getFrequencyForBin(i) / referenceFreq) * slopeDbPerOctave;
     }
 }
 
@@ -209,6 +203,62 @@ void SpectrumAnalyzer::paint(juce::Graphics& g)
     {
         drawSpectrum(g, smoothedMagnitudes, juce::Colour(0xff00d4ff), 1.0f, true);
     }
+
+    drawEQCurve(g);
+}
+
+void SpectrumAnalyzer::drawEQCurve(juce::Graphics& g)
+{
+    using Placement = MasteringEQBase::Placement;
+
+    auto analyzerBounds = getAnalyzerBounds();
+    const float centreY = analyzerBounds.getCentreY();
+    const float pixelsPerDb = analyzerBounds.getHeight() * 0.5f / eqRangeDb;
+
+    const auto makePath = [&] (const std::array<float, MasteringEQBase::RESPONSE_POINTS>& curve)
+    {
+        juce::Path path;
+        for (int i = 0; i < MasteringEQBase::RESPONSE_POINTS; ++i)
+        {
+            float x = getXForFrequency(MasteringEQBase::getResponseFrequency(i));
+            float y = centreY - std::clamp(curve[i], -eqRangeDb, eqRangeDb) * pixelsPerDb;
+
+            if (i == 0)
+                path.startNewSubPath(x, y);
+            else
+                path.lineTo(x, y);
+        }
+        return path;
+    };
+
+    // Placed bands only act on part of the bus, so each placement in use gets its own thinner
+    // curve (the stereo curve plus its bands) and a key in the corner
+    static const std::array<juce::Colour, MasteringEQBase::NUM_PLACEMENTS> placementColours {
+        MasterBusLookAndFeel::Colors::eqAccent, MasterBusLookAndFeel::Colors::accent,
+        MasterBusLookAndFeel::Colors::compAccent, MasterBusLookAndFeel::Colors::meterYellow,
+        juce::Colour(0xffc77dff)
+    };
+    static const std::array<const char*, MasteringEQBase::NUM_PLACEMENTS> placementNames {
+        "Stereo", "Left", "Right", "Mid", "Side"
+    };
+
+    auto keyArea = analyzerBounds.reduced(6.0f).removeFromTop(12.0f);
+    g.setFont(juce::Font(juce::FontOptions(10.0f)));
+
+    for (int placement = MasteringEQBase::NUM_PLACEMENTS - 1; placement > static_cast<int>(Placement::Stereo); --placement)
+    {
+        if (!eqResponse.inUse[placement])
+            continue;
+
+        g.setColour(placementColours[placement].withAlpha(0.8f));
+        g.strokePath(makePath(eqResponse.curves[placement]),
+                     juce::PathStrokeType(1.25f, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+        g.drawText(placementNames[placement], keyArea.removeFromRight(36.0f), juce::Justification::centredRight);
+    }
+
+    g.setColour(placementColours[0].withAlpha(0.9f));
+    g.strokePath(makePath(eqResponse.curves[static_cast<int>(Placement::Stereo)]),
+                 juce::PathStrokeType(2.0f, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
 }
 
 void SpectrumAnalyzer::drawSpectrum(juce::Graphics& g, const std::array<float, NUM_BINS>& mags,
@@ -419,6 +469,11 @@ void SpectrumAnalyzer::resized()
     // Nothing special needed
 }
 
+void SpectrumAnalyzer::setEQResponse(const MasteringEQBase::MagnitudeResponse& responseDb)
+{
+    eqResponse = responseDb;
+}
+
 void SpectrumAnalyzer::setShowPre(bool show)
 {
     showPre = show;
@@ -2,6 +2,7 @@
 
 #include <JuceHeader.h>
 #include "LookAndFeel.h"
+#include "../DSP/MasteringEQ.h"
 #include <array>
 #include <atomic>
 
@@ -37,11 +38,16 @@ public:
     // Sample rate (needed for frequency calculation)
     void setSampleRate(double rate) { sampleRate = rate; }
 
+    // EQ curves drawn over the spectrum, in dB at MasteringEQBase::getResponseFrequency(): the
+    // stereo curve, and one for each placement that has bands on it
+    void setEQResponse(const MasteringEQBase::MagnitudeResponse& responseDb);
+
 private:
     void processFFT(const std::vector<float>& buffer, std::array<float, NUM_BINS>& magnitudes);
     void drawSpectrum(juce::Graphics& g, const std::array<float, NUM_BINS>& magnitudes,
                       juce::Colour colour, float alpha, bool drawFill);
     void drawGrid(juce::Graphics& g);
+    void drawEQCurve(juce::Graphics& g);
     juce::Rectangle<float> getAnalyzerBounds() const;
     float getFrequencyForBin(int bin) const;
     float getXForFrequency(float freq) const;
@@ -72,6 +78,10 @@ private:
     std::atomic<int> preWriteIndex { 0 };
     std::atomic<int> postWriteIndex { 0 };
 
+    // EQ curve overlay, centred on the analyser with its own +/- range
+    MasteringEQBase::MagnitudeResponse eqResponse;
+    float eqRangeDb = 18.0f;
+
     double sampleRate = 44100.0;
     float smoothingFactor = 0.7f;
     float slopeDbPerOctave = 3.0f;